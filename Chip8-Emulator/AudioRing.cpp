@@ -0,0 +1,61 @@
+#include "AudioRing.h"
+#include <algorithm>
+#include <cstring>
+
+size_t AudioRing::Write(const int16_t* samples, size_t count)
+{
+	uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+	uint32_t head = m_Head.load(std::memory_order_acquire);
+
+	size_t space = AUDIO_RING_SIZE - (tail - head);
+	size_t written = std::min(count, space);
+
+	// Copy in at most two pieces around the end of the ring
+	size_t start = tail & (AUDIO_RING_SIZE - 1);
+	size_t first = std::min(written, AUDIO_RING_SIZE - start);
+	std::memcpy(m_Samples.data() + start, samples, first * sizeof(int16_t));
+	std::memcpy(m_Samples.data(), samples + first, (written - first) * sizeof(int16_t));
+
+	m_Tail.store(tail + static_cast<uint32_t>(written), std::memory_order_release);
+
+	if (written < count)
+	{
+		m_Overruns.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return written;
+}
+
+size_t AudioRing::Read(int16_t* samples, size_t count)
+{
+	uint32_t head = m_Head.load(std::memory_order_relaxed);
+	uint32_t tail = m_Tail.load(std::memory_order_acquire);
+
+	size_t available = tail - head;
+	size_t read = std::min(count, available);
+
+	size_t start = head & (AUDIO_RING_SIZE - 1);
+	size_t first = std::min(read, AUDIO_RING_SIZE - start);
+	std::memcpy(samples, m_Samples.data() + start, first * sizeof(int16_t));
+	std::memcpy(samples + first, m_Samples.data(), (read - first) * sizeof(int16_t));
+
+	m_Head.store(head + static_cast<uint32_t>(read), std::memory_order_release);
+	return read;
+}
+
+void AudioRing::ReadOrSilence(int16_t* samples, size_t count)
+{
+	size_t read = Read(samples, count);
+	if (read < count)
+	{
+		std::memset(samples + read, 0, (count - read) * sizeof(int16_t));
+		m_Underruns.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+size_t AudioRing::GetFillLevel() const
+{
+	uint32_t head = m_Head.load(std::memory_order_acquire);
+	uint32_t tail = m_Tail.load(std::memory_order_acquire);
+	return tail - head;
+}
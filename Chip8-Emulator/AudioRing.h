@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+
+// Must be a power of two
+const unsigned int AUDIO_RING_SIZE = 16384;
+
+// Single-producer/single-consumer ring of mono 16-bit samples. The emulation thread writes, the audio thread reads.
+// Neither side ever waits: a full ring drops samples and an empty ring is read as silence
+class AudioRing
+{
+public:
+	AudioRing() = default;
+
+	// Queue samples. Returns the number queued, anything that didn't fit is dropped
+	size_t Write(const int16_t* samples, size_t count);
+
+	// Take up to count samples. Returns the number read
+	size_t Read(int16_t* samples, size_t count);
+
+	// Take exactly count samples, padding with silence and counting an underrun if the ring runs dry
+	void ReadOrSilence(int16_t* samples, size_t count);
+
+	// Samples waiting to be played
+	size_t GetFillLevel() const;
+
+	// Reads that had to be padded with silence
+	inline uint64_t GetUnderrunCount() const { return m_Underruns.load(std::memory_order_relaxed); }
+
+	// Writes that had to drop samples
+	inline uint64_t GetOverrunCount() const { return m_Overruns.load(std::memory_order_relaxed); }
+
+private:
+	std::array<int16_t, AUDIO_RING_SIZE> m_Samples = {};
+
+	// Written by the consumer
+	alignas(64) std::atomic<uint32_t> m_Head = 0;
+	std::atomic<uint64_t> m_Underruns = 0;
+
+	// Written by the producer
+	alignas(64) std::atomic<uint32_t> m_Tail = 0;
+	std::atomic<uint64_t> m_Overruns = 0;
+};
@@ -0,0 +1,49 @@
+#include "AudioSynth.h"
+#include "Chip8.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const int16_t AMPLITUDE = 8192;
+	const unsigned int PATTERN_BITS = AUDIO_PATTERN_SIZE * 8;
+}
+
+AudioSynth::AudioSynth(unsigned sample_rate) : m_SampleRate(sample_rate)
+{
+	m_Buffer.resize(sample_rate / TIMER_HZ + 1);
+}
+
+void AudioSynth::Tick(const Chip8& chip8, AudioRing& ring)
+{
+	// Number of samples in this tick
+	unsigned count = (m_SampleRate + m_SampleRemainder) / TIMER_HZ;
+	m_SampleRemainder = (m_SampleRate + m_SampleRemainder) % TIMER_HZ;
+
+	if (chip8.GetSoundTimer() == 0)
+	{
+		std::fill(m_Buffer.begin(), m_Buffer.begin() + count, static_cast<int16_t>(0));
+		m_Phase = 0.0;
+	}
+	else
+	{
+		// XO-CHIP plays the pattern at 4000 * 2^((pitch - 64) / 48) bits per second
+		const auto& pattern = chip8.GetAudioPattern();
+		double step = 4000.0 * std::pow(2.0, (chip8.GetPitch() - 64) / 48.0) / m_SampleRate;
+
+		for (unsigned i = 0; i < count; ++i)
+		{
+			unsigned bit = static_cast<unsigned>(m_Phase);
+			bool on = (pattern[bit >> 3] >> (7 - (bit & 7))) & 1;
+			m_Buffer[i] = on ? AMPLITUDE : -AMPLITUDE;
+
+			m_Phase += step;
+			if (m_Phase >= PATTERN_BITS)
+			{
+				m_Phase -= PATTERN_BITS;
+			}
+		}
+	}
+
+	ring.Write(m_Buffer.data(), count);
+}
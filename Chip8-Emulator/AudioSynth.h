@@ -0,0 +1,34 @@
+#pragma once
+
+#include "AudioRing.h"
+#include <cstdint>
+#include <vector>
+
+class Chip8;
+
+const unsigned int AUDIO_SAMPLE_RATE = 48000;
+const unsigned int TIMER_HZ = 60;
+
+// Turns the sound timer and audio pattern into PCM, one 60Hz timer tick at a time
+class AudioSynth
+{
+public:
+	AudioSynth(unsigned sample_rate = AUDIO_SAMPLE_RATE);
+
+	// Render the samples for one timer tick and queue them. Call once per tick, before UpdateTimers. Never blocks
+	void Tick(const Chip8& chip8, AudioRing& ring);
+
+	inline unsigned GetSampleRate() const { return m_SampleRate; }
+
+private:
+	unsigned m_SampleRate = AUDIO_SAMPLE_RATE;
+
+	// Carries the fractional samples per tick over so the long run rate is exact
+	unsigned m_SampleRemainder = 0;
+
+	// Position in the 128-bit pattern, carried across ticks so the waveform has no seams
+	double m_Phase = 0.0;
+
+	// One tick of samples, allocated once
+	std::vector<int16_t> m_Buffer;
+};
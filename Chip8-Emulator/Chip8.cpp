@@ -1,471 +1,229 @@
 #include "Chip8.h"
-#include <fstream>
-#include <chrono>
-#include <random>
-#include <string>
-#include <sstream>
-#include <Windows.h>
-#include <iostream>
-
-namespace
+#include "Chip8State.h"
+#include "InputQueue.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <stdexcept>
+
+void Chip8::InvalidInstruction(uint16_t opcode)
 {
-	const unsigned int FONTSET_SIZE = 80;
-	const unsigned int FONTSET_START_ADDRESS = 0x50;
-	const unsigned int START_ADDRESS = 0x200;
+	// Formatted on the stack rather than through a stream. The exception still allocates its message, but only on this fault
+	char message[40];
+	std::snprintf(message, sizeof(message), "Invalid instruction: 0x%x", opcode);
 
-	const uint8_t fontset[FONTSET_SIZE] =
-	{
-		0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-		0x20, 0x60, 0x20, 0x20, 0x70, // 1
-		0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-		0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-		0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-		0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-		0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-		0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-		0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-		0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-		0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-		0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-		0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-		0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-		0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-		0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-	};
-
-	void InvalidInstruction(uint32_t opcode)
-	{
-		std::wstringstream ss;
-		ss << "Invalid instructions: 0x" << std::hex << opcode;
-
-		MessageBox(NULL, ss.str().c_str(), L"Error", MB_OK);
-		throw std::exception("Invalid instruction");
-	}
+	throw std::runtime_error(message);
 }
 
-Chip8::Chip8()
+bool Chip8::LoadROM(char const* filename)
 {
-	// Initialize PC
-	m_ProgramCounter = START_ADDRESS;
-
-	// Load fonts into m_Memory
-	for (unsigned i = 0; i < FONTSET_SIZE; ++i)
+	// Unbuffered stdio and a chunk on the stack, so loading a ROM doesn't touch the heap either
+	FILE* file = std::fopen(filename, "rb");
+	if (!file)
 	{
-		m_Memory[FONTSET_START_ADDRESS + i] = fontset[i];
+		return false;
 	}
-}
 
-void Chip8::LoadROM(char const* filename)
-{
-	std::ifstream file(filename, std::fstream::in | std::fstream::binary);
-	std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-	std::memcpy(m_Memory.data() + START_ADDRESS, data.data(), data.size());
-}
-
-void Chip8::Cycle()
-{
-	// Fetch (opcode is 16 bits so we must read the current program counter and the next program counter)
-	uint16_t opcode = (m_Memory[m_ProgramCounter] << 8) | m_Memory[m_ProgramCounter + 1];
-
-	std::cout << "OPCODE: 0x" << std::hex << opcode << '\n';
+	std::setvbuf(file, nullptr, _IONBF, 0);
 
-	// Increment the program counter before we execute anything
-	m_ProgramCounter += 2;
-
-	// Decode and execute
-	uint32_t decode = (opcode & 0xF000) >> 12;
-
-	if (decode == 0x0)
-	{
-		if (opcode == 0x00E0) // 00E0
-		{
-			// Clears the screen
-			std::memset(VideoBuffer.data(), 0, VideoBuffer.size());
-		}
-		else if (opcode == 0x00EE) // 00EE
-		{
-			// Returns from a subroutine (pop the stack)
-			m_ProgramCounter = m_Stack.top();
-			m_Stack.pop();
-		}
-	}
-	else if (decode == 0x1) // 1NNN
+	long size = std::fseek(file, 0, SEEK_END) == 0 ? std::ftell(file) : -1;
+	if (size <= 0 || size > static_cast<long>(GetMaxRomSize()) || std::fseek(file, 0, SEEK_SET) != 0)
 	{
-		// Jumps to address NNN
-		m_ProgramCounter = opcode & 0x0FFF;
-	}
-	else if (decode == 0x2) // 2NNN
-	{
-		// Calls subroutine at NNN (push the stack)
-		uint16_t address = opcode & 0x0FFF;
-		m_Stack.push(m_ProgramCounter);
-		m_ProgramCounter = address;
-	}
-	else if (decode == 0x3) // 3XNN
-	{
-		// Skips the next instruction if VX equals NN (usually the next instruction is a jump to skip a code block)
-		uint8_t vx_register = (opcode & 0x0F00) >> 8;
-		uint8_t byte = opcode & 0x00FF;
-
-		if (m_Registers[vx_register] == byte)
-		{
-			m_ProgramCounter += 2;
-		}
+		std::fclose(file);
+		return false;
 	}
-	else if (decode == 0x4) // 4XNN
-	{
-		// Skips the next instruction if VX does not equal NN (usually the next instruction is a jump to skip a code block)
-		uint8_t vx_register = (opcode & 0x0F00) >> 8;
-		uint8_t byte = opcode & 0x00FF;
 
-		if (m_Registers[vx_register] != byte)
-		{
-			m_ProgramCounter += 2;
-		}
-	}
-	else if (decode == 0x5) // 5XY0
+	std::array<uint8_t, 0x1000> chunk;
+	for (long offset = 0; offset < size; offset += static_cast<long>(chunk.size()))
 	{
-		// Skips the next instruction if VX equals VY (usually the next instruction is a jump to skip a code block). 
-		uint8_t vx_register = (opcode & 0x0F00) >> 8;
-		uint8_t vy_register = (opcode & 0x00F0) >> 4;
-
-		if (m_Registers[vx_register] == m_Registers[vy_register])
+		size_t length = static_cast<size_t>(std::min<long>(size - offset, static_cast<long>(chunk.size())));
+		if (std::fread(chunk.data(), 1, length, file) != length)
 		{
-			m_ProgramCounter += 2;
+			std::fclose(file);
+			return false;
 		}
-	}
-	else if (decode == 0x6) // 6XNN
-	{
-		// Sets VX register to NN
-		uint8_t vx_register = (opcode & 0x0F00) >> 8;
-		uint8_t byte = opcode & 0x00FF;
 
-		m_Registers[vx_register] = byte;
+		m_Memory.Load(ROM_START_ADDRESS + static_cast<unsigned>(offset), std::span<const uint8_t>(chunk.data(), length));
 	}
-	else if (decode == 0x7) // 7XNN
-	{
-		// Adds NN to VX (carry flag is not changed)
-		uint8_t vx_register = (opcode & 0x0F00) >> 8;
-		uint8_t byte = opcode & 0x00FF;
-
-		m_Registers[vx_register] += byte;
-	}
-	else if (decode == 0x8) // 8
-	{
-		uint32_t val = opcode & 0x000F;
-
-		if (val == 0x0) // 8XY0
-		{
-			// Sets VX to the value of VY
-			uint8_t vx_register = (opcode & 0x0F00) >> 8;
-			uint8_t vy_register = (opcode & 0x00F0) >> 4;
-
-			m_Registers[vx_register] = m_Registers[vy_register];
-		}
-		else if (val == 0x1) // 8XY1
-		{
-			// Sets VX to VX or VY. (bitwise OR operation) 
-			uint8_t vx_register = (opcode & 0x0F00) >> 8;
-			uint8_t vy_register = (opcode & 0x00F0) >> 4;
-
-			m_Registers[vx_register] |= m_Registers[vy_register];
-		}
-		else if (val == 0x2) // 8XY2
-		{
-			// Sets VX to VX and VY. (bitwise AND operation) 
-			uint8_t vx_register = (opcode & 0x0F00) >> 8;
-			uint8_t vy_register = (opcode & 0x00F0) >> 4;
-
-			m_Registers[vx_register] &= m_Registers[vy_register];
-		}
-		else if (val == 0x3) // 8XY3
-		{
-			// Sets VX to VX xor VY
-			uint8_t vx_register = (opcode & 0x0F00) >> 8;
-			uint8_t vy_register = (opcode & 0x00F0) >> 4;
-
-			m_Registers[vx_register] ^= m_Registers[vy_register];
-		}
-		else if (val == 0x4) // 8XY4
-		{
-			// Adds VY to VX. VF is set to 1 when there's a carry, and to 0 when there is not
-			uint8_t vx_register = (opcode & 0x0F00) >> 8;
-			uint8_t vy_register = (opcode & 0x00F0) >> 4;
 
-			uint16_t sum = m_Registers[vx_register] + m_Registers[vy_register];
-
-			if (sum > 255)
-			{
-				m_Registers[0xF] = 1;
-			}
-			else
-			{
-				m_Registers[0xF] = 0;
-			}
-
-			m_Registers[vx_register] = static_cast<uint8_t>(sum);
-		}
-		else if (val == 0x5) // 8XY5
-		{
-			// VY is subtracted from VX. VF is set to 0 when there's a borrow, and 1 when there is not
-			uint8_t vx_register = (opcode & 0x0F00) >> 8;
-			uint8_t vy_register = (opcode & 0x00F0) >> 4;
-
-			if (m_Registers[vx_register] > m_Registers[vy_register])
-			{
-				m_Registers[0xF] = 1;
-			}
-			else
-			{
-				m_Registers[0xF] = 0;
-			}
+	std::fclose(file);
+	return true;
+}
 
-			m_Registers[vx_register] -= m_Registers[vy_register];
-		}
-		else if (val == 0x6) // 8XY6
-		{
-			// Stores the least significant bit of VX in VF and then shifts VX to the right by 1
-			uint8_t vx_register = (opcode & 0x0F00) >> 8;
-			uint8_t vy_register = (opcode & 0x00F0) >> 4;
+void Chip8::SaveState(Chip8State& state) const
+{
+	state.Profile = m_QuirkProfile;
+	std::copy(m_Memory.GetBytes().begin(), m_Memory.GetBytes().end(), state.Memory.begin());
+	state.Registers = m_Registers;
+	state.IndexRegister = m_IndexRegister;
+	state.ProgramCounter = m_ProgramCounter;
+	state.Stack = m_Stack;
+	state.StackPointer = m_StackPointer;
+	state.DelayTimer = m_DelayTimer;
+	state.SoundTimer = m_SoundTimer;
+	state.Keypad = Keypad;
+	state.KeyWaitMask = m_KeyWaitMask;
+	state.VBlank = m_VBlank;
+	state.Halted = m_Halted;
+	state.RandomState = m_RandomState;
+	state.RplFlags = m_RplFlags;
+	state.AudioPattern = m_AudioPattern;
+	state.Pitch = m_Pitch;
+	state.CycleCount = m_CycleCount;
+	state.VideoBuffer = VideoBuffer;
+}
 
-			m_Registers[vx_register] >>= 1;
-		}
-		else if (val == 0x7) // 8XY7
-		{
-			// Sets VX to VY minus VX. VF is set to 0 when there's a borrow, and 1 when there is not
-			uint8_t vx_register = (opcode & 0x0F00) >> 8;
-			uint8_t vy_register = (opcode & 0x00F0) >> 4;
+void Chip8::LoadState(const Chip8State& state)
+{
+	SetQuirkProfile(state.Profile);
+	m_Memory.Load(0, state.Memory);
+	m_Registers = state.Registers;
+	m_IndexRegister = state.IndexRegister;
+	m_ProgramCounter = state.ProgramCounter;
+	m_Stack = state.Stack;
+	m_StackPointer = state.StackPointer & (STACK_LEVELS - 1);
+	m_DelayTimer = state.DelayTimer;
+	m_SoundTimer = state.SoundTimer;
+	Keypad = state.Keypad;
+	m_KeyWaitMask = state.KeyWaitMask;
+	m_VBlank = state.VBlank;
+	m_Halted = state.Halted;
+	m_RandomState = state.RandomState;
+	m_RplFlags = state.RplFlags;
+	m_AudioPattern = state.AudioPattern;
+	m_Pitch = state.Pitch;
+	m_CycleCount = state.CycleCount;
+	VideoBuffer = state.VideoBuffer;
+}
 
-			m_Registers[vx_register] = m_Registers[vy_register] - m_Registers[vx_register];
-		}
-		else if (val == 0xE) // 8XYE
-		{
-			// Stores the most significant bit of VX in VF and then shifts VX to the left by 1
-			uint8_t vx_register = (opcode & 0x0F00) >> 8;
-			uint8_t vy_register = (opcode & 0x00F0) >> 4;
+void Chip8::Restore(const Chip8& snapshot)
+{
+	m_Memory.RestoreDirtyPages(snapshot.m_Memory);
+
+	m_CycleFunction = snapshot.m_CycleFunction;
+	m_QuirkProfile = snapshot.m_QuirkProfile;
+	m_Registers = snapshot.m_Registers;
+	m_IndexRegister = snapshot.m_IndexRegister;
+	m_ProgramCounter = snapshot.m_ProgramCounter;
+	m_Stack = snapshot.m_Stack;
+	m_StackPointer = snapshot.m_StackPointer;
+	m_DelayTimer = snapshot.m_DelayTimer;
+	m_SoundTimer = snapshot.m_SoundTimer;
+	m_AudioPattern = snapshot.m_AudioPattern;
+	m_Pitch = snapshot.m_Pitch;
+	m_RplFlags = snapshot.m_RplFlags;
+	m_Halted = snapshot.m_Halted;
+	m_KeyWaitMask = snapshot.m_KeyWaitMask;
+	m_VBlank = snapshot.m_VBlank;
+	m_RandomState = snapshot.m_RandomState;
+	m_CycleCount = snapshot.m_CycleCount;
+	Keypad = snapshot.Keypad;
+	VideoBuffer = snapshot.VideoBuffer;
+}
 
-			m_Registers[vx_register] <<= 1;
-		}
-		else
-		{
-			InvalidInstruction(opcode);
-		}
-	}
-	else if (decode == 0x9) // 9XY0
+void Chip8::Run(uint32_t cycles, InputQueue& input)
+{
+	uint64_t end = m_CycleCount + cycles;
+	while (m_CycleCount < end)
 	{
-		// Skips the next instruction if VX does not equal VY. (Usually the next instruction is a jump to skip a code block)
-		uint8_t vx_register = (opcode & 0x0F00) >> 8;
-		uint8_t vy_register = (opcode & 0x00F0) >> 4;
-
-		if (m_Registers[vx_register] != m_Registers[vy_register])
+		// Run up to the next pending event without looking at the queue again
+		uint64_t next = ApplyInput(input, end);
+		while (m_CycleCount < next)
 		{
-			m_ProgramCounter += 2;
+			Cycle();
 		}
 	}
-	else if (decode == 0xA) // ANNN
-	{
-		// Sets I to the address NNN
-		m_IndexRegister = opcode & 0x0FFF;
-	}
-	else if (decode == 0xB) // BNNN
-	{
-		// Jumps to the address NNN plus V0
-		m_ProgramCounter = (opcode & 0x0FFF) + m_Registers[0];
-	}
-	else if (decode == 0xC) /// CXNN
-	{
-		// Sets VX to the result of a bitwise and operation on a random number (Typically: 0 to 255) and NN
-		uint8_t vx_register = (opcode & 0x0F00) >> 8;
-		uint8_t byte = opcode & 0x00FFu;
-
-		std::random_device dev;
-		std::mt19937 rng(dev());
-		std::uniform_int_distribution<std::mt19937::result_type> dist(0, 255);
-
-		m_Registers[vx_register] = dist(rng) & byte;
-	}
-	else if (decode == 0xD) // DXYN
-	{
-		// Draws a sprite at coordinate (VX, VY) that has a width of 8 pixels and a height of N pixels. 
-		// Each row of 8 pixels is read as bit-coded starting from m_Memory location I; I value does not change after the execution of this instruction. 
-		// As described above, VF is set to 1 if any screen pixels are flipped from set to unset when the sprite is drawn, and to 0 if that does not happen
-		uint8_t vx = (opcode & 0x0F00) >> 8;
-		uint8_t vy = (opcode & 0x00F0) >> 4;
-		uint8_t height = opcode & 0x000F;
-
-		// Wrap if going beyond screen boundaries
-		uint8_t xPos = m_Registers[vx] % VIDEO_WIDTH;
-		uint8_t yPos = m_Registers[vy] % VIDEO_HEIGHT;
-
-		m_Registers[0xF] = 0;
-
-		for (unsigned row = 0; row < height; ++row)
-		{
-			uint8_t spriteByte = m_Memory[m_IndexRegister + row];
-
-			for (unsigned col = 0; col < 8; ++col)
-			{
-				uint8_t sprite_pixel = spriteByte & (0x80 >> col);
-				uint32_t* screen_pixel = &VideoBuffer[(yPos + row) * VIDEO_WIDTH + (xPos + col)];
-
-				// Sprite pixel is on
-				if (sprite_pixel)
-				{
-					// Screen pixel also on - collision
-					if (*screen_pixel == 0xFFFFFFFF)
-					{
-						m_Registers[0xF] = 1;
-					}
+}
 
-					// Effectively XOR with the sprite pixel
-					*screen_pixel ^= 0xFFFFFFFF;
-				}
-			}
-		}
-	}
-	else if (decode == 0xE)
+uint64_t Chip8::ApplyInput(InputQueue& input, uint64_t limit)
+{
+	// Apply every event that is due before the next instruction
+	InputEvent event;
+	while (input.Peek(&event) && event.Cycle <= m_CycleCount)
 	{
-		uint32_t val = (opcode & 0x00FF);
-		if (val == 0x9E) // EX9E
-		{
-			// Skips the next instruction if the key stored in VX is pressed (usually the next instruction is a jump to skip a code block)
-			uint8_t register_vx = (opcode & 0x0F00) >> 8;
-			uint8_t key = m_Registers[register_vx];
-
-			if (Keypad[key])
-			{
-				m_ProgramCounter += 2;
-			}
-		}
-
-		else if (val == 0xA1) // EX9E
+		if (event.Pressed)
 		{
-			// Skips the next instruction if the key stored in VX is not pressed (usually the next instruction is a jump to skip a code block)
-			uint8_t register_vx = (opcode & 0x0F00) >> 8;
-			uint8_t key = m_Registers[register_vx];
-
-			if (!Keypad[key])
-			{
-				m_ProgramCounter += 2;
-			}
+			PressKey(event.Key);
 		}
 		else
 		{
-			InvalidInstruction(opcode);
+			ReleaseKey(event.Key);
 		}
-	}
-	else if (decode == 0xF)
-	{
-		uint32_t val = (opcode & 0x00FF);
 
-		if (val == 0x7) // FX07
-		{
-			// Sets VX to the value of the delay timer
-			uint8_t register_vx = (opcode & 0x0F00) >> 8;
-			m_Registers[register_vx] = m_DelayTimer;
-		}
-		else if (val == 0x0A) // FX0A
-		{
-			// A key press is awaited, and then stored in VX (blocking operation, all instruction halted until next key event)
-			uint8_t register_vx = (opcode & 0x0F00u) >> 8u;
-
-			bool keypad_down = false;
-			for (int i = 0; i < 16; ++i)
-			{
-				if (Keypad[i])
-				{
-					m_Registers[register_vx] = i;
-					keypad_down = true;
-				}
-			}
-
-			if (!keypad_down)
-			{
-				m_ProgramCounter -= 2;
-			}
-		}
-		else if (val == 0x15) // FX15
-		{
-			// Sets the delay timer to VX
-			uint8_t register_vx = (opcode & 0x0F00) >> 8;
-			m_DelayTimer = m_Registers[register_vx];
-		}
-		else if (val == 0x18) // FX18
-		{
-			// Sets the sound timer to VX
-			uint8_t register_vx = (opcode & 0x0F00) >> 8;
-			m_SoundTimer = m_Registers[register_vx];
-		}
-		else if (val == 0x1E) // FX1E
-		{
-			// Adds VX to I. VF is not affected
-			uint8_t register_vx = (opcode & 0x0F00) >> 8;
-			m_IndexRegister += m_Registers[register_vx];
-		}
-		else if (val == 0x29) // FX29
-		{
-			// Sets I to the location of the sprite for the character in VX. Characters 0-F (in hexadecimal) are represented by a 4x5 font
-			uint8_t register_vx = (opcode & 0x0F00u) >> 8u;
-			uint8_t digit = m_Registers[register_vx];
-
-			m_IndexRegister = FONTSET_START_ADDRESS + (5 * digit);
-		}
-		else if (val == 0x33) // FX33
-		{
-			// Stores the binary-coded decimal representation of VX, with the hundreds digit in m_Memory at location in I, the tens digit at location I+1, and the ones digit at location I+2
-			uint8_t register_vx = (opcode & 0x0F00) >> 8;
-			uint8_t value = m_Registers[register_vx];
-
-			// Ones-place
-			m_Memory[m_IndexRegister + 2] = value % 10;
-			value /= 10;
-
-			// Tens-place
-			m_Memory[m_IndexRegister + 1] = value % 10;
-			value /= 10;
-
-			// Hundreds-place
-			m_Memory[m_IndexRegister] = value % 10;
-		}
-		else if (val == 0x55) // FX55
-		{
-			// Stores from V0 to VX (including VX) in m_Memory, starting at address I. The offset from I is increased by 1 for each value written, but I itself is left unmodified
-			uint8_t Vx = (opcode & 0x0F00) >> 8;
-
-			for (uint8_t i = 0; i <= Vx; ++i)
-			{
-				m_Memory[m_IndexRegister + i] = m_Registers[i];
-			}
-		}
-		else if (val == 0x65) // FX65
-		{
-			// Fills from V0 to VX (including VX) with values from m_Memory, starting at address I. The offset from I is increased by 1 for each value read, but I itself is left unmodified
-			uint8_t Vx = (opcode & 0x0F00) >> 8;
-
-			for (uint8_t i = 0; i <= Vx; ++i)
-			{
-				m_Registers[i] = m_Memory[m_IndexRegister + i];
-			}
-		}
-		else
-		{
-			InvalidInstruction(opcode);
-		}
-	}
-	else
-	{
-		InvalidInstruction(opcode);
+		input.Pop();
 	}
 
-	// Decrement the delay timer if it's been set
-	if (m_DelayTimer > 0)
-	{
-		--m_DelayTimer;
-	}
+	return input.Peek(&event) && event.Cycle < limit ? event.Cycle : limit;
+}
 
-	// Decrement the sound timer if it's been set
-	if (m_SoundTimer > 0)
-	{
-		--m_SoundTimer;
-	}
+// Opcode tests, run by the compiler. A failure or an invalid instruction stops the build
+namespace
+{
+	// Load a program, run it for a number of cycles and return the machine
+	template <size_t Size>
+	constexpr Chip8 RunProgram(const uint8_t (&program)[Size], unsigned cycles, QuirkProfile profile = QuirkProfile::Chip8)
+	{
+		Chip8 chip8(profile);
+		chip8.LoadROM(program);
+
+		for (unsigned i = 0; i < cycles; ++i)
+		{
+			// A frame boundary before every instruction, so DXYN never waits
+			chip8.UpdateTimers();
+			chip8.Cycle();
+		}
+
+		return chip8;
+	}
+
+	// 8XY4 carry: V0 = 0xFF + 0x02
+	constexpr uint8_t add_carry[] = { 0x60, 0xFF, 0x61, 0x02, 0x80, 0x14 };
+	static_assert(RunProgram(add_carry, 3).GetRegisters()[0x0] == 0x01);
+	static_assert(RunProgram(add_carry, 3).GetRegisters()[0xF] == 1);
+
+	// 8XY5 borrow: V0 = 0x05 - 0x07
+	constexpr uint8_t sub_borrow[] = { 0x60, 0x05, 0x61, 0x07, 0x80, 0x15 };
+	static_assert(RunProgram(sub_borrow, 3).GetRegisters()[0x0] == 0xFE);
+	static_assert(RunProgram(sub_borrow, 3).GetRegisters()[0xF] == 0);
+
+	// FX33 then FX65: 156 read back as digits, and I moves on with the COSMAC VIP quirk only
+	constexpr uint8_t bcd[] = { 0x60, 0x9C, 0xA3, 0x00, 0xF0, 0x33, 0xF2, 0x65 };
+	static_assert(RunProgram(bcd, 4).GetRegisters()[0x0] == 1);
+	static_assert(RunProgram(bcd, 4).GetRegisters()[0x1] == 5);
+	static_assert(RunProgram(bcd, 4).GetRegisters()[0x2] == 6);
+	static_assert(RunProgram(bcd, 4).GetIndexRegister() == 0x303);
+	static_assert(RunProgram(bcd, 4, QuirkProfile::SuperChip).GetIndexRegister() == 0x300);
+
+	// 8XY6 shifts VY on the COSMAC VIP and VX on SUPER-CHIP
+	constexpr uint8_t shift[] = { 0x60, 0x01, 0x61, 0x81, 0x80, 0x16 };
+	static_assert(RunProgram(shift, 3).GetRegisters()[0x0] == 0x40);
+	static_assert(RunProgram(shift, 3, QuirkProfile::SuperChip).GetRegisters()[0x0] == 0x00);
+
+	// 2NNN and 00EE: call 0x206, set V0, return to set V1
+	constexpr uint8_t call[] = { 0x22, 0x06, 0x61, 0x01, 0x12, 0x04, 0x60, 0x07, 0x00, 0xEE };
+	static_assert(RunProgram(call, 4).GetRegisters()[0x0] == 7);
+	static_assert(RunProgram(call, 4).GetRegisters()[0x1] == 1);
+	static_assert(RunProgram(call, 4).GetProgramCounter() == 0x204);
+	static_assert(RunProgram(call, 4).GetStackPointer() == 0);
+
+	// FX29 and DXYN: "A" from the font, then drawn again over itself
+	constexpr uint8_t draw[] = { 0x60, 0x0A, 0xF0, 0x29, 0xD1, 0x15, 0xD1, 0x15 };
+	static_assert(RunProgram(draw, 3).VideoBuffer.GetPixel(0, 0) == 1);
+	static_assert(RunProgram(draw, 3).VideoBuffer.GetPixel(1, 1) == 0);
+	static_assert(RunProgram(draw, 3).GetRegisters()[0xF] == 0);
+	static_assert(RunProgram(draw, 4).VideoBuffer.GetPixel(0, 0) == 0);
+	static_assert(RunProgram(draw, 4).GetRegisters()[0xF] == 1);
+
+	// XO-CHIP skips over all of F000 NNNN
+	constexpr uint8_t long_skip[] = { 0x30, 0x00, 0xF0, 0x00, 0x12, 0x34, 0x61, 0x05 };
+	static_assert(RunProgram(long_skip, 2, QuirkProfile::XoChip).GetRegisters()[0x1] == 5);
+	static_assert(RunProgram(long_skip, 2, QuirkProfile::XoChip).GetProgramCounter() == 0x208);
+
+	// FX55 at I = 0xFFFF wraps to address 0, where both written pages are marked dirty, and FX65 reads back through the wrap
+	constexpr uint8_t wrap[] = { 0xF0, 0x00, 0xFF, 0xFF, 0x60, 0x12, 0x61, 0x34, 0xF1, 0x55, 0xF0, 0x00, 0xFF, 0xFF, 0xF1, 0x65 };
+	static_assert(RunProgram(wrap, 4, QuirkProfile::XoChip).GetMemory()[0x0000] == 0x34);
+	static_assert(RunProgram(wrap, 4, QuirkProfile::XoChip).GetMemory().IsPageDirty(0));
+	static_assert(RunProgram(wrap, 4, QuirkProfile::XoChip).GetMemory().IsPageDirty(MEMORY_PAGE_COUNT - 1));
+	static_assert(!RunProgram(wrap, 4, QuirkProfile::XoChip).GetMemory().IsPageDirty(MEMORY_PAGE_COUNT / 2));
+	static_assert(RunProgram(wrap, 6, QuirkProfile::XoChip).GetRegisters()[0x1] == 0x34);
 }
@@ -1,41 +1,159 @@
 #pragma once
 
 // https://en.wikipedia.org/wiki/CHIP-8
+#include "Display.h"
+#include "Fonts.h"
+#include "Memory.h"
+#include "Quirks.h"
 #include <cstdint>
 #include <array>
-#include <stack>
+#include <bit>
+#include <span>
+
+#ifdef CHIP8_INSTRUMENTATION
+#include "Instrumentation.h"
+#define CHIP8_INSTRUMENT(call) do { if (m_Instrumentation) m_Instrumentation->call; } while (0)
+#else
+#define CHIP8_INSTRUMENT(call) do { } while (0)
+#endif
+
+class InputQueue;
+class Instrumentation;
+struct Chip8State;
 
 const unsigned int KEY_COUNT = 16;
-const unsigned int MEMORY_SIZE = 4096;
+const unsigned int CHIP8_MEMORY_SIZE = 0x1000;
 const unsigned int REGISTER_COUNT = 16;
 const unsigned int STACK_LEVELS = 16;
-const unsigned int VIDEO_HEIGHT = 32;
-const unsigned int VIDEO_WIDTH = 64;
+const unsigned int RPL_FLAG_COUNT = 16;
+const unsigned int AUDIO_PATTERN_SIZE = 16;
+const unsigned int FONTSET_START_ADDRESS = 0x50;
+const unsigned int BIG_FONTSET_START_ADDRESS = 0xA0;
+const unsigned int ROM_START_ADDRESS = 0x200;
+const unsigned int MAX_ROM_SIZE = MEMORY_SIZE - ROM_START_ADDRESS;
+
+static_assert(FONTSET_START_ADDRESS + FONTSET_SIZE <= BIG_FONTSET_START_ADDRESS, "The fonts overlap");
+static_assert(BIG_FONTSET_START_ADDRESS + BIG_FONTSET_SIZE <= ROM_START_ADDRESS, "The big font runs into the ROM");
+
+// CXNN random number generator (xorshift32). Deterministic so runs can be replayed and compared
+constexpr uint8_t NextRandom(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return static_cast<uint8_t>(state >> 24);
+}
 
+// The interpreter (construction, loading from a buffer, Cycle and UpdateTimers) is constexpr, so short programs can be run
+// in a static_assert. Reaching an invalid instruction in constant evaluation is a compile error
 class Chip8
 {
 public:
-	Chip8();
+	constexpr Chip8(QuirkProfile profile = QuirkProfile::Chip8);
+
+	// Load the ROM into memory. Returns false if the file can't be read or doesn't fit in memory
+	bool LoadROM(char const* filename);
+
+	// Load the ROM from a buffer (e.g. a view into a memory mapped ROM pack)
+	constexpr bool LoadROM(std::span<const uint8_t> rom);
+
+	// Largest ROM the current profile can load (XO-CHIP has 64KB of memory, the others 4KB)
+	constexpr unsigned GetMaxRomSize() const;
 
-	// Load the ROM into memory
-	void LoadROM(char const* filename);
+	// Addressable memory for the current profile (4KB, or 64KB for XO-CHIP)
+	constexpr unsigned GetMemorySize() const;
+
+	// Select the interpreter specialised for a quirk profile
+	constexpr void SetQuirkProfile(QuirkProfile profile);
+	constexpr QuirkProfile GetQuirkProfile() const { return m_QuirkProfile; }
 
 	// Cycle through the CPU
-	void Cycle();
+	constexpr void Cycle() { (this->*m_CycleFunction)(); }
+
+	// Decrement the delay and sound timers. Call at 60Hz
+	constexpr void UpdateTimers();
+
+	// Run a number of cycles, applying queued input events on the cycle they are stamped with
+	void Run(uint32_t cycles, InputQueue& input);
+
+	// Apply every queued input event due by the current cycle. Returns the cycle of the next queued event, or limit if there
+	// is none before it. The input loop of Run, for callers that run the cycles in between themselves
+	uint64_t ApplyInput(InputQueue& input, uint64_t limit);
+
+	// Press or release a key on the keypad
+	constexpr void PressKey(uint8_t key) { Keypad |= static_cast<uint16_t>(1u << (key & 0xF)); }
+	constexpr void ReleaseKey(uint8_t key) { Keypad &= static_cast<uint16_t>(~(1u << (key & 0xF))); }
+
+	// Number of cycles executed since construction
+	constexpr uint64_t GetCycleCount() const { return m_CycleCount; }
+
+	// The program has exited (00FD)
+	constexpr bool IsHalted() const { return m_Halted; }
 
-	// Keypad
-	std::array<uint32_t, KEY_COUNT> Keypad;
+	// Seed the CXNN random number generator
+	constexpr void Seed(uint32_t seed) { m_RandomState = seed != 0 ? seed : 1; }
+
+#ifdef CHIP8_INSTRUMENTATION
+	// Count every instruction executed into instrumentation (nullptr to stop)
+	inline void SetInstrumentation(Instrumentation* instrumentation) { m_Instrumentation = instrumentation; }
+#endif
+
+	// Copy the whole machine state out or in
+	void SaveState(Chip8State& state) const;
+	void LoadState(const Chip8State& state);
+
+	// Return to snapshot, a copy of this machine made when its dirty pages were last cleared. Only the memory pages written
+	// since are copied back, which is much cheaper than assigning the whole machine
+	void Restore(const Chip8& snapshot);
+
+	// Start tracking memory writes afresh (see Memory)
+	constexpr void ClearDirtyPages() { m_Memory.ClearDirtyPages(); }
+
+	// Read-only views of the machine state
+	constexpr const Memory& GetMemory() const { return m_Memory; }
+	constexpr const std::array<uint8_t, REGISTER_COUNT>& GetRegisters() const { return m_Registers; }
+	constexpr const std::array<uint16_t, STACK_LEVELS>& GetStack() const { return m_Stack; }
+	constexpr uint8_t GetStackPointer() const { return m_StackPointer; }
+	constexpr uint16_t GetIndexRegister() const { return m_IndexRegister; }
+	constexpr uint16_t GetProgramCounter() const { return m_ProgramCounter; }
+	constexpr uint8_t GetDelayTimer() const { return m_DelayTimer; }
+	constexpr const std::array<uint8_t, RPL_FLAG_COUNT>& GetRplFlags() const { return m_RplFlags; }
+
+	// Whether a vertical blank has passed since the last draw, which DXYN waits for under the display wait quirk
+	constexpr bool IsVBlank() const { return m_VBlank; }
+
+	// Sound state, sampled by the audio synthesizer once per timer tick
+	constexpr uint8_t GetSoundTimer() const { return m_SoundTimer; }
+	constexpr const std::array<uint8_t, AUDIO_PATTERN_SIZE>& GetAudioPattern() const { return m_AudioPattern; }
+	constexpr uint8_t GetPitch() const { return m_Pitch; }
+
+	// Keypad (one bit per key)
+	uint16_t Keypad = 0;
 
 	// VRAM
-	std::array<uint32_t, VIDEO_WIDTH* VIDEO_HEIGHT> VideoBuffer;
+	Display VideoBuffer;
 
 private:
+	// Interpreter for one quirk profile
+	template <typename Quirks>
+	constexpr void CycleImpl();
+
+	// Skip over the next instruction, which is 4 bytes long if it is XO-CHIP's F000 NNNN
+	template <typename Quirks>
+	constexpr void SkipNextInstruction();
+
+	// Throws std::runtime_error. Not constexpr, so reaching it in constant evaluation fails to compile
+	[[noreturn]] static void InvalidInstruction(uint16_t opcode);
+
+	// Selected interpreter
+	void (Chip8::*m_CycleFunction)() = nullptr;
+	QuirkProfile m_QuirkProfile = QuirkProfile::Chip8;
 
 	// RAM
-	std::array<uint8_t, MEMORY_SIZE> m_Memory;
+	Memory m_Memory;
 
 	// Registers
-	std::array<uint8_t, REGISTER_COUNT> m_Registers;
+	std::array<uint8_t, REGISTER_COUNT> m_Registers = {};
 
 	// Index register
 	uint16_t m_IndexRegister = 0;
@@ -43,12 +161,665 @@ private:
 	// Program counter
 	uint16_t m_ProgramCounter = 0;
 
-	// Stacks
-	std::stack<uint16_t> m_Stack;
+	// Stack of return addresses. The stack pointer wraps rather than overflowing
+	std::array<uint16_t, STACK_LEVELS> m_Stack = {};
+	uint8_t m_StackPointer = 0;
 
 	// Delay timer
 	uint8_t m_DelayTimer = 0;
 
 	// Sound timer
 	uint8_t m_SoundTimer = 0;
+
+	// XO-CHIP audio pattern (F002) and pitch (FX3A)
+	std::array<uint8_t, AUDIO_PATTERN_SIZE> m_AudioPattern = {};
+	uint8_t m_Pitch = 64;
+
+	// SUPER-CHIP RPL user flags (FX75/FX85)
+	std::array<uint8_t, RPL_FLAG_COUNT> m_RplFlags = {};
+
+	// Set by 00FD
+	bool m_Halted = false;
+
+	// Keys seen down while FX0A is waiting
+	uint16_t m_KeyWaitMask = 0;
+
+	// Set by UpdateTimers, consumed by a sprite draw when the display wait quirk is on
+	bool m_VBlank = false;
+
+	// CXNN random number generator state
+	uint32_t m_RandomState = 0x2545F491;
+
+	// Cycles executed
+	uint64_t m_CycleCount = 0;
+
+#ifdef CHIP8_INSTRUMENTATION
+	Instrumentation* m_Instrumentation = nullptr;
+#endif
 };
+
+constexpr Chip8::Chip8(QuirkProfile profile)
+{
+	// Initialize PC
+	m_ProgramCounter = ROM_START_ADDRESS;
+
+	// Load fonts into m_Memory
+	m_Memory.Load(FONTSET_START_ADDRESS, FONTSET);
+	m_Memory.Load(BIG_FONTSET_START_ADDRESS, BIG_FONTSET);
+
+	// Until a ROM loads its own pattern (F002) the buzzer is a square wave
+	for (unsigned i = 0; i < AUDIO_PATTERN_SIZE; ++i)
+	{
+		m_AudioPattern[i] = (i & 1) ? 0x00 : 0xFF;
+	}
+
+	SetQuirkProfile(profile);
+
+	// A new machine has nothing written yet
+	m_Memory.ClearDirtyPages();
+}
+
+constexpr void Chip8::SetQuirkProfile(QuirkProfile profile)
+{
+	switch (profile)
+	{
+		case QuirkProfile::SuperChip:
+			m_CycleFunction = &Chip8::CycleImpl<Quirks<QuirkProfile::SuperChip>>;
+			break;
+
+		case QuirkProfile::XoChip:
+			m_CycleFunction = &Chip8::CycleImpl<Quirks<QuirkProfile::XoChip>>;
+			break;
+
+		default:
+			profile = QuirkProfile::Chip8;
+			m_CycleFunction = &Chip8::CycleImpl<Quirks<QuirkProfile::Chip8>>;
+			break;
+	}
+
+	m_QuirkProfile = profile;
+}
+
+constexpr bool Chip8::LoadROM(std::span<const uint8_t> rom)
+{
+	if (rom.empty() || rom.size() > GetMaxRomSize())
+	{
+		return false;
+	}
+
+	m_Memory.Load(ROM_START_ADDRESS, rom);
+	return true;
+}
+
+constexpr unsigned Chip8::GetMaxRomSize() const
+{
+	return GetMemorySize() - ROM_START_ADDRESS;
+}
+
+constexpr unsigned Chip8::GetMemorySize() const
+{
+	return m_QuirkProfile == QuirkProfile::XoChip ? MEMORY_SIZE : CHIP8_MEMORY_SIZE;
+}
+
+constexpr void Chip8::UpdateTimers()
+{
+	// Decrement the delay timer if it's been set
+	if (m_DelayTimer > 0)
+	{
+		--m_DelayTimer;
+	}
+
+	// Decrement the sound timer if it's been set
+	if (m_SoundTimer > 0)
+	{
+		--m_SoundTimer;
+	}
+
+	m_VBlank = true;
+}
+
+template <typename Quirks>
+constexpr void Chip8::SkipNextInstruction()
+{
+	if constexpr (Quirks::XoChipInstructions)
+	{
+		if (m_Memory.ReadWord(m_ProgramCounter) == 0xF000)
+		{
+			m_ProgramCounter += 2;
+		}
+	}
+
+	m_ProgramCounter += 2;
+	CHIP8_INSTRUMENT(OnSkip());
+}
+
+template <typename Quirks>
+constexpr void Chip8::CycleImpl()
+{
+	// Fetch (opcode is 16 bits so we must read the current program counter and the next program counter)
+	uint16_t opcode = m_Memory.ReadWord(m_ProgramCounter);
+	CHIP8_INSTRUMENT(OnInstruction(m_ProgramCounter, opcode));
+
+	// Increment the program counter before we execute anything
+	m_ProgramCounter += 2;
+	++m_CycleCount;
+
+	// Operands
+	uint8_t vx_register = (opcode & 0x0F00) >> 8;
+	uint8_t vy_register = (opcode & 0x00F0) >> 4;
+	uint8_t byte = opcode & 0x00FF;
+	uint16_t address = opcode & 0x0FFF;
+
+	uint8_t& vx = m_Registers[vx_register];
+	uint8_t& vy = m_Registers[vy_register];
+
+	// Decode and execute
+	switch (opcode >> 12)
+	{
+		case 0x0:
+			if (opcode == 0x00E0) // 00E0
+			{
+				// Clears the screen
+				VideoBuffer.Clear();
+			}
+			else if (opcode == 0x00EE) // 00EE
+			{
+				// Returns from a subroutine (pop the stack)
+				m_StackPointer = (m_StackPointer - 1) & (STACK_LEVELS - 1);
+				m_ProgramCounter = m_Stack[m_StackPointer];
+			}
+			else if constexpr (Quirks::SuperChipInstructions)
+			{
+				if ((opcode & 0xFFF0) == 0x00C0) // 00CN
+				{
+					// Scrolls the display down by N pixels
+					VideoBuffer.ScrollDown(opcode & 0x000F);
+				}
+				else if (Quirks::XoChipInstructions && (opcode & 0xFFF0) == 0x00D0) // 00DN
+				{
+					// Scrolls the display up by N pixels
+					VideoBuffer.ScrollUp(opcode & 0x000F);
+				}
+				else if (opcode == 0x00FB) // 00FB
+				{
+					// Scrolls the display right by 4 pixels
+					VideoBuffer.ScrollRight4();
+				}
+				else if (opcode == 0x00FC) // 00FC
+				{
+					// Scrolls the display left by 4 pixels
+					VideoBuffer.ScrollLeft4();
+				}
+				else if (opcode == 0x00FD) // 00FD
+				{
+					// Exits the interpreter (stay on this instruction)
+					m_Halted = true;
+					m_ProgramCounter -= 2;
+				}
+				else if (opcode == 0x00FE) // 00FE
+				{
+					// Switches to 64x32 low resolution
+					VideoBuffer.SetHighResolution(false);
+				}
+				else if (opcode == 0x00FF) // 00FF
+				{
+					// Switches to 128x64 high resolution
+					VideoBuffer.SetHighResolution(true);
+				}
+			}
+			break;
+
+		case 0x1: // 1NNN
+			// Jumps to address NNN
+			m_ProgramCounter = address;
+			break;
+
+		case 0x2: // 2NNN
+			// Calls subroutine at NNN (push the stack)
+			CHIP8_INSTRUMENT(OnCall(m_StackPointer + 1u));
+			m_Stack[m_StackPointer] = m_ProgramCounter;
+			m_StackPointer = (m_StackPointer + 1) & (STACK_LEVELS - 1);
+			m_ProgramCounter = address;
+			break;
+
+		case 0x3: // 3XNN
+			// Skips the next instruction if VX equals NN (usually the next instruction is a jump to skip a code block)
+			if (vx == byte)
+			{
+				SkipNextInstruction<Quirks>();
+			}
+			break;
+
+		case 0x4: // 4XNN
+			// Skips the next instruction if VX does not equal NN (usually the next instruction is a jump to skip a code block)
+			if (vx != byte)
+			{
+				SkipNextInstruction<Quirks>();
+			}
+			break;
+
+		case 0x5:
+			if ((opcode & 0x000F) == 0x0) // 5XY0
+			{
+				// Skips the next instruction if VX equals VY (usually the next instruction is a jump to skip a code block)
+				if (vx == vy)
+				{
+					SkipNextInstruction<Quirks>();
+				}
+			}
+			else if (Quirks::XoChipInstructions && (opcode & 0x000F) == 0x2) // 5XY2
+			{
+				// Stores VX to VY (in either order) in m_Memory, starting at address I. I is not modified
+				int step = vx_register <= vy_register ? 1 : -1;
+				for (int i = vx_register, offset = 0; ; i += step, ++offset)
+				{
+					m_Memory.Write(m_IndexRegister + offset, m_Registers[i]);
+					if (i == vy_register)
+						break;
+				}
+			}
+			else if (Quirks::XoChipInstructions && (opcode & 0x000F) == 0x3) // 5XY3
+			{
+				// Fills VX to VY (in either order) with values from m_Memory, starting at address I. I is not modified
+				int step = vx_register <= vy_register ? 1 : -1;
+				for (int i = vx_register, offset = 0; ; i += step, ++offset)
+				{
+					m_Registers[i] = m_Memory[m_IndexRegister + offset];
+					if (i == vy_register)
+						break;
+				}
+			}
+			else
+			{
+				InvalidInstruction(opcode);
+			}
+			break;
+
+		case 0x6: // 6XNN
+			// Sets VX register to NN
+			vx = byte;
+			break;
+
+		case 0x7: // 7XNN
+			// Adds NN to VX (carry flag is not changed)
+			vx += byte;
+			break;
+
+		case 0x8:
+			switch (opcode & 0x000F)
+			{
+				case 0x0: // 8XY0
+					// Sets VX to the value of VY
+					vx = vy;
+					break;
+
+				case 0x1: // 8XY1
+					// Sets VX to VX or VY. (bitwise OR operation)
+					vx |= vy;
+					if constexpr (Quirks::ResetVF)
+					{
+						m_Registers[0xF] = 0;
+					}
+					break;
+
+				case 0x2: // 8XY2
+					// Sets VX to VX and VY. (bitwise AND operation)
+					vx &= vy;
+					if constexpr (Quirks::ResetVF)
+					{
+						m_Registers[0xF] = 0;
+					}
+					break;
+
+				case 0x3: // 8XY3
+					// Sets VX to VX xor VY
+					vx ^= vy;
+					if constexpr (Quirks::ResetVF)
+					{
+						m_Registers[0xF] = 0;
+					}
+					break;
+
+				case 0x4: // 8XY4
+				{
+					// Adds VY to VX. VF is set to 1 when there's a carry, and to 0 when there is not
+					uint16_t sum = vx + vy;
+					vx = static_cast<uint8_t>(sum);
+					m_Registers[0xF] = sum > 255 ? 1 : 0;
+					break;
+				}
+
+				case 0x5: // 8XY5
+				{
+					// VY is subtracted from VX. VF is set to 0 when there's a borrow, and 1 when there is not
+					uint8_t flag = vx >= vy ? 1 : 0;
+					vx -= vy;
+					m_Registers[0xF] = flag;
+					break;
+				}
+
+				case 0x6: // 8XY6
+				{
+					// Stores the least significant bit in VF and then shifts right by 1
+					uint8_t value = Quirks::ShiftUsesVY ? vy : vx;
+					vx = value >> 1;
+					m_Registers[0xF] = value & 0x1;
+					break;
+				}
+
+				case 0x7: // 8XY7
+				{
+					// Sets VX to VY minus VX. VF is set to 0 when there's a borrow, and 1 when there is not
+					uint8_t flag = vy >= vx ? 1 : 0;
+					vx = vy - vx;
+					m_Registers[0xF] = flag;
+					break;
+				}
+
+				case 0xE: // 8XYE
+				{
+					// Stores the most significant bit in VF and then shifts left by 1
+					uint8_t value = Quirks::ShiftUsesVY ? vy : vx;
+					vx = value << 1;
+					m_Registers[0xF] = value >> 7;
+					break;
+				}
+
+				default:
+					InvalidInstruction(opcode);
+			}
+			break;
+
+		case 0x9: // 9XY0
+			// Skips the next instruction if VX does not equal VY. (Usually the next instruction is a jump to skip a code block)
+			if (vx != vy)
+			{
+				SkipNextInstruction<Quirks>();
+			}
+			break;
+
+		case 0xA: // ANNN
+			// Sets I to the address NNN
+			m_IndexRegister = address;
+			break;
+
+		case 0xB: // BNNN
+			if constexpr (Quirks::JumpUsesVX)
+			{
+				// Jumps to the address XNN plus VX
+				m_ProgramCounter = address + vx;
+			}
+			else
+			{
+				// Jumps to the address NNN plus V0
+				m_ProgramCounter = address + m_Registers[0];
+			}
+			break;
+
+		case 0xC: // CXNN
+		{
+			// Sets VX to the result of a bitwise and operation on a random number (Typically: 0 to 255) and NN
+			vx = NextRandom(m_RandomState) & byte;
+			break;
+		}
+
+		case 0xD: // DXYN
+		{
+			// Draws a sprite at coordinate (VX, VY) that has a width of 8 pixels and a height of N pixels. 
+			// Each row of 8 pixels is read as bit-coded starting from m_Memory location I; I value does not change after the execution of this instruction. 
+			// As described above, VF is set to 1 if any screen pixels are flipped from set to unset when the sprite is drawn, and to 0 if that does not happen
+			if constexpr (Quirks::DisplayWait)
+			{
+				// Stall on this instruction until the next vertical blank
+				if (!m_VBlank)
+				{
+					m_ProgramCounter -= 2;
+					break;
+				}
+
+				m_VBlank = false;
+			}
+
+			uint8_t height = opcode & 0x000F;
+
+			// SUPER-CHIP draws a 16x16 sprite for DXY0
+			bool wide = false;
+			if constexpr (Quirks::SuperChipInstructions)
+			{
+				if (height == 0)
+				{
+					height = 16;
+					wide = true;
+				}
+			}
+
+			bool collision = VideoBuffer.DrawSprite<Quirks::ClipSprites>(vx, vy, m_Memory.GetPointer(m_IndexRegister), height, wide);
+			m_Registers[0xF] = collision ? 1 : 0;
+			CHIP8_INSTRUMENT(OnDraw(m_Memory.GetPointer(m_IndexRegister), height * (wide ? 2 : 1) * std::popcount(VideoBuffer.GetSelectedPlanes()), collision));
+			break;
+		}
+
+		case 0xE:
+			if (byte == 0x9E) // EX9E
+			{
+				// Skips the next instruction if the key stored in VX is pressed (usually the next instruction is a jump to skip a code block)
+				if (Keypad & (1u << (vx & 0xF)))
+				{
+					SkipNextInstruction<Quirks>();
+				}
+			}
+			else if (byte == 0xA1) // EXA1
+			{
+				// Skips the next instruction if the key stored in VX is not pressed (usually the next instruction is a jump to skip a code block)
+				if (!(Keypad & (1u << (vx & 0xF))))
+				{
+					SkipNextInstruction<Quirks>();
+				}
+			}
+			else
+			{
+				InvalidInstruction(opcode);
+			}
+			break;
+
+		case 0xF:
+			switch (byte)
+			{
+				case 0x00: // F000 NNNN
+					if (Quirks::XoChipInstructions && vx_register == 0)
+					{
+						// Sets I to the 16-bit address in the following word
+						m_IndexRegister = m_Memory.ReadWord(m_ProgramCounter);
+						m_ProgramCounter += 2;
+					}
+					else
+					{
+						InvalidInstruction(opcode);
+					}
+					break;
+
+				case 0x01: // FN01
+					if constexpr (Quirks::XoChipInstructions)
+					{
+						// Selects the drawing planes with bit mask N
+						VideoBuffer.SelectPlanes(vx_register);
+					}
+					else
+					{
+						InvalidInstruction(opcode);
+					}
+					break;
+
+				case 0x02: // F002
+					if (Quirks::XoChipInstructions && vx_register == 0)
+					{
+						// Loads the 16 byte audio pattern from m_Memory, starting at address I
+						for (unsigned i = 0; i < AUDIO_PATTERN_SIZE; ++i)
+						{
+							m_AudioPattern[i] = m_Memory[m_IndexRegister + i];
+						}
+					}
+					else
+					{
+						InvalidInstruction(opcode);
+					}
+					break;
+
+				case 0x07: // FX07
+					// Sets VX to the value of the delay timer
+					vx = m_DelayTimer;
+					break;
+
+				case 0x0A: // FX0A
+				{
+					// A key press is awaited, and then stored in VX (blocking operation, all instruction halted until next key event)
+					// Like the COSMAC VIP the key is only accepted once it has been released again
+					uint16_t released = m_KeyWaitMask & ~Keypad;
+					m_KeyWaitMask |= Keypad;
+
+					if (released == 0)
+					{
+						m_ProgramCounter -= 2;
+					}
+					else
+					{
+						// Index of the lowest released key
+						uint8_t key = 0;
+						while ((released & 1) == 0)
+						{
+							released >>= 1;
+							++key;
+						}
+
+						vx = key;
+						m_KeyWaitMask = 0;
+					}
+					break;
+				}
+
+				case 0x15: // FX15
+					// Sets the delay timer to VX
+					m_DelayTimer = vx;
+					break;
+
+				case 0x18: // FX18
+					// Sets the sound timer to VX
+					m_SoundTimer = vx;
+					break;
+
+				case 0x1E: // FX1E
+					// Adds VX to I. VF is not affected
+					m_IndexRegister += vx;
+					break;
+
+				case 0x29: // FX29
+					// Sets I to the location of the sprite for the character in VX. Characters 0-F (in hexadecimal) are represented by a 4x5 font
+					m_IndexRegister = FONTSET_START_ADDRESS + (5 * (vx & 0xF));
+					break;
+
+				case 0x30: // FX30
+					if constexpr (Quirks::SuperChipInstructions)
+					{
+						// Sets I to the location of the 8x10 sprite for the character in VX
+						m_IndexRegister = BIG_FONTSET_START_ADDRESS + (10 * (vx & 0xF));
+					}
+					else
+					{
+						InvalidInstruction(opcode);
+					}
+					break;
+
+				case 0x33: // FX33
+				{
+					// Stores the binary-coded decimal representation of VX, with the hundreds digit in m_Memory at location in I, the tens digit at location I+1, and the ones digit at location I+2
+					uint8_t value = vx;
+
+					// Ones-place
+					m_Memory.Write(m_IndexRegister + 2, value % 10);
+					value /= 10;
+
+					// Tens-place
+					m_Memory.Write(m_IndexRegister + 1, value % 10);
+					value /= 10;
+
+					// Hundreds-place
+					m_Memory.Write(m_IndexRegister, value % 10);
+					break;
+				}
+
+				case 0x3A: // FX3A
+					if constexpr (Quirks::XoChipInstructions)
+					{
+						// Sets the audio pattern playback pitch to VX
+						m_Pitch = vx;
+					}
+					else
+					{
+						InvalidInstruction(opcode);
+					}
+					break;
+
+				case 0x55: // FX55
+					// Stores from V0 to VX (including VX) in m_Memory, starting at address I. The offset from I is increased by 1 for each value written
+					for (uint8_t i = 0; i <= vx_register; ++i)
+					{
+						m_Memory.Write(m_IndexRegister + i, m_Registers[i]);
+					}
+
+					if constexpr (Quirks::IncrementIndex)
+					{
+						m_IndexRegister += vx_register + 1;
+					}
+					break;
+
+				case 0x65: // FX65
+					// Fills from V0 to VX (including VX) with values from m_Memory, starting at address I. The offset from I is increased by 1 for each value read
+					for (uint8_t i = 0; i <= vx_register; ++i)
+					{
+						m_Registers[i] = m_Memory[m_IndexRegister + i];
+					}
+
+					if constexpr (Quirks::IncrementIndex)
+					{
+						m_IndexRegister += vx_register + 1;
+					}
+					break;
+
+				case 0x75: // FX75
+					if constexpr (Quirks::SuperChipInstructions)
+					{
+						// Stores V0 to VX in the RPL user flags
+						for (uint8_t i = 0; i <= vx_register; ++i)
+						{
+							m_RplFlags[i] = m_Registers[i];
+						}
+					}
+					else
+					{
+						InvalidInstruction(opcode);
+					}
+					break;
+
+				case 0x85: // FX85
+					if constexpr (Quirks::SuperChipInstructions)
+					{
+						// Fills V0 to VX from the RPL user flags
+						for (uint8_t i = 0; i <= vx_register; ++i)
+						{
+							m_Registers[i] = m_RplFlags[i];
+						}
+					}
+					else
+					{
+						InvalidInstruction(opcode);
+					}
+					break;
+
+				default:
+					InvalidInstruction(opcode);
+			}
+			break;
+	}
+}
+
+#undef CHIP8_INSTRUMENT
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Chip8.h"
+
+// Complete machine state of a Chip8, for engines that run outside the class (the reference interpreter)
+// and for anything that needs to capture or compare whole machines
+struct Chip8State
+{
+	QuirkProfile Profile = QuirkProfile::Chip8;
+
+	std::array<uint8_t, MEMORY_SIZE> Memory = {};
+	std::array<uint8_t, REGISTER_COUNT> Registers = {};
+	uint16_t IndexRegister = 0;
+	uint16_t ProgramCounter = ROM_START_ADDRESS;
+
+	std::array<uint16_t, STACK_LEVELS> Stack = {};
+	uint8_t StackPointer = 0;
+
+	uint8_t DelayTimer = 0;
+	uint8_t SoundTimer = 0;
+
+	uint16_t Keypad = 0;
+	uint16_t KeyWaitMask = 0;
+	bool VBlank = false;
+	bool Halted = false;
+	uint32_t RandomState = 0;
+
+	std::array<uint8_t, RPL_FLAG_COUNT> RplFlags = {};
+	std::array<uint8_t, AUDIO_PATTERN_SIZE> AudioPattern = {};
+	uint8_t Pitch = 64;
+
+	uint64_t CycleCount = 0;
+
+	Display VideoBuffer;
+
+	bool operator==(const Chip8State& other) const = default;
+};
@@ -0,0 +1,290 @@
+#include "Debugger.h"
+#include <cstdio>
+#include <exception>
+
+void Debugger::SetBreakpoint(uint16_t address, bool enabled)
+{
+	if (HasBreakpoint(address) == enabled)
+	{
+		return;
+	}
+
+	m_Breakpoints[address >> 7] ^= 1ull << ((address >> 1) & 63);
+	if (enabled)
+		++m_BreakpointCount;
+	else
+		--m_BreakpointCount;
+}
+
+void Debugger::ClearBreakpoints()
+{
+	m_Breakpoints = {};
+	m_BreakpointCount = 0;
+}
+
+void Debugger::AddWatchpoint(uint16_t address, uint16_t size, WatchType type)
+{
+	m_Watchpoints.push_back({ address, size, type });
+}
+
+void Debugger::ClearWatchpoints()
+{
+	m_Watchpoints.clear();
+}
+
+void Debugger::AddRegisterCondition(uint8_t reg)
+{
+	m_Conditions.push_back({ reg, true, 0 });
+}
+
+void Debugger::AddRegisterCondition(uint8_t reg, uint16_t value)
+{
+	m_Conditions.push_back({ reg, false, value });
+}
+
+void Debugger::ClearRegisterConditions()
+{
+	m_Conditions.clear();
+}
+
+DebugStop Debugger::Run(uint64_t cycles)
+{
+	return RunUntil(cycles, -1);
+}
+
+DebugStop Debugger::Step()
+{
+	DebugStop stop;
+	stop.Reason = Execute() ? StopReason::Step : StopReason::InvalidInstruction;
+	stop.ProgramCounter = m_Chip8.GetProgramCounter();
+	stop.Cycles = 1;
+	return Stopped(stop);
+}
+
+DebugStop Debugger::StepOver(uint64_t max_cycles)
+{
+	const auto& memory = m_Chip8.GetMemory();
+	uint16_t pc = m_Chip8.GetProgramCounter();
+	if ((memory[pc] & 0xF0) != 0x20)
+	{
+		return Step();
+	}
+
+	// Run the call until the stack is back where it is now
+	return RunUntil(max_cycles, m_Chip8.GetStackPointer());
+}
+
+DebugStop Debugger::StepOut(uint64_t max_cycles)
+{
+	if (m_Chip8.GetStackPointer() == 0)
+	{
+		return Run(max_cycles);
+	}
+
+	return RunUntil(max_cycles, m_Chip8.GetStackPointer() - 1);
+}
+
+DebugStop Debugger::RunUntil(uint64_t cycles, int return_depth)
+{
+	// Pick the loop once for the whole run rather than testing what is armed every instruction
+	const bool breakpoints = m_BreakpointCount != 0;
+	const bool watchpoints = !m_Watchpoints.empty();
+	const bool conditions = !m_Conditions.empty() || return_depth >= 0;
+
+	switch ((breakpoints ? 4 : 0) | (watchpoints ? 2 : 0) | (conditions ? 1 : 0))
+	{
+		case 0: return RunLoop<false, false, false>(cycles, return_depth);
+		case 1: return RunLoop<false, false, true>(cycles, return_depth);
+		case 2: return RunLoop<false, true, false>(cycles, return_depth);
+		case 3: return RunLoop<false, true, true>(cycles, return_depth);
+		case 4: return RunLoop<true, false, false>(cycles, return_depth);
+		case 5: return RunLoop<true, false, true>(cycles, return_depth);
+		case 6: return RunLoop<true, true, false>(cycles, return_depth);
+		default: return RunLoop<true, true, true>(cycles, return_depth);
+	}
+}
+
+template <bool Breakpoints, bool Watchpoints, bool Conditions>
+DebugStop Debugger::RunLoop(uint64_t cycles, int return_depth)
+{
+	DebugStop stop;
+
+	// Values the conditions last saw
+	uint16_t previous[DEBUG_REGISTER_I + 1] = {};
+	if constexpr (Conditions)
+	{
+		for (const RegisterCondition& condition : m_Conditions)
+		{
+			previous[condition.Register] = ReadRegister(condition.Register);
+		}
+	}
+
+	// Resuming where a breakpoint stopped executes the instruction it stopped on. A watchpoint stop there came after the
+	// breakpoint check, so resuming from it skips both. Anything else, such as a step or a fresh run, checks everything
+	const bool resuming = m_LastStopCycle == m_Chip8.GetCycleCount() && m_LastStopPc == m_Chip8.GetProgramCounter();
+	const bool skip_breakpoint = resuming && (m_LastStop == StopReason::Breakpoint || m_LastStop == StopReason::Watchpoint);
+	const bool skip_watchpoint = resuming && m_LastStop == StopReason::Watchpoint;
+
+	for (; stop.Cycles < cycles; ++stop.Cycles)
+	{
+		if constexpr (Breakpoints)
+		{
+			if (!(stop.Cycles == 0 && skip_breakpoint) && HasBreakpoint(m_Chip8.GetProgramCounter()))
+			{
+				stop.Reason = StopReason::Breakpoint;
+				break;
+			}
+		}
+
+		if constexpr (Watchpoints)
+		{
+			MemoryAccess access = stop.Cycles == 0 && skip_watchpoint ? MemoryAccess() : GetMemoryAccess(m_Chip8);
+			if (access.Type != AccessType::None)
+			{
+				const uint8_t access_type = static_cast<uint8_t>(access.Type == AccessType::Read ? WatchType::Read : WatchType::Write);
+				for (const Watchpoint& watchpoint : m_Watchpoints)
+				{
+					bool type = (static_cast<uint8_t>(watchpoint.Type) & access_type) != 0;
+					bool overlap = access.Address < watchpoint.Address + watchpoint.Size && watchpoint.Address < access.Address + access.Size;
+					if (type && overlap)
+					{
+						stop.Reason = StopReason::Watchpoint;
+						stop.Access = access;
+						break;
+					}
+				}
+
+				if (stop.Reason != StopReason::None)
+				{
+					break;
+				}
+			}
+		}
+
+		if (!Execute())
+		{
+			++stop.Cycles;
+			stop.Reason = StopReason::InvalidInstruction;
+			break;
+		}
+
+		if constexpr (Conditions)
+		{
+			if (return_depth >= 0 && m_Chip8.GetStackPointer() == return_depth)
+			{
+				++stop.Cycles;
+				stop.Reason = StopReason::Step;
+				break;
+			}
+
+			for (const RegisterCondition& condition : m_Conditions)
+			{
+				uint16_t value = ReadRegister(condition.Register);
+				if (value != previous[condition.Register] && (condition.AnyChange || value == condition.Value))
+				{
+					stop.Reason = StopReason::RegisterCondition;
+					stop.Register = condition.Register;
+				}
+
+				previous[condition.Register] = value;
+			}
+
+			if (stop.Reason != StopReason::None)
+			{
+				++stop.Cycles;
+				break;
+			}
+		}
+	}
+
+	stop.ProgramCounter = m_Chip8.GetProgramCounter();
+	return Stopped(stop);
+}
+
+bool Debugger::Execute()
+{
+	try
+	{
+		m_Chip8.Cycle();
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+
+	if (++m_FrameCycles == m_CyclesPerFrame)
+	{
+		m_Chip8.UpdateTimers();
+		m_FrameCycles = 0;
+	}
+
+	return true;
+}
+
+DebugStop Debugger::Stopped(const DebugStop& stop)
+{
+	m_LastStop = stop.Reason;
+	m_LastStopCycle = m_Chip8.GetCycleCount();
+	m_LastStopPc = stop.ProgramCounter;
+	return stop;
+}
+
+uint16_t Debugger::ReadRegister(uint8_t reg) const
+{
+	return reg == DEBUG_REGISTER_I ? m_Chip8.GetIndexRegister() : m_Chip8.GetRegisters()[reg & 0xF];
+}
+
+std::string Debugger::DumpRegisters() const
+{
+	char line[128];
+	std::string text;
+
+	std::snprintf(line, sizeof(line), "PC=%04X I=%04X DT=%02X ST=%02X SP=%X\n", m_Chip8.GetProgramCounter(), m_Chip8.GetIndexRegister(),
+		m_Chip8.GetDelayTimer(), m_Chip8.GetSoundTimer(), m_Chip8.GetStackPointer());
+	text += line;
+
+	for (unsigned i = 0; i < REGISTER_COUNT; ++i)
+	{
+		std::snprintf(line, sizeof(line), "V%X=%02X%c", i, m_Chip8.GetRegisters()[i], i % 8 == 7 ? '\n' : ' ');
+		text += line;
+	}
+
+	text += "Stack:";
+	for (unsigned i = 0; i < m_Chip8.GetStackPointer(); ++i)
+	{
+		std::snprintf(line, sizeof(line), " %04X", m_Chip8.GetStack()[i]);
+		text += line;
+	}
+	text += "\n";
+
+	return text;
+}
+
+std::string Debugger::DumpMemory(uint16_t address, unsigned length) const
+{
+	const auto& memory = m_Chip8.GetMemory();
+	char line[128];
+	std::string text;
+
+	for (unsigned offset = 0; offset < length; offset += 16)
+	{
+		unsigned start = address + offset;
+		int used = std::snprintf(line, sizeof(line), "%04X ", start & 0xFFFF);
+		for (unsigned i = 0; i < 16; ++i)
+		{
+			used += i < length - offset ? std::snprintf(line + used, sizeof(line) - used, " %02X", memory[(start + i) & 0xFFFF]) : std::snprintf(line + used, sizeof(line) - used, "   ");
+		}
+
+		used += std::snprintf(line + used, sizeof(line) - used, "  ");
+		for (unsigned i = 0; i < 16 && i < length - offset; ++i)
+		{
+			uint8_t byte = memory[(start + i) & 0xFFFF];
+			line[used++] = byte >= 0x20 && byte < 0x7F ? static_cast<char>(byte) : '.';
+		}
+
+		line[used++] = '\n';
+		text.append(line, used);
+	}
+
+	return text;
+}
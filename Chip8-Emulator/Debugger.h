@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Chip8.h"
+#include "MemoryAccess.h"
+#include <cstdint>
+#include <array>
+#include <string>
+#include <vector>
+
+// One breakpoint bit per instruction word of the 64KB address space (4KB). An odd PC shares its bit with the word it starts in
+const unsigned int BREAKPOINT_WORDS = 0x10000 / 2 / 64;
+
+// Register a condition watches. V0-VF are 0x0-0xF
+const uint8_t DEBUG_REGISTER_I = 0x10;
+
+enum class WatchType : uint8_t
+{
+	Read = 1,
+	Write = 2,
+	ReadWrite = 3
+};
+
+enum class StopReason : uint8_t
+{
+	// Ran every cycle asked for
+	None,
+	Breakpoint,
+	Watchpoint,
+	RegisterCondition,
+
+	// A step, step over or step out finished
+	Step,
+
+	// The interpreter threw on an invalid instruction
+	InvalidInstruction
+};
+
+struct DebugStop
+{
+	StopReason Reason = StopReason::None;
+
+	// PC of the next instruction to execute
+	uint16_t ProgramCounter = 0;
+
+	// Watchpoint: the access that hit. Register condition: the register
+	MemoryAccess Access;
+	uint8_t Register = 0;
+
+	// Instructions executed before stopping
+	uint64_t Cycles = 0;
+};
+
+// Breakpoints, watchpoints, register conditions and stepping for a Chip8. Runs the interpreter itself, ticking the timers every
+// cycles_per_frame instructions, so stepping keeps the same timing as running.
+// The run loop is specialised on which kinds of checks are armed: with nothing armed it is the plain Cycle() loop
+class Debugger
+{
+public:
+	Debugger(Chip8& chip8, unsigned cycles_per_frame) : m_Chip8(chip8), m_CyclesPerFrame(cycles_per_frame ? cycles_per_frame : 1) {}
+
+	// Stop before executing the instruction at address
+	void SetBreakpoint(uint16_t address, bool enabled = true);
+	inline bool HasBreakpoint(uint16_t address) const { return (m_Breakpoints[address >> 7] >> ((address >> 1) & 63)) & 1; }
+	void ClearBreakpoints();
+
+	// Stop before an instruction reads or writes (through I) any of size bytes from address
+	void AddWatchpoint(uint16_t address, uint16_t size, WatchType type);
+	void ClearWatchpoints();
+
+	// Stop after an instruction changes a register, or only when it changes to value
+	void AddRegisterCondition(uint8_t reg);
+	void AddRegisterCondition(uint8_t reg, uint16_t value);
+	void ClearRegisterConditions();
+
+	// Run up to cycles instructions, stopping early on anything armed. Resuming from a breakpoint or watchpoint stop skips only
+	// the check that stopped it, so a stopped program can be continued
+	DebugStop Run(uint64_t cycles);
+
+	// Execute one instruction
+	DebugStop Step();
+
+	// Execute one instruction, running any subroutine it calls to completion
+	DebugStop StepOver(uint64_t max_cycles = UINT64_MAX);
+
+	// Run until the current subroutine returns
+	DebugStop StepOut(uint64_t max_cycles = UINT64_MAX);
+
+	// PC, I, V0-VF, timers and the call stack
+	std::string DumpRegisters() const;
+
+	// Hex and ASCII, 16 bytes a line
+	std::string DumpMemory(uint16_t address, unsigned length) const;
+
+private:
+	struct Watchpoint
+	{
+		uint32_t Address;
+		uint32_t Size;
+		WatchType Type;
+	};
+
+	struct RegisterCondition
+	{
+		uint8_t Register;
+
+		// Any change, or only a change to Value
+		bool AnyChange;
+		uint16_t Value;
+	};
+
+	// Run until cycles run out, something armed fires or the stack pointer drops to return_depth
+	DebugStop RunUntil(uint64_t cycles, int return_depth);
+
+	template <bool Breakpoints, bool Watchpoints, bool Conditions>
+	DebugStop RunLoop(uint64_t cycles, int return_depth);
+
+	// Execute one instruction and keep the frame timing. Returns false if the instruction was invalid
+	bool Execute();
+
+	// Remember where a stop left the machine, and return it
+	DebugStop Stopped(const DebugStop& stop);
+
+	uint16_t ReadRegister(uint8_t reg) const;
+
+	Chip8& m_Chip8;
+	unsigned m_CyclesPerFrame;
+
+	// Instructions until the next timer tick
+	unsigned m_FrameCycles = 0;
+
+	// The last stop and the machine's cycle count at it. Resuming from the same place executes the instruction a breakpoint or
+	// watchpoint stopped before
+	StopReason m_LastStop = StopReason::None;
+	uint64_t m_LastStopCycle = 0;
+	uint16_t m_LastStopPc = 0;
+
+	std::array<uint64_t, BREAKPOINT_WORDS> m_Breakpoints = {};
+	unsigned m_BreakpointCount = 0;
+
+	std::vector<Watchpoint> m_Watchpoints;
+	std::vector<RegisterCondition> m_Conditions;
+};
@@ -0,0 +1,98 @@
+#include "Display.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DISPLAY_SSE2
+#endif
+
+template <bool Clip>
+bool Display::DrawSpritesOutOfLine(unsigned x, unsigned y, const uint8_t* sprite, unsigned rows, bool wide)
+{
+	return DrawSprites<Clip>(x, y, sprite, rows, wide);
+}
+
+template bool Display::DrawSpritesOutOfLine<true>(unsigned x, unsigned y, const uint8_t* sprite, unsigned rows, bool wide);
+template bool Display::DrawSpritesOutOfLine<false>(unsigned x, unsigned y, const uint8_t* sprite, unsigned rows, bool wide);
+
+void Display::ScrollRight4Wide(Plane& plane)
+{
+#ifdef DISPLAY_SSE2
+	// One 128-bit row per register: shift both words, then carry the low nibble of the first word into the second
+	__m128i* rows = reinterpret_cast<__m128i*>(plane.data());
+	for (unsigned y = 0; y < HIRES_VIDEO_HEIGHT; ++y)
+	{
+		__m128i row = _mm_loadu_si128(rows + y);
+		__m128i carry = _mm_slli_si128(_mm_slli_epi64(row, 60), 8);
+		_mm_storeu_si128(rows + y, _mm_or_si128(_mm_srli_epi64(row, 4), carry));
+	}
+#else
+	for (unsigned y = 0; y < HIRES_VIDEO_HEIGHT; ++y)
+	{
+		plane[y][1] = (plane[y][1] >> 4) | (plane[y][0] << 60);
+		plane[y][0] >>= 4;
+	}
+#endif
+}
+
+void Display::ScrollLeft4Wide(Plane& plane)
+{
+#ifdef DISPLAY_SSE2
+	__m128i* rows = reinterpret_cast<__m128i*>(plane.data());
+	for (unsigned y = 0; y < HIRES_VIDEO_HEIGHT; ++y)
+	{
+		__m128i row = _mm_loadu_si128(rows + y);
+		__m128i carry = _mm_srli_si128(_mm_srli_epi64(row, 60), 8);
+		_mm_storeu_si128(rows + y, _mm_or_si128(_mm_slli_epi64(row, 4), carry));
+	}
+#else
+	for (unsigned y = 0; y < HIRES_VIDEO_HEIGHT; ++y)
+	{
+		plane[y][0] = (plane[y][0] << 4) | (plane[y][1] >> 60);
+		plane[y][1] <<= 4;
+	}
+#endif
+}
+
+void Display::ToRGBA(uint32_t* pixels, unsigned width, unsigned height) const
+{
+	const unsigned source_width = GetWidth();
+	const unsigned source_height = GetHeight();
+	const unsigned scale_x = width / source_width;
+	const unsigned scale_y = height / source_height;
+
+	for (unsigned source_y = 0; source_y < source_height; ++source_y)
+	{
+		// Composite the planes a word at a time into the first output row for this source row
+		uint32_t* line = pixels + source_y * scale_y * width;
+		for (unsigned word = 0; word < source_width / 64; ++word)
+		{
+			uint64_t bits[DISPLAY_PLANE_COUNT];
+			for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+			{
+				bits[plane] = m_Planes[plane][source_y][word];
+			}
+
+			for (unsigned bit = 0; bit < 64; ++bit)
+			{
+				unsigned color = 0;
+				for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+				{
+					color |= ((bits[plane] >> (63 - bit)) & 1) << plane;
+				}
+
+				uint32_t* out = line + (word * 64 + bit) * scale_x;
+				for (unsigned i = 0; i < scale_x; ++i)
+				{
+					out[i] = DISPLAY_PALETTE[color];
+				}
+			}
+		}
+
+		// Repeat it for the rest of the scaled rows
+		for (unsigned i = 1; i < scale_y; ++i)
+		{
+			std::memcpy(line + i * width, line, width * sizeof(uint32_t));
+		}
+	}
+}
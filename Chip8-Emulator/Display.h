@@ -0,0 +1,331 @@
+#pragma once
+
+#include "Hash.h"
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <type_traits>
+
+const unsigned int VIDEO_HEIGHT = 32;
+const unsigned int VIDEO_WIDTH = 64;
+const unsigned int HIRES_VIDEO_HEIGHT = 64;
+const unsigned int HIRES_VIDEO_WIDTH = 128;
+
+// Each row is packed one bit per pixel into two 64-bit words, leftmost pixel in the most significant bit of the first word.
+// Low resolution only uses the first word of the first 32 rows
+const unsigned int DISPLAY_ROW_WORDS = 2;
+
+// XO-CHIP bitplanes. A pixel's colour is the plane bits combined, plane 0 being the low bit
+const unsigned int DISPLAY_PLANE_COUNT = 2;
+const unsigned int DISPLAY_COLOR_COUNT = 1 << DISPLAY_PLANE_COUNT;
+
+// 32-bit colours for ToRGBA and the CPU filters: off, plane 0, plane 1, both planes
+const uint32_t DISPLAY_PALETTE[DISPLAY_COLOR_COUNT] = { 0x00000000, 0xFFFFFFFF, 0xFF808080, 0xFFC0C0C0 };
+
+// Everything the interpreter calls is constexpr so programs can run in constant evaluation (see Chip8)
+class Display
+{
+public:
+	Display() = default;
+
+	// Clear every pixel on the selected planes
+	constexpr void Clear();
+
+	// Switch between 64x32 and 128x64. Clears every plane
+	constexpr void SetHighResolution(bool enabled);
+	constexpr bool IsHighResolution() const { return m_HighResolution; }
+
+	// Select the planes drawing, clearing and scrolling apply to (bit mask, XO-CHIP FN01)
+	constexpr void SelectPlanes(uint8_t mask) { m_PlaneMask = mask & ((1 << DISPLAY_PLANE_COUNT) - 1); }
+	constexpr uint8_t GetSelectedPlanes() const { return m_PlaneMask; }
+
+	// Current resolution
+	constexpr unsigned GetWidth() const { return m_HighResolution ? HIRES_VIDEO_WIDTH : VIDEO_WIDTH; }
+	constexpr unsigned GetHeight() const { return m_HighResolution ? HIRES_VIDEO_HEIGHT : VIDEO_HEIGHT; }
+
+	// Colour index of a single pixel (0 is off)
+	constexpr uint8_t GetPixel(unsigned x, unsigned y) const
+	{
+		uint8_t color = 0;
+		for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+		{
+			color |= ((m_Planes[plane][y][x >> 6] >> (63 - (x & 63))) & 1) << plane;
+		}
+
+		return color;
+	}
+
+	// Single pixel of one plane. Slow, for code that wants to work pixel by pixel rather than on packed rows
+	constexpr bool GetPlanePixel(unsigned plane, unsigned x, unsigned y) const
+	{
+		return (m_Planes[plane][y][x >> 6] >> (63 - (x & 63))) & 1;
+	}
+
+	constexpr void SetPlanePixel(unsigned plane, unsigned x, unsigned y, bool on)
+	{
+		uint64_t bit = 1ull << (63 - (x & 63));
+		uint64_t& word = m_Planes[plane][y][x >> 6];
+		word = on ? word | bit : word & ~bit;
+	}
+
+	// XOR a sprite onto each selected plane. Sprites are 8 pixels wide (one byte per row) or 16 pixels wide (two bytes per row),
+	// with the data for each selected plane following on from the previous one.
+	// The position wraps, pixels past the edge are clipped or wrapped depending on Clip. Returns true on collision
+	template <bool Clip>
+	constexpr bool DrawSprite(unsigned x, unsigned y, const uint8_t* sprite, unsigned rows, bool wide);
+
+	// Scroll the selected planes by N pixels, blanking the pixels scrolled in
+	constexpr void ScrollDown(unsigned pixels);
+	constexpr void ScrollUp(unsigned pixels);
+	constexpr void ScrollRight4();
+	constexpr void ScrollLeft4();
+
+	// Expand to 32-bit pixels. The output size must be a multiple of the current resolution
+	void ToRGBA(uint32_t* pixels, unsigned width, unsigned height) const;
+
+	// Packed rows
+	constexpr const uint64_t* GetRow(unsigned plane, unsigned y) const { return m_Planes[plane][y].data(); }
+
+	// Hash of every pixel and the resolution, for comparing frames between runs
+	inline uint64_t GetHash() const { return XXHash64(m_Planes.data(), sizeof(m_Planes), m_HighResolution ? 1 : 0); }
+
+	bool operator==(const Display& other) const = default;
+
+private:
+	using Plane = std::array<std::array<uint64_t, DISPLAY_ROW_WORDS>, HIRES_VIDEO_HEIGHT>;
+
+	// DrawSprite's work. At run time it goes through an out of line copy, so it isn't inlined into every interpreter loop
+	template <bool Clip>
+	constexpr bool DrawSprites(unsigned x, unsigned y, const uint8_t* sprite, unsigned rows, bool wide);
+
+	template <bool Clip>
+	bool DrawSpritesOutOfLine(unsigned x, unsigned y, const uint8_t* sprite, unsigned rows, bool wide);
+
+	template <bool Clip>
+	constexpr bool DrawPlane(Plane& plane, unsigned x, unsigned y, const uint8_t* sprite, unsigned rows, bool wide);
+
+	constexpr void ScrollRight4(Plane& plane);
+	constexpr void ScrollLeft4(Plane& plane);
+
+	// SSE2 versions of the high resolution horizontal scrolls, used outside constant evaluation
+	static void ScrollRight4Wide(Plane& plane);
+	static void ScrollLeft4Wide(Plane& plane);
+
+	std::array<Plane, DISPLAY_PLANE_COUNT> m_Planes = {};
+	uint8_t m_PlaneMask = 0x1;
+	bool m_HighResolution = false;
+};
+
+constexpr void Display::Clear()
+{
+	for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+	{
+		if (m_PlaneMask & (1 << plane))
+		{
+			m_Planes[plane] = {};
+		}
+	}
+}
+
+constexpr void Display::SetHighResolution(bool enabled)
+{
+	m_HighResolution = enabled;
+	m_Planes = {};
+}
+
+template <bool Clip>
+constexpr bool Display::DrawSprite(unsigned x, unsigned y, const uint8_t* sprite, unsigned rows, bool wide)
+{
+	if (std::is_constant_evaluated())
+	{
+		return DrawSprites<Clip>(x, y, sprite, rows, wide);
+	}
+
+	return DrawSpritesOutOfLine<Clip>(x, y, sprite, rows, wide);
+}
+
+template <bool Clip>
+constexpr bool Display::DrawSprites(unsigned x, unsigned y, const uint8_t* sprite, unsigned rows, bool wide)
+{
+	const unsigned sprite_size = rows * (wide ? 2 : 1);
+
+	bool collision = false;
+	for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+	{
+		if (m_PlaneMask & (1 << plane))
+		{
+			collision |= DrawPlane<Clip>(m_Planes[plane], x, y, sprite, rows, wide);
+			sprite += sprite_size;
+		}
+	}
+
+	return collision;
+}
+
+template <bool Clip>
+constexpr bool Display::DrawPlane(Plane& plane, unsigned x, unsigned y, const uint8_t* sprite, unsigned rows, bool wide)
+{
+	const unsigned width = GetWidth();
+	const unsigned height = GetHeight();
+	const unsigned sprite_width = wide ? 16 : 8;
+
+	// The starting position always wraps
+	x %= width;
+	y %= height;
+
+	uint64_t collision = 0;
+	for (unsigned row = 0; row < rows; ++row)
+	{
+		unsigned line_y = y + row;
+		if (line_y >= height)
+		{
+			if constexpr (Clip)
+			{
+				break;
+			}
+
+			line_y -= height;
+		}
+
+		// Sprite row left aligned in a word
+		uint64_t bits = wide ? ((sprite[row * 2] << 8) | sprite[row * 2 + 1]) : sprite[row];
+		bits <<= 64 - sprite_width;
+
+		// Shift the sprite row into place across the packed row. Bits pushed past the right edge are dropped or wrapped to the left
+		uint64_t mask0 = 0;
+		uint64_t mask1 = 0;
+		if (!m_HighResolution)
+		{
+			mask0 = bits >> x;
+			if constexpr (!Clip)
+			{
+				mask0 |= x ? bits << (64 - x) : 0;
+			}
+		}
+		else if (x < 64)
+		{
+			mask0 = bits >> x;
+			mask1 = x ? bits << (64 - x) : 0;
+		}
+		else
+		{
+			unsigned shift = x - 64;
+			mask1 = bits >> shift;
+			if constexpr (!Clip)
+			{
+				mask0 = shift ? bits << (64 - shift) : 0;
+			}
+		}
+
+		// Any sprite pixel landing on a set pixel is a collision, then XOR the whole row at once
+		auto& line = plane[line_y];
+		collision |= (line[0] & mask0) | (line[1] & mask1);
+		line[0] ^= mask0;
+		line[1] ^= mask1;
+	}
+
+	return collision != 0;
+}
+
+constexpr void Display::ScrollDown(unsigned pixels)
+{
+	const unsigned height = GetHeight();
+	pixels = pixels < height ? pixels : height;
+
+	for (unsigned index = 0; index < DISPLAY_PLANE_COUNT; ++index)
+	{
+		if (m_PlaneMask & (1 << index))
+		{
+			Plane& plane = m_Planes[index];
+
+			// Rows are contiguous so a scroll is one move
+			std::copy_backward(plane.begin(), plane.begin() + (height - pixels), plane.begin() + height);
+			std::fill(plane.begin(), plane.begin() + pixels, Plane::value_type {});
+		}
+	}
+}
+
+constexpr void Display::ScrollUp(unsigned pixels)
+{
+	const unsigned height = GetHeight();
+	pixels = pixels < height ? pixels : height;
+
+	for (unsigned index = 0; index < DISPLAY_PLANE_COUNT; ++index)
+	{
+		if (m_PlaneMask & (1 << index))
+		{
+			Plane& plane = m_Planes[index];
+
+			std::copy(plane.begin() + pixels, plane.begin() + height, plane.begin());
+			std::fill(plane.begin() + (height - pixels), plane.begin() + height, Plane::value_type {});
+		}
+	}
+}
+
+constexpr void Display::ScrollRight4()
+{
+	for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+	{
+		if (m_PlaneMask & (1 << plane))
+		{
+			ScrollRight4(m_Planes[plane]);
+		}
+	}
+}
+
+constexpr void Display::ScrollLeft4()
+{
+	for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+	{
+		if (m_PlaneMask & (1 << plane))
+		{
+			ScrollLeft4(m_Planes[plane]);
+		}
+	}
+}
+
+constexpr void Display::ScrollRight4(Plane& plane)
+{
+	if (!m_HighResolution)
+	{
+		for (unsigned y = 0; y < VIDEO_HEIGHT; ++y)
+		{
+			plane[y][0] >>= 4;
+		}
+	}
+	else if (!std::is_constant_evaluated())
+	{
+		ScrollRight4Wide(plane);
+	}
+	else
+	{
+		for (unsigned y = 0; y < HIRES_VIDEO_HEIGHT; ++y)
+		{
+			plane[y][1] = (plane[y][1] >> 4) | (plane[y][0] << 60);
+			plane[y][0] >>= 4;
+		}
+	}
+}
+
+constexpr void Display::ScrollLeft4(Plane& plane)
+{
+	if (!m_HighResolution)
+	{
+		for (unsigned y = 0; y < VIDEO_HEIGHT; ++y)
+		{
+			plane[y][0] <<= 4;
+		}
+	}
+	else if (!std::is_constant_evaluated())
+	{
+		ScrollLeft4Wide(plane);
+	}
+	else
+	{
+		for (unsigned y = 0; y < HIRES_VIDEO_HEIGHT; ++y)
+		{
+			plane[y][0] = (plane[y][0] << 4) | (plane[y][1] >> 60);
+			plane[y][1] <<= 4;
+		}
+	}
+}
@@ -0,0 +1,322 @@
+#include "FrameFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRAME_FILTER_SSE2
+#endif
+
+namespace
+{
+	uint16_t ToMultiplier(double fraction)
+	{
+		return static_cast<uint16_t>(std::lround(std::clamp(fraction, 0.0, 1.0) * 256.0));
+	}
+
+	// Scale2x: each pixel becomes 2x2, a corner taking the colour of the two neighbours it touches when they agree
+	void Scale2x(const uint8_t* source, unsigned width, unsigned height, uint8_t* destination)
+	{
+		for (unsigned y = 0; y < height; ++y)
+		{
+			const uint8_t* above = source + (y > 0 ? y - 1 : y) * width;
+			const uint8_t* row = source + y * width;
+			const uint8_t* below = source + (y + 1 < height ? y + 1 : y) * width;
+			uint8_t* out = destination + y * 2 * width * 2;
+
+			for (unsigned x = 0; x < width; ++x)
+			{
+				uint8_t a = above[x];
+				uint8_t b = row[x + 1 < width ? x + 1 : x];
+				uint8_t c = row[x > 0 ? x - 1 : x];
+				uint8_t d = below[x];
+				uint8_t p = row[x];
+
+				bool different = a != d && c != b;
+				out[x * 2] = different && c == a ? a : p;
+				out[x * 2 + 1] = different && a == b ? b : p;
+				out[width * 2 + x * 2] = different && c == d ? c : p;
+				out[width * 2 + x * 2 + 1] = different && b == d ? d : p;
+			}
+		}
+	}
+
+	// Scale3x (AdvMAME3x): the same idea at 3x3, where the edge centres also follow a neighbour along a diagonal
+	void Scale3x(const uint8_t* source, unsigned width, unsigned height, uint8_t* destination)
+	{
+		for (unsigned y = 0; y < height; ++y)
+		{
+			const uint8_t* above = source + (y > 0 ? y - 1 : y) * width;
+			const uint8_t* row = source + y * width;
+			const uint8_t* below = source + (y + 1 < height ? y + 1 : y) * width;
+			uint8_t* out = destination + y * 3 * width * 3;
+
+			for (unsigned x = 0; x < width; ++x)
+			{
+				unsigned left = x > 0 ? x - 1 : x;
+				unsigned right = x + 1 < width ? x + 1 : x;
+
+				// A B C
+				// D E F
+				// G H I
+				uint8_t a = above[left], b = above[x], c = above[right];
+				uint8_t d = row[left], e = row[x], f = row[right];
+				uint8_t g = below[left], h = below[x], i = below[right];
+
+				uint8_t e0 = e, e1 = e, e2 = e, e3 = e, e5 = e, e6 = e, e7 = e, e8 = e;
+				if (b != h && d != f)
+				{
+					e0 = d == b ? d : e;
+					e1 = (d == b && e != c) || (b == f && e != a) ? b : e;
+					e2 = b == f ? f : e;
+					e3 = (d == b && e != g) || (d == h && e != a) ? d : e;
+					e5 = (b == f && e != i) || (h == f && e != c) ? f : e;
+					e6 = d == h ? d : e;
+					e7 = (d == h && e != i) || (h == f && e != g) ? h : e;
+					e8 = h == f ? f : e;
+				}
+
+				uint8_t* top = out + x * 3;
+				uint8_t* middle = top + width * 3;
+				uint8_t* bottom = middle + width * 3;
+				top[0] = e0; top[1] = e1; top[2] = e2;
+				middle[0] = e3; middle[1] = e; middle[2] = e5;
+				bottom[0] = e6; bottom[1] = e7; bottom[2] = e8;
+			}
+		}
+	}
+
+#ifdef FRAME_FILTER_SSE2
+	// Each channel of 4 pixels times its lane of multiplier (out of 256, two pixels' worth of 16-bit lanes)
+	__m128i Multiply(__m128i pixels, __m128i multiplier)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i low = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), multiplier), 8);
+		__m128i high = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), multiplier), 8);
+		return _mm_packus_epi16(low, high);
+	}
+#endif
+
+	uint32_t Multiply(uint32_t pixel, uint32_t color_multiplier, uint32_t alpha_multiplier)
+	{
+		uint32_t result = 0;
+		for (unsigned shift = 0; shift < 32; shift += 8)
+		{
+			uint32_t multiplier = shift == 24 ? alpha_multiplier : color_multiplier;
+			result |= ((((pixel >> shift) & 0xFF) * multiplier) >> 8) << shift;
+		}
+
+		return result;
+	}
+
+	// glow = max(current, glow faded), channel by channel
+	void Ghost(const uint32_t* current, uint32_t* glow, unsigned count, uint16_t persistence)
+	{
+		unsigned x = 0;
+#ifdef FRAME_FILTER_SSE2
+		const __m128i multiplier = _mm_set1_epi16(static_cast<short>(persistence));
+		for (; x + 4 <= count; x += 4)
+		{
+			__m128i now = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current + x));
+			__m128i faded = Multiply(_mm_loadu_si128(reinterpret_cast<const __m128i*>(glow + x)), multiplier);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(glow + x), _mm_max_epu8(now, faded));
+		}
+#endif
+		for (; x < count; ++x)
+		{
+			uint32_t faded = Multiply(glow[x], persistence, persistence);
+			uint32_t result = 0;
+			for (unsigned shift = 0; shift < 32; shift += 8)
+			{
+				result |= std::max((current[x] >> shift) & 0xFF, (faded >> shift) & 0xFF) << shift;
+			}
+
+			glow[x] = result;
+		}
+	}
+
+	// Darken the colour channels, leaving alpha
+	void Darken(const uint32_t* source, uint32_t* destination, unsigned count, uint16_t scanline)
+	{
+		unsigned x = 0;
+#ifdef FRAME_FILTER_SSE2
+		const short s = static_cast<short>(scanline);
+		const __m128i multiplier = _mm_set_epi16(256, s, s, s, 256, s, s, s);
+		for (; x + 4 <= count; x += 4)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x), Multiply(pixels, multiplier));
+		}
+#endif
+		for (; x < count; ++x)
+		{
+			destination[x] = Multiply(source[x], scanline, 256);
+		}
+	}
+
+	// Fill count pixels with one colour
+	void Fill(uint32_t* destination, unsigned count, uint32_t color)
+	{
+		unsigned x = 0;
+#ifdef FRAME_FILTER_SSE2
+		const __m128i pixels = _mm_set1_epi32(static_cast<int>(color));
+		for (; x + 4 <= count; x += 4)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x), pixels);
+		}
+#endif
+		for (; x < count; ++x)
+		{
+			destination[x] = color;
+		}
+	}
+}
+
+FrameFilter::FrameFilter(unsigned width, unsigned height, unsigned threads)
+	: m_Width(width), m_Height(height), m_Threads(threads ? threads : 1),
+	m_Indices(HIRES_VIDEO_WIDTH * 3 * HIRES_VIDEO_HEIGHT * 3),
+	m_Glow(static_cast<size_t>(width) * height, 0),
+	m_Rows(static_cast<size_t>(width) * m_Threads)
+{
+}
+
+void FrameFilter::SetScanlines(double strength)
+{
+	m_Scanline = static_cast<uint16_t>(256 - ToMultiplier(strength));
+}
+
+void FrameFilter::SetGhosting(double persistence)
+{
+	m_Persistence = ToMultiplier(persistence);
+}
+
+void FrameFilter::Reset()
+{
+	std::fill(m_Glow.begin(), m_Glow.end(), 0);
+}
+
+void FrameFilter::Apply(const Display& display, uint32_t* pixels)
+{
+	Upscale(display);
+
+	const unsigned threads = std::max(1u, std::min(m_Threads, m_SourceHeight));
+	std::vector<std::thread> workers;
+	for (unsigned thread = 1; thread < threads; ++thread)
+	{
+		workers.emplace_back(&FrameFilter::Compose, this, m_SourceHeight * thread / threads, m_SourceHeight * (thread + 1) / threads,
+			pixels, m_Rows.data() + static_cast<size_t>(thread) * m_Width);
+	}
+
+	Compose(0, m_SourceHeight / threads, pixels, m_Rows.data());
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	// Rows below the last whole scaled row
+	const unsigned covered = m_Height / m_SourceHeight * m_SourceHeight;
+	Fill(pixels + static_cast<size_t>(covered) * m_Width, (m_Height - covered) * m_Width, DISPLAY_PALETTE[0]);
+}
+
+void FrameFilter::Upscale(const Display& display)
+{
+	const unsigned width = display.GetWidth();
+	const unsigned height = display.GetHeight();
+
+	unsigned factor = m_Mode == UpscaleMode::Scale3x ? 3 : m_Mode == UpscaleMode::Scale2x ? 2 : 1;
+	if (width * factor > m_Width || height * factor > m_Height)
+	{
+		factor = 1;
+	}
+
+	m_SourceWidth = std::min(width * factor, m_Width);
+	m_SourceHeight = std::min(height * factor, m_Height);
+
+	// Unpack the planes into colour indices, straight into m_Indices when there is nothing else to do
+	uint8_t base[HIRES_VIDEO_WIDTH * HIRES_VIDEO_HEIGHT];
+	uint8_t* indices = factor == 1 ? m_Indices.data() : base;
+	for (unsigned y = 0; y < height; ++y)
+	{
+		for (unsigned word = 0; word < width / 64; ++word)
+		{
+			uint64_t bits[DISPLAY_PLANE_COUNT];
+			for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+			{
+				bits[plane] = display.GetRow(plane, y)[word];
+			}
+
+			uint8_t* out = indices + y * width + word * 64;
+			for (unsigned bit = 0; bit < 64; ++bit)
+			{
+				uint8_t color = 0;
+				for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+				{
+					color |= ((bits[plane] >> (63 - bit)) & 1) << plane;
+				}
+
+				out[bit] = color;
+			}
+		}
+	}
+
+	if (factor == 2)
+	{
+		Scale2x(base, width, height, m_Indices.data());
+	}
+	else if (factor == 3)
+	{
+		Scale3x(base, width, height, m_Indices.data());
+	}
+	else if (m_SourceWidth < width)
+	{
+		// Narrower than the display: keep the left of each row
+		for (unsigned y = 1; y < m_SourceHeight; ++y)
+		{
+			std::memmove(m_Indices.data() + y * m_SourceWidth, m_Indices.data() + y * width, m_SourceWidth);
+		}
+	}
+}
+
+void FrameFilter::Compose(unsigned first, unsigned last, uint32_t* pixels, uint32_t* row)
+{
+	const unsigned scale_x = m_Width / m_SourceWidth;
+	const unsigned scale_y = m_Height / m_SourceHeight;
+	const unsigned covered = m_SourceWidth * scale_x;
+	const uint8_t* indices = m_Indices.data();
+
+	for (unsigned source_y = first; source_y < last; ++source_y)
+	{
+		// Expand the indices through the palette once per upscaled row
+		const uint8_t* line = indices + source_y * m_SourceWidth;
+		for (unsigned x = 0; x < m_SourceWidth; ++x)
+		{
+			Fill(row + x * scale_x, scale_x, DISPLAY_PALETTE[line[x]]);
+		}
+
+		Fill(row + covered, m_Width - covered, DISPLAY_PALETTE[0]);
+
+		for (unsigned i = 0; i < scale_y; ++i)
+		{
+			const size_t offset = static_cast<size_t>(source_y * scale_y + i) * m_Width;
+			const uint32_t* source = row;
+			if (m_Persistence != 0)
+			{
+				Ghost(row, m_Glow.data() + offset, m_Width, m_Persistence);
+				source = m_Glow.data() + offset;
+			}
+
+			// A single output row per upscaled row has no room for a scanline
+			if (scale_y > 1 && i == scale_y - 1 && m_Scanline != 256)
+			{
+				Darken(source, pixels + offset, m_Width, m_Scanline);
+			}
+			else
+			{
+				std::memcpy(pixels + offset, source, m_Width * sizeof(uint32_t));
+			}
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Display.h"
+#include <cstdint>
+#include <vector>
+
+// Pixel art upscaler run on the display before the integer scale. Scale2x and Scale3x (EPX / AdvMAME3x) round off diagonal
+// edges without adding colours, since they only ever copy a neighbour
+enum class UpscaleMode : uint8_t
+{
+	Nearest,
+	Scale2x,
+	Scale3x,
+};
+
+// CPU replacement for the GPU sampler stretch, for capture where there is no GPU. A frame goes through:
+// - the upscaler, on colour indices at the display's resolution
+// - nearest neighbour integer scaling to the output size, through the palette
+// - ghosting: each pixel keeps the brightest of its new colour and its old one faded, which hides CHIP-8's
+//   erase-and-redraw flicker like a slow phosphor
+// - scanlines: the last output row of every upscaled row is darkened
+//
+// The output rows are split into bands, one per thread, and the RGBA work is SSE2 where available. The buffers are
+// allocated up front, so with one thread filtering a frame doesn't allocate
+class FrameFilter
+{
+public:
+	// Output size in pixels. Each dimension should be a multiple of the display's resolution times the upscaler's factor,
+	// for both resolutions a ROM uses (e.g. 1280x640). Any remainder is left black
+	FrameFilter(unsigned width, unsigned height, unsigned threads = 1);
+
+	inline void SetMode(UpscaleMode mode) { m_Mode = mode; }
+	inline UpscaleMode GetMode() const { return m_Mode; }
+
+	// How much the scanlines are darkened, 0 (off) to 1 (black)
+	void SetScanlines(double strength);
+
+	// Fraction of a pixel's brightness kept from one frame to the next, 0 (off) to 1
+	void SetGhosting(double persistence);
+
+	// Forget the faded image ghosting keeps, e.g. after loading a ROM
+	void Reset();
+
+	inline unsigned GetWidth() const { return m_Width; }
+	inline unsigned GetHeight() const { return m_Height; }
+
+	// Filter a frame into pixels, GetWidth() x GetHeight() of them
+	void Apply(const Display& display, uint32_t* pixels);
+
+private:
+	// Colour indices of the display, upscaled into m_Indices
+	void Upscale(const Display& display);
+
+	// Output rows for upscaled rows first to last, with a row of scratch
+	void Compose(unsigned first, unsigned last, uint32_t* pixels, uint32_t* row);
+
+	unsigned m_Width;
+	unsigned m_Height;
+	unsigned m_Threads;
+
+	UpscaleMode m_Mode = UpscaleMode::Nearest;
+
+	// Multipliers out of 256: what is left of a faded pixel, and of a scanline. 0 turns ghosting off, 256 scanlines
+	uint16_t m_Persistence = 0;
+	uint16_t m_Scanline = 256;
+
+	// Upscaled colour indices for the current frame, and their size
+	std::vector<uint8_t> m_Indices;
+	unsigned m_SourceWidth = 0;
+	unsigned m_SourceHeight = 0;
+
+	// Ghosted image before scanlines, m_Width x m_Height
+	std::vector<uint32_t> m_Glow;
+
+	// A row of scratch per thread
+	std::vector<uint32_t> m_Rows;
+};
@@ -0,0 +1,42 @@
+#include "FramePacer.h"
+
+#include <thread>
+
+FramePacer::FramePacer(double rate) :
+	m_Rate(rate),
+	m_Period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate)))
+{
+	Reset();
+}
+
+unsigned FramePacer::Wait()
+{
+	Clock::time_point now = Clock::now();
+
+	// Missed the deadline by whole frames: skip them
+	unsigned dropped = 0;
+	if (now > m_Next + m_Period)
+	{
+		dropped = static_cast<unsigned>((now - m_Next) / m_Period);
+		m_Next += m_Period * dropped;
+		m_Dropped += dropped;
+	}
+
+	if (m_Next - now > SPIN_MARGIN)
+	{
+		std::this_thread::sleep_until(m_Next - SPIN_MARGIN);
+	}
+
+	while (Clock::now() < m_Next)
+	{
+		std::this_thread::yield();
+	}
+
+	m_Next += m_Period;
+	return dropped;
+}
+
+void FramePacer::Reset()
+{
+	m_Next = Clock::now() + m_Period;
+}
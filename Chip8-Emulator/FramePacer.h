@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Waits out the rest of each frame at a fixed rate without spinning the whole time: the OS sleep takes the bulk of the wait
+// and only the last stretch, shorter than the scheduler's wake-up error, is spent yielding. A frame that comes too late is
+// dropped, and the schedule skips ahead rather than running frames back to back to catch up
+class FramePacer
+{
+public:
+	explicit FramePacer(double rate);
+
+	// Wait until the next frame is due. Returns the number of frames dropped since the last call
+	unsigned Wait();
+
+	// Restart the schedule from now, e.g. after a pause
+	void Reset();
+
+	inline double GetRate() const { return m_Rate; }
+
+	// Frames dropped since construction
+	inline uint64_t GetDroppedFrames() const { return m_Dropped; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// Sleeps can overshoot by about a millisecond on a loaded desktop, so they stop this far short of the deadline
+	static constexpr std::chrono::microseconds SPIN_MARGIN { 1500 };
+
+	double m_Rate;
+	Clock::duration m_Period;
+
+	// When the next frame is due
+	Clock::time_point m_Next;
+	uint64_t m_Dropped = 0;
+};
@@ -0,0 +1,136 @@
+#include "GuestProfiler.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+bool GuestProfiler::LoadLabels(char const* filename)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		return false;
+	}
+
+	std::string line;
+	for (unsigned number = 1; std::getline(file, line); ++number)
+	{
+		std::istringstream fields(line);
+		std::string address;
+		std::string name;
+		if (!(fields >> address >> name) || address[0] == '#')
+		{
+			continue;
+		}
+
+		// A line that isn't a 16-bit hex address is reported and skipped rather than failing the whole file
+		char* end = nullptr;
+		unsigned long value = std::strtoul(address.c_str(), &end, 16);
+		if (*end != '\0' || value > 0xFFFF || address[0] == '-')
+		{
+			std::fprintf(stderr, "%s:%u: skipping bad label address %s\n", filename, number, address.c_str());
+			continue;
+		}
+
+		m_Labels[static_cast<uint16_t>(value)] = name;
+	}
+
+	return true;
+}
+
+void GuestProfiler::Run(Chip8& chip8, uint64_t cycles)
+{
+	while (cycles > 0)
+	{
+		// Run straight up to the next sample so the only per instruction cost is the interpreter's
+		uint64_t run = m_Countdown < cycles ? m_Countdown : cycles;
+		for (uint64_t i = 0; i < run; ++i)
+		{
+			chip8.Cycle();
+		}
+
+		cycles -= run;
+		m_Countdown -= static_cast<unsigned>(run);
+
+		if (m_Countdown == 0)
+		{
+			Sample(chip8);
+			m_Countdown = m_Interval;
+		}
+	}
+}
+
+void GuestProfiler::Sample(const Chip8& chip8)
+{
+	const auto& memory = chip8.GetMemory();
+	const auto& stack = chip8.GetStack();
+
+	// The root is the program entry point
+	m_Scratch.clear();
+	m_Scratch.push_back(ROM_START_ADDRESS);
+
+	// Each return address follows the 2NNN that made the call, and NNN is the subroutine it entered
+	for (unsigned level = 0; level < chip8.GetStackPointer(); ++level)
+	{
+		uint16_t call = static_cast<uint16_t>(stack[level] - 2);
+		uint16_t opcode = (memory[call] << 8) | memory[call + 1];
+		m_Scratch.push_back((opcode & 0xF000) == 0x2000 ? opcode & 0x0FFF : call);
+	}
+
+	m_Scratch.push_back(chip8.GetProgramCounter());
+
+	++m_Stacks[m_Scratch];
+	++m_SampleCount;
+}
+
+bool GuestProfiler::WriteCollapsed(char const* filename) const
+{
+	// Different PCs in the same function collapse to the same line, so merge before writing
+	std::map<std::string, uint64_t> lines;
+	for (const auto& [stack, count] : m_Stacks)
+	{
+		std::string line;
+		for (size_t i = 0; i + 1 < stack.size(); ++i)
+		{
+			line += i == 0 ? (m_Labels.empty() ? "main" : GetName(stack[i])) : ";" + GetName(stack[i]);
+		}
+
+		// Without labels the PC adds nothing beyond the subroutine. With them it names the loop or block inside it
+		std::string leaf = GetName(stack.back());
+		if (!m_Labels.empty() && leaf != GetName(stack[stack.size() - 2]))
+		{
+			line += ";" + leaf;
+		}
+
+		lines[line] += count;
+	}
+
+	FILE* file = std::fopen(filename, "w");
+	if (!file)
+	{
+		return false;
+	}
+
+	for (const auto& [line, count] : lines)
+	{
+		std::fprintf(file, "%s %llu\n", line.c_str(), static_cast<unsigned long long>(count));
+	}
+
+	bool ok = !std::ferror(file);
+	std::fclose(file);
+	return ok;
+}
+
+std::string GuestProfiler::GetName(uint16_t address) const
+{
+	auto it = m_Labels.upper_bound(address);
+	if (it != m_Labels.begin())
+	{
+		return std::prev(it)->second;
+	}
+
+	char name[16];
+	std::snprintf(name, sizeof(name), "sub_%03X", address);
+	return name;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Chip8.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Sampling profiler for the guest program. Every interval instructions it records the guest PC and the call stack (the
+// return addresses pushed by 2NNN), and writes them out as collapsed stacks ("main;sub_2A4;sub_31C 42") for flamegraph.pl
+// or speedscope
+class GuestProfiler
+{
+public:
+	explicit GuestProfiler(unsigned interval = 1000) : m_Interval(interval ? interval : 1), m_Countdown(m_Interval) {}
+
+	// Name addresses from a label file, one "<hex address> <name>" per line, # for comments.
+	// A PC is named after the nearest label at or below it. Lines with a bad address are reported on stderr and skipped
+	bool LoadLabels(char const* filename);
+
+	// Run the interpreter for cycles instructions, sampling every interval instructions
+	void Run(Chip8& chip8, uint64_t cycles);
+
+	// Record one sample of the current guest state
+	void Sample(const Chip8& chip8);
+
+	// Write every distinct stack with its sample count
+	bool WriteCollapsed(char const* filename) const;
+
+	inline uint64_t GetSampleCount() const { return m_SampleCount; }
+
+private:
+	// Label for an address, or sub_XXX for the address itself
+	std::string GetName(uint16_t address) const;
+
+	unsigned m_Interval;
+
+	// Instructions left until the next sample
+	unsigned m_Countdown;
+
+	// Subroutine entry points from the outermost call inwards, then the PC. Symbolised when written
+	std::map<std::vector<uint16_t>, uint64_t> m_Stacks;
+	std::vector<uint16_t> m_Scratch;
+	uint64_t m_SampleCount = 0;
+
+	std::map<uint16_t, std::string> m_Labels;
+};
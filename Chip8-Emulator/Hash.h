@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// xxHash64 (https://github.com/Cyan4973/xxHash) used to identify ROMs by their content
+uint64_t XXHash64(const void* data, size_t size, uint64_t seed = 0);
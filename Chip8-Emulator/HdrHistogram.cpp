@@ -0,0 +1,88 @@
+#include "HdrHistogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+HdrHistogram::HdrHistogram() :
+	m_Buckets(BUCKET_COUNT)
+{
+}
+
+void HdrHistogram::Record(uint64_t value)
+{
+	++m_Buckets[GetBucket(value)];
+	++m_Count;
+	m_Min = std::min(m_Min, value);
+	m_Max = std::max(m_Max, value);
+	m_Sum += static_cast<double>(value);
+}
+
+void HdrHistogram::Merge(const HdrHistogram& other)
+{
+	for (unsigned i = 0; i < BUCKET_COUNT; ++i)
+	{
+		m_Buckets[i] += other.m_Buckets[i];
+	}
+
+	m_Count += other.m_Count;
+	m_Min = std::min(m_Min, other.m_Min);
+	m_Max = std::max(m_Max, other.m_Max);
+	m_Sum += other.m_Sum;
+}
+
+void HdrHistogram::Reset()
+{
+	std::fill(m_Buckets.begin(), m_Buckets.end(), 0);
+	m_Count = 0;
+	m_Min = UINT64_MAX;
+	m_Max = 0;
+	m_Sum = 0.0;
+}
+
+uint64_t HdrHistogram::GetPercentile(double percentile) const
+{
+	if (m_Count == 0)
+	{
+		return 0;
+	}
+
+	uint64_t target = static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * m_Count));
+	target = std::max<uint64_t>(target, 1);
+
+	uint64_t seen = 0;
+	for (unsigned i = 0; i < BUCKET_COUNT; ++i)
+	{
+		seen += m_Buckets[i];
+		if (seen >= target)
+		{
+			return std::min(GetBucketLimit(i), m_Max);
+		}
+	}
+
+	return m_Max;
+}
+
+unsigned HdrHistogram::GetBucket(uint64_t value)
+{
+	if (value < SUB_BUCKET_COUNT)
+	{
+		return static_cast<unsigned>(value);
+	}
+
+	// Keep the top SUB_BUCKET_BITS bits, which land in the upper half of a sub-bucket range
+	unsigned shift = static_cast<unsigned>(std::bit_width(value)) - SUB_BUCKET_BITS;
+	return shift * SUB_BUCKET_HALF + static_cast<unsigned>(value >> shift);
+}
+
+uint64_t HdrHistogram::GetBucketLimit(unsigned bucket)
+{
+	if (bucket < SUB_BUCKET_COUNT)
+	{
+		return bucket;
+	}
+
+	unsigned shift = bucket / SUB_BUCKET_HALF - 1;
+	uint64_t low = static_cast<uint64_t>(bucket - shift * SUB_BUCKET_HALF) << shift;
+	return low + ((uint64_t(1) << shift) - 1);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Histogram of unsigned integers with the same relative precision at every magnitude, in HdrHistogram's log-linear layout:
+// values below 128 get a bucket each, and larger ones share a bucket with values within 1/64th of them. Recording is a
+// shift and an increment, cheap enough for every frame or key press, and the buckets cover the whole 64-bit range so
+// nothing is clamped
+class HdrHistogram
+{
+public:
+	HdrHistogram();
+
+	void Record(uint64_t value);
+
+	// Add every value recorded in other
+	void Merge(const HdrHistogram& other);
+
+	void Reset();
+
+	// Smallest value that percentile % of the recorded values are at or below, to the bucket's precision. 0 when empty
+	uint64_t GetPercentile(double percentile) const;
+
+	inline uint64_t GetCount() const { return m_Count; }
+	inline uint64_t GetMin() const { return m_Count != 0 ? m_Min : 0; }
+	inline uint64_t GetMax() const { return m_Max; }
+	inline double GetMean() const { return m_Count != 0 ? m_Sum / m_Count : 0.0; }
+
+private:
+	// 128 exact buckets, then 64 per power of two
+	static const unsigned SUB_BUCKET_BITS = 7;
+	static const unsigned SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	static const unsigned SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+	static const unsigned BUCKET_COUNT = (64 - SUB_BUCKET_BITS) * SUB_BUCKET_HALF + SUB_BUCKET_COUNT;
+
+	static unsigned GetBucket(uint64_t value);
+
+	// Largest value that falls in a bucket
+	static uint64_t GetBucketLimit(unsigned bucket);
+
+	std::vector<uint64_t> m_Buckets;
+	uint64_t m_Count = 0;
+	uint64_t m_Min = UINT64_MAX;
+	uint64_t m_Max = 0;
+	double m_Sum = 0.0;
+};
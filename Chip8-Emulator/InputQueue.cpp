@@ -0,0 +1,38 @@
+#include "InputQueue.h"
+
+bool InputQueue::Push(const InputEvent& event)
+{
+	uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+	uint32_t head = m_Head.load(std::memory_order_acquire);
+
+	// Full - drop the event rather than block the producer
+	if (tail - head == INPUT_QUEUE_SIZE)
+	{
+		m_Dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	m_Events[tail % INPUT_QUEUE_SIZE] = event;
+	m_Tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+bool InputQueue::Peek(InputEvent* event) const
+{
+	uint32_t head = m_Head.load(std::memory_order_relaxed);
+	uint32_t tail = m_Tail.load(std::memory_order_acquire);
+
+	if (head == tail)
+	{
+		return false;
+	}
+
+	*event = m_Events[head % INPUT_QUEUE_SIZE];
+	return true;
+}
+
+void InputQueue::Pop()
+{
+	uint32_t head = m_Head.load(std::memory_order_relaxed);
+	m_Head.store(head + 1, std::memory_order_release);
+}
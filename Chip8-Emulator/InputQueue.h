@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+
+const unsigned int INPUT_QUEUE_SIZE = 256;
+
+struct InputEvent
+{
+	// Emulated cycle the event takes effect on
+	uint64_t Cycle = 0;
+
+	// Keypad key (0x0 - 0xF)
+	uint8_t Key = 0;
+
+	// Key went down (true) or up (false)
+	bool Pressed = false;
+};
+
+// Single-producer/single-consumer ring of keypad events. The window thread pushes, the emulation thread pops
+class InputQueue
+{
+public:
+	InputQueue() = default;
+
+	// Queue an event. Returns false if the queue is full
+	bool Push(const InputEvent& event);
+
+	// Look at the oldest event without removing it. Returns false if the queue is empty
+	bool Peek(InputEvent* event) const;
+
+	// Remove the oldest event
+	void Pop();
+
+	// Number of events dropped because the queue was full
+	inline uint32_t GetDroppedCount() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+private:
+	std::array<InputEvent, INPUT_QUEUE_SIZE> m_Events;
+
+	// Written by the consumer
+	alignas(64) std::atomic<uint32_t> m_Head = 0;
+
+	// Written by the producer
+	alignas(64) std::atomic<uint32_t> m_Tail = 0;
+	std::atomic<uint32_t> m_Dropped = 0;
+};
@@ -0,0 +1,234 @@
+#include "Instrumentation.h"
+#include <bit>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	const char* const opcode_names[static_cast<unsigned>(OpcodeClass::Count)] =
+	{
+		"00E0", "00EE", "00CN", "00DN", "00FB", "00FC", "00FD", "00FE", "00FF", "0NNN",
+		"1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "5XY2", "5XY3", "6XNN", "7XNN",
+		"8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE", "9XY0",
+		"ANNN", "BNNN", "CXNN", "DXYN", "EX9E", "EXA1",
+		"F000", "FN01", "F002", "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX30", "FX33", "FX3A",
+		"FX55", "FX65", "FX75", "FX85",
+		"other"
+	};
+}
+
+void Instrumentation::OnDraw(const uint8_t* sprite, unsigned size, bool collision)
+{
+	for (unsigned i = 0; i < size; ++i)
+	{
+		m_PixelsDrawn += std::popcount(sprite[i]);
+	}
+
+	m_Collisions += collision ? 1 : 0;
+}
+
+void Instrumentation::Reset()
+{
+	*this = Instrumentation();
+}
+
+OpcodeClass Instrumentation::Classify(uint16_t opcode)
+{
+	switch (opcode >> 12)
+	{
+		case 0x0:
+			switch (opcode)
+			{
+				case 0x00E0: return OpcodeClass::Cls;
+				case 0x00EE: return OpcodeClass::Ret;
+				case 0x00FB: return OpcodeClass::ScrollRight;
+				case 0x00FC: return OpcodeClass::ScrollLeft;
+				case 0x00FD: return OpcodeClass::Exit;
+				case 0x00FE: return OpcodeClass::LowRes;
+				case 0x00FF: return OpcodeClass::HighRes;
+			}
+
+			if ((opcode & 0xFFF0) == 0x00C0)
+				return OpcodeClass::ScrollDown;
+			if ((opcode & 0xFFF0) == 0x00D0)
+				return OpcodeClass::ScrollUp;
+			return OpcodeClass::Sys;
+
+		case 0x1: return OpcodeClass::Jump;
+		case 0x2: return OpcodeClass::Call;
+		case 0x3: return OpcodeClass::SkipEqualByte;
+		case 0x4: return OpcodeClass::SkipNotEqualByte;
+
+		case 0x5:
+			switch (opcode & 0xF)
+			{
+				case 0x0: return OpcodeClass::SkipEqual;
+				case 0x2: return OpcodeClass::SaveRange;
+				case 0x3: return OpcodeClass::LoadRange;
+			}
+			return OpcodeClass::Other;
+
+		case 0x6: return OpcodeClass::SetByte;
+		case 0x7: return OpcodeClass::AddByte;
+
+		case 0x8:
+			switch (opcode & 0xF)
+			{
+				case 0x0: return OpcodeClass::Set;
+				case 0x1: return OpcodeClass::Or;
+				case 0x2: return OpcodeClass::And;
+				case 0x3: return OpcodeClass::Xor;
+				case 0x4: return OpcodeClass::Add;
+				case 0x5: return OpcodeClass::Sub;
+				case 0x6: return OpcodeClass::ShiftRight;
+				case 0x7: return OpcodeClass::SubN;
+				case 0xE: return OpcodeClass::ShiftLeft;
+			}
+			return OpcodeClass::Other;
+
+		case 0x9: return OpcodeClass::SkipNotEqual;
+		case 0xA: return OpcodeClass::SetIndex;
+		case 0xB: return OpcodeClass::JumpOffset;
+		case 0xC: return OpcodeClass::Random;
+		case 0xD: return OpcodeClass::Draw;
+
+		case 0xE:
+			switch (opcode & 0xFF)
+			{
+				case 0x9E: return OpcodeClass::SkipKey;
+				case 0xA1: return OpcodeClass::SkipNotKey;
+			}
+			return OpcodeClass::Other;
+
+		case 0xF:
+			switch (opcode & 0xFF)
+			{
+				case 0x00: return OpcodeClass::LongIndex;
+				case 0x01: return OpcodeClass::Plane;
+				case 0x02: return OpcodeClass::Audio;
+				case 0x07: return OpcodeClass::GetDelay;
+				case 0x0A: return OpcodeClass::WaitKey;
+				case 0x15: return OpcodeClass::SetDelay;
+				case 0x18: return OpcodeClass::SetSound;
+				case 0x1E: return OpcodeClass::AddIndex;
+				case 0x29: return OpcodeClass::Font;
+				case 0x30: return OpcodeClass::BigFont;
+				case 0x33: return OpcodeClass::Bcd;
+				case 0x3A: return OpcodeClass::Pitch;
+				case 0x55: return OpcodeClass::Store;
+				case 0x65: return OpcodeClass::Load;
+				case 0x75: return OpcodeClass::SaveFlags;
+				case 0x85: return OpcodeClass::LoadFlags;
+			}
+			return OpcodeClass::Other;
+	}
+
+	return OpcodeClass::Other;
+}
+
+const char* Instrumentation::GetName(OpcodeClass opcode_class)
+{
+	return opcode_names[static_cast<unsigned>(opcode_class)];
+}
+
+uint64_t Instrumentation::GetInstructionCount() const
+{
+	uint64_t total = 0;
+	for (uint64_t count : m_OpcodeCounts)
+	{
+		total += count;
+	}
+
+	return total;
+}
+
+bool Instrumentation::WriteJson(const char* filename) const
+{
+	FILE* file = std::fopen(filename, "w");
+	if (!file)
+	{
+		return false;
+	}
+
+	std::fprintf(file, "{\n");
+	std::fprintf(file, "  \"instructions\": %llu,\n", static_cast<unsigned long long>(GetInstructionCount()));
+	std::fprintf(file, "  \"skips\": %llu,\n", static_cast<unsigned long long>(m_Skips));
+	std::fprintf(file, "  \"pixels_drawn\": %llu,\n", static_cast<unsigned long long>(m_PixelsDrawn));
+	std::fprintf(file, "  \"collisions\": %llu,\n", static_cast<unsigned long long>(m_Collisions));
+	std::fprintf(file, "  \"stack_high_water\": %u,\n", m_StackHighWater);
+
+	std::fprintf(file, "  \"opcodes\": {");
+	for (unsigned i = 0; i < m_OpcodeCounts.size(); ++i)
+	{
+		std::fprintf(file, "%s\n    \"%s\": %llu", i ? "," : "", opcode_names[i], static_cast<unsigned long long>(m_OpcodeCounts[i]));
+	}
+	std::fprintf(file, "\n  },\n");
+
+	std::fprintf(file, "  \"pc\": {");
+	bool first = true;
+	for (unsigned slot = 0; slot < m_PcCounts.size(); ++slot)
+	{
+		if (m_PcCounts[slot] != 0)
+		{
+			std::fprintf(file, "%s\n    \"0x%04X\": %u", first ? "" : ",", slot * 2, m_PcCounts[slot]);
+			first = false;
+		}
+	}
+	std::fprintf(file, "\n  }\n}\n");
+
+	bool ok = !std::ferror(file);
+	std::fclose(file);
+	return ok;
+}
+
+bool Instrumentation::WriteHeatmap(const char* filename, unsigned memory_size) const
+{
+	const unsigned cells = HEATMAP_SIZE * HEATMAP_SIZE;
+	const unsigned bytes_per_cell = memory_size / cells > 0 ? memory_size / cells : 1;
+
+	// Sum each slot into the cell covering its address, and find the hottest for scaling. On a 4KB machine a cell is one
+	// byte, so only every other cell can hold an instruction
+	std::array<uint64_t, HEATMAP_SIZE * HEATMAP_SIZE> heat = {};
+	for (unsigned slot = 0; slot < m_PcCounts.size() && slot * 2 < memory_size; ++slot)
+	{
+		unsigned cell = slot * 2 / bytes_per_cell;
+		if (cell < cells)
+		{
+			heat[cell] += m_PcCounts[slot];
+		}
+	}
+
+	uint64_t hottest = 0;
+	for (uint64_t value : heat)
+	{
+		hottest = value > hottest ? value : hottest;
+	}
+
+	FILE* file = std::fopen(filename, "wb");
+	if (!file)
+	{
+		return false;
+	}
+
+	std::fprintf(file, "P6\n%u %u\n255\n", HEATMAP_SIZE, HEATMAP_SIZE);
+
+	const double scale = hottest > 0 ? 1.0 / std::log(static_cast<double>(hottest) + 1.0) : 0.0;
+	for (unsigned cell = 0; cell < cells; ++cell)
+	{
+		// Black for code that never ran, then dark red through yellow to white
+		uint8_t rgb[3] = { 0, 0, 0 };
+		if (heat[cell] != 0)
+		{
+			double t = std::log(static_cast<double>(heat[cell]) + 1.0) * scale;
+			rgb[0] = static_cast<uint8_t>(64 + 191 * std::fmin(t * 3.0, 1.0));
+			rgb[1] = static_cast<uint8_t>(255 * std::fmin(std::fmax(t * 3.0 - 1.0, 0.0), 1.0));
+			rgb[2] = static_cast<uint8_t>(255 * std::fmin(std::fmax(t * 3.0 - 2.0, 0.0), 1.0));
+		}
+
+		std::fwrite(rgb, 1, sizeof(rgb), file);
+	}
+
+	bool ok = !std::ferror(file);
+	std::fclose(file);
+	return ok;
+}
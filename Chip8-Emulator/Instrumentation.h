@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+
+// Counters live in one slot per instruction word of the 64KB address space
+const unsigned int INSTRUMENTATION_PC_SLOTS = 0x10000 / 2;
+
+// Heatmap image size, one cell per 1/4096th of the address space
+const unsigned int HEATMAP_SIZE = 64;
+
+// Instructions counted separately. Opcodes that match none of them count as Other
+enum class OpcodeClass : uint8_t
+{
+	Cls, Ret, ScrollDown, ScrollUp, ScrollRight, ScrollLeft, Exit, LowRes, HighRes, Sys,
+	Jump, Call, SkipEqualByte, SkipNotEqualByte, SkipEqual, SaveRange, LoadRange, SetByte, AddByte,
+	Set, Or, And, Xor, Add, Sub, ShiftRight, SubN, ShiftLeft, SkipNotEqual,
+	SetIndex, JumpOffset, Random, Draw, SkipKey, SkipNotKey,
+	LongIndex, Plane, Audio, GetDelay, WaitKey, SetDelay, SetSound, AddIndex, Font, BigFont, Bcd, Pitch,
+	Store, Load, SaveFlags, LoadFlags,
+	Other,
+	Count
+};
+
+// Execution counters filled in by Chip8 when it is built with CHIP8_INSTRUMENTATION and given one with SetInstrumentation.
+// Without the define the hooks don't exist, so the interpreter is unchanged
+class Instrumentation
+{
+public:
+	Instrumentation() = default;
+
+	// Hooks called by the interpreter
+	inline void OnInstruction(uint16_t pc, uint16_t opcode)
+	{
+		++m_PcCounts[pc >> 1];
+		++m_OpcodeCounts[static_cast<unsigned>(Classify(opcode))];
+	}
+
+	inline void OnSkip() { ++m_Skips; }
+
+	inline void OnCall(unsigned depth)
+	{
+		m_StackHighWater = depth > m_StackHighWater ? depth : m_StackHighWater;
+	}
+
+	void OnDraw(const uint8_t* sprite, unsigned size, bool collision);
+
+	// Zero every counter
+	void Reset();
+
+	// Instruction class of an opcode
+	static OpcodeClass Classify(uint16_t opcode);
+
+	// Opcode pattern for a class, e.g. "8XY4"
+	static const char* GetName(OpcodeClass opcode_class);
+
+	// Write the counters as JSON. Only PCs that executed are listed
+	bool WriteJson(const char* filename) const;
+
+	// Write a HEATMAP_SIZE x HEATMAP_SIZE binary PPM of the first memory_size bytes, one cell per memory_size / 4096 bytes,
+	// coloured by the log of the instructions executed there. Row major from address 0
+	bool WriteHeatmap(const char* filename, unsigned memory_size) const;
+
+	inline uint32_t GetPcCount(uint16_t pc) const { return m_PcCounts[pc >> 1]; }
+	inline uint64_t GetOpcodeCount(OpcodeClass opcode_class) const { return m_OpcodeCounts[static_cast<unsigned>(opcode_class)]; }
+	inline uint64_t GetSkipCount() const { return m_Skips; }
+	inline uint64_t GetPixelsDrawn() const { return m_PixelsDrawn; }
+	inline uint64_t GetCollisionCount() const { return m_Collisions; }
+	inline unsigned GetStackHighWater() const { return m_StackHighWater; }
+
+	// Total instructions executed
+	uint64_t GetInstructionCount() const;
+
+private:
+	// Executions per instruction word (PC / 2). 32-bit to keep the array small, so a count wraps after 2^32
+	std::array<uint32_t, INSTRUMENTATION_PC_SLOTS> m_PcCounts = {};
+
+	std::array<uint64_t, static_cast<unsigned>(OpcodeClass::Count)> m_OpcodeCounts = {};
+
+	// Instructions skipped by 3XNN, 4XNN, 5XY0, 9XY0, EX9E and EXA1
+	uint64_t m_Skips = 0;
+
+	// Sprite pixels drawn by DXYN, and draws that collided
+	uint64_t m_PixelsDrawn = 0;
+	uint64_t m_Collisions = 0;
+
+	// Deepest the call stack has been
+	unsigned m_StackHighWater = 0;
+};
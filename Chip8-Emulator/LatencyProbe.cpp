@@ -0,0 +1,204 @@
+#include "LatencyProbe.h"
+
+#include "Chip8.h"
+#include "InputQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+	// Instructions that write the display
+	bool WritesDisplay(uint16_t opcode)
+	{
+		if ((opcode & 0xF000) == 0xD000)
+		{
+			return true;
+		}
+
+		// 00CN, 00DN, 00E0, 00FB, 00FC, 00FE, 00FF
+		return (opcode & 0xFFE0) == 0x00C0 || opcode == 0x00E0 || opcode == 0x00FB || opcode == 0x00FC || opcode == 0x00FE || opcode == 0x00FF;
+	}
+
+	// Same pixels and resolution. Display's operator== also compares the selected planes, which don't show
+	bool SamePixels(const Display& a, const Display& b)
+	{
+		if (a.IsHighResolution() != b.IsHighResolution())
+		{
+			return false;
+		}
+
+		for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+		{
+			for (unsigned y = 0; y < a.GetHeight(); ++y)
+			{
+				if (!std::equal(a.GetRow(plane, y), a.GetRow(plane, y) + DISPLAY_ROW_WORDS, b.GetRow(plane, y)))
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	const char* const phase_names[static_cast<unsigned>(FramePhase::Count)] = { "frame build", "texture upload", "present" };
+
+	void AppendLine(std::string& report, const char* name, const char* unit, const HdrHistogram& histogram)
+	{
+		if (histogram.GetCount() == 0)
+		{
+			return;
+		}
+
+		char line[160];
+		std::snprintf(line, sizeof(line), "%-16s %-6s %8llu %12llu %12llu %12llu %12llu\n", name, unit,
+			static_cast<unsigned long long>(histogram.GetCount()),
+			static_cast<unsigned long long>(histogram.GetPercentile(50.0)),
+			static_cast<unsigned long long>(histogram.GetPercentile(99.0)),
+			static_cast<unsigned long long>(histogram.GetPercentile(99.9)),
+			static_cast<unsigned long long>(histogram.GetMax()));
+		report += line;
+	}
+}
+
+void LatencyProbe::Run(Chip8& chip8, uint32_t cycles, InputQueue& input)
+{
+	uint64_t end = chip8.GetCycleCount() + cycles;
+	while (chip8.GetCycleCount() < end)
+	{
+		// The keypad only changes through the queue between here and the next event, or outside Run
+		uint64_t next = chip8.ApplyInput(input, end);
+		if (chip8.Keypad != m_Keypad)
+		{
+			OnKeypadChange(chip8);
+		}
+
+		// With no change waiting for the display this is Chip8::Run's loop
+		if (m_PendingCount == 0)
+		{
+			while (chip8.GetCycleCount() < next)
+			{
+				chip8.Cycle();
+			}
+
+			continue;
+		}
+
+		// Otherwise step, comparing whole displays only after instructions that can draw, until one answers
+		while (chip8.GetCycleCount() < next && m_PendingCount != 0)
+		{
+			uint16_t opcode = chip8.GetMemory().ReadWord(chip8.GetProgramCounter());
+			chip8.Cycle();
+
+			if (WritesDisplay(opcode) && !SamePixels(chip8.VideoBuffer, m_Reference))
+			{
+				OnDisplayChange(chip8);
+			}
+		}
+	}
+}
+
+void LatencyProbe::OnPresent()
+{
+	uint64_t now = Now();
+	for (unsigned i = 0; i < m_AnsweredCount; ++i)
+	{
+		m_InputNanoseconds.Record(now - m_Answered[i]);
+	}
+
+	m_AnsweredCount = 0;
+	++m_Frame;
+
+	// Give up on changes the program ignored
+	unsigned expired = 0;
+	while (expired < m_PendingCount && m_Pending[expired].Frame + MAX_PENDING_FRAMES < m_Frame)
+	{
+		++expired;
+	}
+
+	if (expired != 0)
+	{
+		std::copy(m_Pending.begin() + expired, m_Pending.begin() + m_PendingCount, m_Pending.begin());
+		m_PendingCount -= expired;
+		m_Unanswered += expired;
+	}
+}
+
+uint64_t LatencyProbe::Now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t LatencyProbe::EndPhase(FramePhase phase, uint64_t start)
+{
+	uint64_t now = Now();
+	m_Phases[static_cast<unsigned>(phase)].Record(now - start);
+	return now;
+}
+
+void LatencyProbe::Merge(const LatencyProbe& other)
+{
+	m_InputCycles.Merge(other.m_InputCycles);
+	m_InputNanoseconds.Merge(other.m_InputNanoseconds);
+	for (unsigned i = 0; i < static_cast<unsigned>(FramePhase::Count); ++i)
+	{
+		m_Phases[i].Merge(other.m_Phases[i]);
+	}
+
+	m_Unanswered += other.m_Unanswered;
+}
+
+std::string LatencyProbe::FormatReport() const
+{
+	char header[160];
+	std::snprintf(header, sizeof(header), "%-16s %-6s %8s %12s %12s %12s %12s\n", "", "", "count", "p50", "p99", "p99.9", "max");
+
+	std::string report = header;
+	AppendLine(report, "input to display", "cycles", m_InputCycles);
+	AppendLine(report, "input to present", "ns", m_InputNanoseconds);
+	for (unsigned i = 0; i < static_cast<unsigned>(FramePhase::Count); ++i)
+	{
+		AppendLine(report, phase_names[i], "ns", m_Phases[i]);
+	}
+
+	char footer[64];
+	std::snprintf(footer, sizeof(footer), "unanswered key changes: %llu\n", static_cast<unsigned long long>(m_Unanswered));
+	report += footer;
+	return report;
+}
+
+void LatencyProbe::OnKeypadChange(const Chip8& chip8)
+{
+	m_Keypad = chip8.Keypad;
+
+	if (m_PendingCount == MAX_PENDING)
+	{
+		++m_Unanswered;
+		return;
+	}
+
+	// Every pending change shares the display it is compared against: it can't have changed since the oldest one, or
+	// they would all have been answered
+	if (m_PendingCount == 0)
+	{
+		m_Reference = chip8.VideoBuffer;
+	}
+
+	m_Pending[m_PendingCount++] = { chip8.GetCycleCount(), Now(), m_Frame };
+}
+
+void LatencyProbe::OnDisplayChange(const Chip8& chip8)
+{
+	for (unsigned i = 0; i < m_PendingCount; ++i)
+	{
+		m_InputCycles.Record(chip8.GetCycleCount() - m_Pending[i].Cycle);
+
+		if (m_AnsweredCount < MAX_PENDING)
+		{
+			m_Answered[m_AnsweredCount++] = m_Pending[i].Time;
+		}
+	}
+
+	m_PendingCount = 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Display.h"
+#include "HdrHistogram.h"
+#include <array>
+#include <cstdint>
+#include <string>
+
+class Chip8;
+class InputQueue;
+
+// Stages of getting a frame on screen that a frontend times
+enum class FramePhase : uint8_t
+{
+	// Turning the display into pixels (Display::ToRGBA, TerminalRenderer::Render, ...)
+	Build,
+
+	// Handing the pixels to the GPU or terminal
+	Upload,
+
+	// Present, including any wait for vsync
+	Present,
+
+	Count
+};
+
+// Measures input latency. Run shares Chip8::Run's input handling (Chip8::ApplyInput) and notes every change of
+// Chip8::Keypad, whether it came from the input queue or was written directly. While a change is waiting it steps one
+// instruction at a time, and the first instruction that leaves the display different from how it was at the change (DXYN,
+// 00E0, a scroll or a resolution switch) answers it. With nothing waiting it runs straight through like Chip8::Run.
+// Latency is counted in emulated cycles up to that instruction and in host nanoseconds up to the next OnPresent, when it
+// reaches the screen. Frontends can also time the phases of each frame. Everything goes into HdrHistograms, so tails are
+// as precise as medians
+class LatencyProbe
+{
+public:
+	LatencyProbe() = default;
+
+	// Run a number of cycles, applying queued input events on the cycle they are stamped with, as Chip8::Run does. Frontends
+	// call this instead of Chip8::Run only while input latency is being measured
+	void Run(Chip8& chip8, uint32_t cycles, InputQueue& input);
+
+	// The frame holding everything emulated so far is on screen. Headless runs call this once per frame as well
+	void OnPresent();
+
+	// Host time in nanoseconds, for timing frame phases
+	static uint64_t Now();
+
+	// Record the time from start until now for a frame phase. Returns now, to start the next phase from
+	uint64_t EndPhase(FramePhase phase, uint64_t start);
+
+	// Add everything another probe measured, e.g. from a run on another thread
+	void Merge(const LatencyProbe& other);
+
+	// Percentile table of every histogram with samples, one line each
+	std::string FormatReport() const;
+
+	inline const HdrHistogram& GetInputCycles() const { return m_InputCycles; }
+	inline const HdrHistogram& GetInputNanoseconds() const { return m_InputNanoseconds; }
+	inline const HdrHistogram& GetPhase(FramePhase phase) const { return m_Phases[static_cast<unsigned>(phase)]; }
+
+	// Key changes the display never answered within MAX_PENDING_FRAMES, or that came while MAX_PENDING were waiting
+	inline uint64_t GetUnansweredCount() const { return m_Unanswered; }
+
+private:
+	// Key changes followed at once, one per instruction
+	static const unsigned MAX_PENDING = 32;
+
+	// A change the program ignores would otherwise be answered by whatever it draws next, maybe seconds later
+	static const unsigned MAX_PENDING_FRAMES = 120;
+
+	struct KeyChange
+	{
+		uint64_t Cycle;
+		uint64_t Time;
+		uint64_t Frame;
+	};
+
+	void OnKeypadChange(const Chip8& chip8);
+	void OnDisplayChange(const Chip8& chip8);
+
+	// Changes waiting for the display to change, oldest first
+	std::array<KeyChange, MAX_PENDING> m_Pending = {};
+	unsigned m_PendingCount = 0;
+
+	// Host times of answered changes waiting for OnPresent
+	std::array<uint64_t, MAX_PENDING> m_Answered = {};
+	unsigned m_AnsweredCount = 0;
+
+	// Keypad as last seen, and the display when the oldest pending change happened
+	uint16_t m_Keypad = 0;
+	Display m_Reference;
+
+	uint64_t m_Frame = 0;
+	uint64_t m_Unanswered = 0;
+
+	HdrHistogram m_InputCycles;
+	HdrHistogram m_InputNanoseconds;
+	std::array<HdrHistogram, static_cast<unsigned>(FramePhase::Count)> m_Phases;
+};
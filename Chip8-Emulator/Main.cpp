@@ -3,10 +3,23 @@
 #include "Shader.h"
 #include "Model.h"
 #include "Window.h"
+#include "InputQueue.h"
+#include "LatencyProbe.h"
+#include "AudioRing.h"
+#include "AudioSynth.h"
+#include "WaveOutPlayer.h"
+#include "SharedFramePublisher.h"
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <string>
 
+namespace
+{
+	// Instructions executed per 60Hz frame (roughly 660Hz)
+	const uint32_t CYCLES_PER_FRAME = 11;
+}
+
 int main(int argc, char** argv)
 {
 	int video_scale = 10;
@@ -36,9 +49,65 @@ int main(int argc, char** argv)
 	Chip8 chip8;
 	//chip8.LoadROM("IBM Logo.ch8");
 	//chip8.LoadROM("chip8-test-suite.ch8");
-	chip8.LoadROM("chip8-test-suite.ch8");
+	if (!chip8.LoadROM("chip8-test-suite.ch8"))
+		return -1;
 	//chip8.LoadROM("breakout.ch8");
-	int video_pitch = sizeof(chip8.VideoBuffer[0]) * VIDEO_WIDTH;
+
+	// The texture is always high resolution, low resolution frames are doubled up
+	std::array<uint32_t, HIRES_VIDEO_WIDTH * HIRES_VIDEO_HEIGHT> pixels = {};
+	int video_pitch = sizeof(pixels[0]) * HIRES_VIDEO_WIDTH;
+
+	// Keyboard layout, scan code to keypad key
+	const char keys[KEY_COUNT] = { 'X', '1', '2', '3', 'Q', 'W', 'E', 'A', 'S', 'D', 'Z', 'C', '4', 'R', 'F', 'V' };
+	std::array<int8_t, 256> key_map;
+	key_map.fill(-1);
+	for (unsigned i = 0; i < KEY_COUNT; ++i)
+	{
+		key_map[MapVirtualKeyW(keys[i], MAPVK_VK_TO_VSC) & 0xFF] = static_cast<int8_t>(i);
+	}
+
+	// Inputs are queued and stamped with the cycle they apply on, so presses shorter than a frame aren't lost
+	InputQueue input;
+	std::array<uint64_t, KEY_COUNT> press_cycle = {};
+	uint64_t next_event_cycle = 0;
+	window.KeyCallback = [&](WORD scan_code, bool pressed)
+	{
+		if (scan_code > 0xFF || key_map[scan_code] < 0)
+			return;
+
+		uint8_t key = key_map[scan_code];
+
+		// The queue is applied in order, so stamps only go forwards. Events on distinct cycles mean a press and release
+		// never cancel out
+		uint64_t cycle = std::max(chip8.GetCycleCount(), next_event_cycle);
+
+		// A tap shorter than a frame is held down for a whole frame of cycles, since ROMs that poll the keypad once
+		// per frame (or wait on the delay timer between polls) would never see it otherwise
+		if (pressed)
+			press_cycle[key] = cycle;
+		else
+			cycle = std::max(cycle, press_cycle[key] + CYCLES_PER_FRAME);
+
+		next_event_cycle = cycle + 1;
+		input.Push({ cycle, key, pressed });
+	};
+
+	// Audio is rendered per timer tick and played on its own thread
+	AudioRing audio_ring;
+	AudioSynth audio_synth;
+	WaveOutPlayer audio_player(&audio_ring, audio_synth.GetSampleRate());
+	audio_player.Start();
+
+	// Frames, keypad and counters for other processes to read, and keys they can hold down (see SharedFrameReader).
+	// Without it the emulator runs as normal
+	SharedFramePublisher shared_frames;
+	shared_frames.Create("Chip8", 1);
+	uint16_t injected_keys = 0;
+
+	// Frame phase times, printed on exit. Input to display latency too when started with --latency, otherwise instructions
+	// run straight through Chip8::Run
+	LatencyProbe latency;
+	const bool measure_latency = argc > 1 && std::string(argv[1]) == "--latency";
 
 	// Message loop
 	bool quit = false;
@@ -47,32 +116,50 @@ int main(int argc, char** argv)
 		// Poll window messages
 		window.Poll(&quit);
 
-		// Inputs
-		chip8.Keypad[0x0] = window.KeyState[MapVirtualKeyW('X', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0x1] = window.KeyState[MapVirtualKeyW('1', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0x2] = window.KeyState[MapVirtualKeyW('2', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0x3] = window.KeyState[MapVirtualKeyW('3', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0x4] = window.KeyState[MapVirtualKeyW('Q', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0x5] = window.KeyState[MapVirtualKeyW('W', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0x6] = window.KeyState[MapVirtualKeyW('E', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0x7] = window.KeyState[MapVirtualKeyW('A', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0x8] = window.KeyState[MapVirtualKeyW('S', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0x9] = window.KeyState[MapVirtualKeyW('D', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0xA] = window.KeyState[MapVirtualKeyW('Z', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0xB] = window.KeyState[MapVirtualKeyW('C', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0xC] = window.KeyState[MapVirtualKeyW('4', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0xD] = window.KeyState[MapVirtualKeyW('R', MAPVK_VK_TO_VSC)];
-		chip8.Keypad[0xE] = window.KeyState[MapVirtualKeyW('F', MAPVK_VK_TO_VSC)];
+		// Keys other processes hold, released again when they let go
+		if (shared_frames.IsOpen())
+		{
+			uint16_t injected = shared_frames.GetInjectedKeys(0);
+			chip8.Keypad = static_cast<uint16_t>((chip8.Keypad & ~injected_keys) | injected);
+			injected_keys = injected;
+		}
 
 		// Execute instructions
-		chip8.Cycle();
+		try
+		{
+			if (measure_latency)
+				latency.Run(chip8, CYCLES_PER_FRAME, input);
+			else
+				chip8.Run(CYCLES_PER_FRAME, input);
+		}
+		catch (const std::exception& e)
+		{
+			MessageBoxA(NULL, e.what(), "Error", MB_OK);
+			return -1;
+		}
+
+		// Timers run at 60Hz, once per presented frame
+		audio_synth.Tick(chip8, audio_ring);
+		chip8.UpdateTimers();
+
+		if (shared_frames.IsOpen())
+		{
+			shared_frames.Publish(0, chip8);
+		}
 
 		// Update screen
+		uint64_t phase_start = LatencyProbe::Now();
 		renderer.Clear();
-		model.UpdateTexture(chip8.VideoBuffer.data(), video_pitch);
+		chip8.VideoBuffer.ToRGBA(pixels.data(), HIRES_VIDEO_WIDTH, HIRES_VIDEO_HEIGHT);
+		phase_start = latency.EndPhase(FramePhase::Build, phase_start);
+		model.UpdateTexture(pixels.data(), video_pitch);
+		phase_start = latency.EndPhase(FramePhase::Upload, phase_start);
 		model.Render();
 		renderer.Present();
+		latency.EndPhase(FramePhase::Present, phase_start);
+		latency.OnPresent();
 	}
 
+	std::cout << latency.FormatReport();
 	return 0;
 }
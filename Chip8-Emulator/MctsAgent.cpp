@@ -0,0 +1,198 @@
+#include "MctsAgent.h"
+
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace
+{
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+MctsAgent::MctsAgent(std::vector<uint16_t> actions, MctsReward reward, unsigned threads)
+	: m_Actions(std::move(actions)), m_Reward(std::move(reward)), m_Workers(threads ? threads : 1)
+{
+	if (m_Actions.empty())
+	{
+		m_Actions.push_back(0);
+	}
+}
+
+uint16_t MctsAgent::Search(const Chip8& machine, unsigned rollouts)
+{
+	auto start = std::chrono::steady_clock::now();
+	const double root_reward = m_Reward(machine);
+	const unsigned threads = static_cast<unsigned>(m_Workers.size());
+
+	// Root copies are made here rather than in the workers: a whole machine is a 64KB copy, but only one per search
+	for (unsigned thread = 0; thread < threads; ++thread)
+	{
+		Worker& worker = m_Workers[thread];
+		worker.Root = machine;
+		worker.Root.ClearDirtyPages();
+		worker.Scratch = worker.Root;
+		worker.RandomState = m_Seed * 0x9E3779B9u + (static_cast<uint32_t>(m_Stats.Searches) << 8) + thread + 1;
+		worker.RandomState = worker.RandomState ? worker.RandomState : 1;
+		worker.Rollouts = worker.Frames = 0;
+		worker.Ms = worker.RestoreMs = 0.0;
+	}
+
+	std::vector<std::thread> workers;
+	for (unsigned thread = 1; thread < threads; ++thread)
+	{
+		workers.emplace_back(&MctsAgent::SearchWorker, this, std::ref(m_Workers[thread]),
+			rollouts * (thread + 1) / threads - rollouts * thread / threads, root_reward);
+	}
+
+	SearchWorker(m_Workers[0], rollouts / threads, root_reward);
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	// Most visited action over every tree
+	std::vector<uint64_t> visits(m_Actions.size(), 0);
+	for (Worker& worker : m_Workers)
+	{
+		if (worker.Tree[0].FirstChild != 0)
+		{
+			for (size_t action = 0; action < m_Actions.size(); ++action)
+			{
+				visits[action] += worker.Tree[worker.Tree[0].FirstChild + action].Visits;
+			}
+		}
+
+		m_Stats.Rollouts += worker.Rollouts;
+		m_Stats.Frames += worker.Frames;
+		m_Stats.WorkerMs += worker.Ms;
+		m_Stats.RestoreMs += worker.RestoreMs;
+		m_Stats.Nodes += worker.Tree.size();
+	}
+
+	size_t best = 0;
+	for (size_t action = 1; action < m_Actions.size(); ++action)
+	{
+		if (visits[action] > visits[best])
+			best = action;
+	}
+
+	++m_Stats.Searches;
+	m_Stats.SearchMs += MillisecondsSince(start);
+	return m_Actions[best];
+}
+
+bool MctsAgent::RunAction(Chip8& machine, uint16_t keypad) const
+{
+	machine.Keypad = keypad;
+	try
+	{
+		for (unsigned frame = 0; frame < m_FramesPerAction; ++frame)
+		{
+			for (unsigned cycle = 0; cycle < m_CyclesPerFrame && !machine.IsHalted(); ++cycle)
+			{
+				machine.Cycle();
+			}
+
+			machine.UpdateTimers();
+		}
+	}
+	catch (const std::runtime_error&)
+	{
+		return false;
+	}
+
+	return !machine.IsHalted();
+}
+
+void MctsAgent::SearchWorker(Worker& worker, unsigned rollouts, double root_reward) const
+{
+	auto start = std::chrono::steady_clock::now();
+	const uint32_t action_count = static_cast<uint32_t>(m_Actions.size());
+
+	worker.Tree.clear();
+	worker.Tree.emplace_back();
+
+	for (unsigned rollout = 0; rollout < rollouts; ++rollout)
+	{
+		auto restore_start = std::chrono::steady_clock::now();
+		worker.Scratch.Restore(worker.Root);
+		worker.RestoreMs += MillisecondsSince(restore_start);
+
+		// Selection: follow UCT down the expanded part of the tree
+		uint32_t node = 0;
+		bool alive = true;
+		worker.Path.clear();
+		worker.Path.push_back(node);
+		while (alive && worker.Tree[node].FirstChild != 0)
+		{
+			uint32_t child = SelectChild(worker, node);
+			alive = RunAction(worker.Scratch, m_Actions[child - worker.Tree[node].FirstChild]);
+			worker.Frames += m_FramesPerAction;
+			node = child;
+			worker.Path.push_back(node);
+		}
+
+		// Expansion: a leaf gets its children on its second visit, and the rollout continues from one of them
+		if (alive && worker.Tree[node].Visits != 0)
+		{
+			uint32_t first = static_cast<uint32_t>(worker.Tree.size());
+			worker.Tree[node].FirstChild = first;
+			worker.Tree.resize(worker.Tree.size() + action_count);
+
+			uint32_t action = NextRandom(worker.RandomState) % action_count;
+			alive = RunAction(worker.Scratch, m_Actions[action]);
+			worker.Frames += m_FramesPerAction;
+			node = first + action;
+			worker.Path.push_back(node);
+		}
+
+		// Simulation
+		for (unsigned frame = 0; alive && frame < m_RolloutFrames; frame += m_FramesPerAction)
+		{
+			alive = RunAction(worker.Scratch, m_Actions[NextRandom(worker.RandomState) % action_count]);
+			worker.Frames += m_FramesPerAction;
+		}
+
+		// Backpropagation
+		double reward = m_Reward(worker.Scratch) - root_reward;
+		for (uint32_t visited : worker.Path)
+		{
+			++worker.Tree[visited].Visits;
+			worker.Tree[visited].TotalReward += reward;
+		}
+	}
+
+	worker.Rollouts += rollouts;
+	worker.Ms += MillisecondsSince(start);
+}
+
+uint32_t MctsAgent::SelectChild(const Worker& worker, uint32_t node) const
+{
+	const Node& parent = worker.Tree[node];
+	const double log_visits = std::log(static_cast<double>(parent.Visits ? parent.Visits : 1));
+
+	uint32_t best = parent.FirstChild;
+	double best_score = -INFINITY;
+	for (uint32_t child = parent.FirstChild; child < parent.FirstChild + m_Actions.size(); ++child)
+	{
+		const Node& candidate = worker.Tree[child];
+		if (candidate.Visits == 0)
+		{
+			return child;
+		}
+
+		double score = candidate.TotalReward / candidate.Visits + m_Exploration * std::sqrt(log_visits / candidate.Visits);
+		if (score > best_score)
+		{
+			best = child;
+			best_score = score;
+		}
+	}
+
+	return best;
+}
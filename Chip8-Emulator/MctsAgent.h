@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Chip8.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Score of a machine state, e.g. read from where the ROM keeps its score and lives (see RamSearch). Only differences
+// matter: a rollout is worth the reward at its end minus the reward at the root. Called from the worker threads at once
+using MctsReward = std::function<double(const Chip8&)>;
+
+struct MctsStats
+{
+	// Search calls, rollouts and frames emulated over all of them
+	uint64_t Searches = 0;
+	uint64_t Rollouts = 0;
+	uint64_t Frames = 0;
+
+	// Wall time of the searches, and time summed over the workers, spent searching and restoring the root state
+	double SearchMs = 0.0;
+	double WorkerMs = 0.0;
+	double RestoreMs = 0.0;
+
+	// Tree nodes allocated, summed over the workers
+	uint64_t Nodes = 0;
+};
+
+// Monte Carlo tree search player. Each action is a keypad held for a few frames. Every rollout restores a copy of the root
+// machine (only the pages the last rollout wrote, see Chip8::Restore), replays the tree's actions down to a leaf, adds one
+// node, then plays random actions for the rollout length and scores the result. Selection is UCT.
+//
+// The workers search in parallel without sharing anything: each grows its own tree from the same root, and the action
+// visited most over all of them is played (root parallelisation). The emulator is deterministic, including CXNN, so the
+// search sees exactly what playing the actions would do
+class MctsAgent
+{
+public:
+	// Actions are keypad masks (0 for no key)
+	MctsAgent(std::vector<uint16_t> actions, MctsReward reward, unsigned threads = 1);
+
+	// Emulation speed, and frames each action is held for
+	inline void SetCyclesPerFrame(unsigned cycles) { m_CyclesPerFrame = cycles; }
+	inline void SetFramesPerAction(unsigned frames) { m_FramesPerAction = frames ? frames : 1; }
+
+	// Frames of random play after the new node
+	inline void SetRolloutFrames(unsigned frames) { m_RolloutFrames = frames; }
+
+	// UCT exploration constant, in reward units
+	inline void SetExploration(double exploration) { m_Exploration = exploration; }
+
+	// Seed of the workers' random action choices
+	inline void SetSeed(uint32_t seed) { m_Seed = seed != 0 ? seed : 1; }
+
+	// Search from machine with a budget of rollouts, split over the workers. Returns the keypad mask to play next
+	uint16_t Search(const Chip8& machine, unsigned rollouts);
+
+	// Hold an action's keypad for its frames, as the search does. Returns false if the machine halted or hit an invalid
+	// instruction
+	bool RunAction(Chip8& machine, uint16_t keypad) const;
+
+	inline unsigned GetThreadCount() const { return static_cast<unsigned>(m_Workers.size()); }
+	inline const std::vector<uint16_t>& GetActions() const { return m_Actions; }
+
+	inline const MctsStats& GetStats() const { return m_Stats; }
+	inline void ResetStats() { m_Stats = {}; }
+
+private:
+	struct Node
+	{
+		// Children are allocated together, one per action. 0 until expanded, since the root is never a child
+		uint32_t FirstChild = 0;
+		uint32_t Visits = 0;
+		double TotalReward = 0.0;
+	};
+
+	struct Worker
+	{
+		// Copy of the machine searched from, and the machine rollouts run on
+		Chip8 Root;
+		Chip8 Scratch;
+
+		std::vector<Node> Tree;
+		std::vector<uint32_t> Path;
+		uint32_t RandomState = 1;
+
+		uint64_t Rollouts = 0;
+		uint64_t Frames = 0;
+		double Ms = 0.0;
+		double RestoreMs = 0.0;
+	};
+
+	// Grow a worker's tree by a number of rollouts, scored relative to the root's reward
+	void SearchWorker(Worker& worker, unsigned rollouts, double root_reward) const;
+
+	// Child of a node with the highest UCT score, unvisited children first
+	uint32_t SelectChild(const Worker& worker, uint32_t node) const;
+
+	std::vector<uint16_t> m_Actions;
+	MctsReward m_Reward;
+
+	unsigned m_CyclesPerFrame = 11;
+	unsigned m_FramesPerAction = 4;
+	unsigned m_RolloutFrames = 60;
+	double m_Exploration = 1.0;
+	uint32_t m_Seed = 1;
+
+	std::vector<Worker> m_Workers;
+	MctsStats m_Stats;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <span>
+
+// Guest address space. XO-CHIP uses all of it, the other profiles the first 4KB
+const unsigned int MEMORY_SIZE = 0x10000;
+
+// Longest run of bytes read from a single address: a 16x16 sprite on both XO-CHIP planes
+const unsigned int MEMORY_PADDING = 64;
+
+// Writes are tracked per page
+const unsigned int MEMORY_PAGE_SIZE = 64;
+const unsigned int MEMORY_PAGE_COUNT = MEMORY_SIZE / MEMORY_PAGE_SIZE;
+
+static_assert(MEMORY_PADDING <= MEMORY_PAGE_SIZE, "The mirror has to lie within the first page");
+
+// Guest memory. Addresses wrap at 64KB: the first MEMORY_PADDING bytes are mirrored past the end, so a read starting at any
+// 16-bit address can run on for MEMORY_PADDING bytes without a bounds check. Writes go through Write, which wraps the address,
+// keeps the mirror in step and marks the page dirty, so snapshots and code caches only need to look at pages that changed
+class Memory
+{
+public:
+	// Byte at a 16-bit address, or up to MEMORY_PADDING bytes past one
+	constexpr uint8_t operator[](unsigned address) const { return m_Bytes[address]; }
+
+	// Bytes from a 16-bit address on. MEMORY_PADDING of them can be read through the pointer
+	constexpr const uint8_t* GetPointer(uint16_t address) const { return m_Bytes.data() + address; }
+
+	// Big endian word (an opcode)
+	constexpr uint16_t ReadWord(uint16_t address) const { return static_cast<uint16_t>((m_Bytes[address] << 8) | m_Bytes[address + 1]); }
+
+	constexpr void Write(unsigned address, uint8_t value)
+	{
+		address &= MEMORY_SIZE - 1;
+		m_Bytes[address] = value;
+
+		// Without a branch: outside the mirrored bytes this stores to the same byte again
+		m_Bytes[address < MEMORY_PADDING ? address + MEMORY_SIZE : address] = value;
+
+		unsigned page = address / MEMORY_PAGE_SIZE;
+		m_DirtyPages[page / 64] |= 1ull << (page % 64);
+	}
+
+	// Copy bytes in starting at address. They must fit below 64KB
+	constexpr void Load(unsigned address, std::span<const uint8_t> bytes)
+	{
+		std::copy(bytes.begin(), bytes.end(), m_Bytes.begin() + address);
+		std::copy(m_Bytes.begin(), m_Bytes.begin() + MEMORY_PADDING, m_Bytes.begin() + MEMORY_SIZE);
+
+		for (unsigned page = address / MEMORY_PAGE_SIZE; page * MEMORY_PAGE_SIZE < address + bytes.size(); ++page)
+		{
+			m_DirtyPages[page / 64] |= 1ull << (page % 64);
+		}
+	}
+
+	// The 64KB, without the mirror
+	constexpr std::span<const uint8_t, MEMORY_SIZE> GetBytes() const { return std::span<const uint8_t, MEMORY_SIZE>(m_Bytes.data(), MEMORY_SIZE); }
+
+	// Pages written since the last ClearDirtyPages, one bit each
+	constexpr bool IsPageDirty(unsigned page) const { return (m_DirtyPages[page / 64] >> (page % 64)) & 1; }
+	constexpr const std::array<uint64_t, MEMORY_PAGE_COUNT / 64>& GetDirtyPages() const { return m_DirtyPages; }
+	constexpr void ClearDirtyPages() { m_DirtyPages = {}; }
+
+	// Copy back every dirty page from snapshot and mark them clean. The snapshot has to be what this memory held when its dirty
+	// pages were last cleared
+	constexpr void RestoreDirtyPages(const Memory& snapshot)
+	{
+		for (unsigned word = 0; word < m_DirtyPages.size(); ++word)
+		{
+			for (uint64_t bits = m_DirtyPages[word]; bits != 0; bits &= bits - 1)
+			{
+				unsigned offset = (word * 64 + std::countr_zero(bits)) * MEMORY_PAGE_SIZE;
+				std::copy_n(snapshot.m_Bytes.begin() + offset, MEMORY_PAGE_SIZE, m_Bytes.begin() + offset);
+			}
+		}
+
+		// The mirror is a copy of the first page
+		if (m_DirtyPages[0] & 1)
+		{
+			std::copy_n(snapshot.m_Bytes.begin() + MEMORY_SIZE, MEMORY_PADDING, m_Bytes.begin() + MEMORY_SIZE);
+		}
+
+		m_DirtyPages = {};
+	}
+
+private:
+	std::array<uint8_t, MEMORY_SIZE + MEMORY_PADDING> m_Bytes = {};
+	std::array<uint64_t, MEMORY_PAGE_COUNT / 64> m_DirtyPages = {};
+};
@@ -0,0 +1,82 @@
+#include "MemoryAccess.h"
+#include <bit>
+
+MemoryAccess GetMemoryAccess(const Chip8& chip8)
+{
+	const auto& memory = chip8.GetMemory();
+	const QuirkProfile profile = chip8.GetQuirkProfile();
+	const unsigned pc = chip8.GetProgramCounter();
+
+	MemoryAccess access;
+	if (pc + 1 >= MEMORY_SIZE)
+	{
+		return access;
+	}
+
+	uint16_t opcode = (memory[pc] << 8) | memory[pc + 1];
+	unsigned x = (opcode >> 8) & 0xF;
+	unsigned y = (opcode >> 4) & 0xF;
+	unsigned n = opcode & 0xF;
+
+	switch (opcode >> 12)
+	{
+		case 0x5:
+			if (profile == QuirkProfile::XoChip && (n == 0x2 || n == 0x3))
+			{
+				access.Size = (x <= y ? y - x : x - y) + 1;
+				access.Type = n == 0x2 ? AccessType::Write : AccessType::Read;
+			}
+			break;
+
+		case 0xD:
+		{
+			// Stalling for the vertical blank re-runs the instruction without drawing
+			if (GetQuirkFlags(profile).DisplayWait && !chip8.IsVBlank())
+			{
+				break;
+			}
+
+			// 16x16 sprites for DXY0 outside of CHIP-8, one copy of the sprite per selected plane
+			bool wide = n == 0 && profile != QuirkProfile::Chip8;
+			access.Size = std::popcount(chip8.VideoBuffer.GetSelectedPlanes()) * (wide ? 32 : n);
+			access.Type = AccessType::Read;
+			break;
+		}
+
+		case 0xF:
+			switch (opcode & 0xFF)
+			{
+				case 0x02:
+					if (profile == QuirkProfile::XoChip && x == 0)
+					{
+						access.Size = AUDIO_PATTERN_SIZE;
+						access.Type = AccessType::Read;
+					}
+					break;
+
+				case 0x33:
+					access.Size = 3;
+					access.Type = AccessType::Write;
+					break;
+
+				case 0x55:
+					access.Size = x + 1;
+					access.Type = AccessType::Write;
+					break;
+
+				case 0x65:
+					access.Size = x + 1;
+					access.Type = AccessType::Read;
+					break;
+			}
+			break;
+	}
+
+	if (access.Size == 0)
+	{
+		access.Type = AccessType::None;
+	}
+
+	access.Address = chip8.GetIndexRegister();
+	return access;
+}
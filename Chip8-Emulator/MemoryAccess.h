@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Chip8.h"
+#include <cstdint>
+
+enum class AccessType : uint8_t
+{
+	None,
+	Read,
+	Write
+};
+
+// Data memory an instruction touches. The address is 32-bit because I plus an offset can run past 0xFFFF
+struct MemoryAccess
+{
+	uint32_t Address = 0;
+	uint32_t Size = 0;
+	AccessType Type = AccessType::None;
+};
+
+// Memory the instruction at PC is about to read or write through I (DXYN, FX33, FX55, FX65, 5XY2, 5XY3 and F002).
+// Instruction fetches, including the operand word of F000 NNNN, are not included, and a DXYN still waiting for the
+// vertical blank touches nothing
+MemoryAccess GetMemoryAccess(const Chip8& chip8);
@@ -1,4 +1,5 @@
 #include "Model.h"
+#include "Display.h"
 #include <vector>
 #include <DirectXMath.h>
 #include <DirectXColors.h>
@@ -95,10 +96,9 @@ void DX::Model::UpdateTexture(void* video_buffer, int video_pitch)
 	uint8_t* dst = static_cast<uint8_t*>(resource.pData);
 
 	// Update the texture
-	const int HEIGHT = 32;
-	for (int row = 0; row < HEIGHT; ++row)
+	for (unsigned row = 0; row < HIRES_VIDEO_HEIGHT; ++row)
 	{
-		std::memcpy(dst, src, resource.RowPitch);
+		std::memcpy(dst, src, video_pitch);
 		src += video_pitch;
 		dst += resource.RowPitch;
 	}
@@ -112,8 +112,8 @@ void DX::Model::CreateTexture()
 	auto d3dDevice = m_DxRenderer->GetDevice();
 
 	D3D11_TEXTURE2D_DESC desc = {};
-	desc.Width = 64;
-	desc.Height = 32;
+	desc.Width = HIRES_VIDEO_WIDTH;
+	desc.Height = HIRES_VIDEO_HEIGHT;
 	desc.MipLevels = desc.ArraySize = 1;
 	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 	desc.SampleDesc.Count = 1;
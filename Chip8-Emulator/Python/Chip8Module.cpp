@@ -0,0 +1,676 @@
+// Python bindings for reinforcement learning: chip8.VectorEnv runs a batch of machines on the same ROM and steps them all
+// in one call with the GIL released, writing a contiguous (count, height, width) observation array in place.
+// Memory, display and registers of each machine are NumPy arrays over the machine itself, not copies.
+//
+// Only the CPython API is used: arrays are made by handing numpy.asarray an object exporting the buffer protocol, so
+// building needs Python's headers and nothing else (see the README), and NumPy is only needed at run time
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "../Chip8.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// The bits of a byte spread out to a byte each, top bit (the leftmost pixel) first in memory
+	static_assert(std::endian::native == std::endian::little, "SPREAD_BITS is laid out for little endian");
+	constexpr std::array<uint64_t, 256> SPREAD_BITS = []()
+	{
+		std::array<uint64_t, 256> table = {};
+		for (unsigned value = 0; value < 256; ++value)
+		{
+			for (unsigned bit = 0; bit < 8; ++bit)
+			{
+				table[value] |= static_cast<uint64_t>((value >> (7 - bit)) & 1) << (bit * 8);
+			}
+		}
+
+		return table;
+	}();
+
+	// Machine status reported by step
+	const uint8_t STATUS_RUNNING = 0;
+	const uint8_t STATUS_HALTED = 1;
+	const uint8_t STATUS_FAULTED = 2;
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// Buffer: a view of memory owned by another object, for numpy.asarray to wrap
+
+	struct Buffer
+	{
+		PyObject_HEAD
+
+		// Kept alive for as long as the view (and every array made from it) exists
+		PyObject* Owner;
+
+		void* Data;
+		char const* Format;
+		Py_ssize_t ItemSize;
+		int Dimensions;
+		Py_ssize_t Shape[3];
+		Py_ssize_t Strides[3];
+		bool ReadOnly;
+	};
+
+	int BufferGet(PyObject* self, Py_buffer* view, int flags)
+	{
+		Buffer* buffer = reinterpret_cast<Buffer*>(self);
+		if ((flags & PyBUF_WRITABLE) && buffer->ReadOnly)
+		{
+			PyErr_SetString(PyExc_BufferError, "read-only view");
+			view->obj = nullptr;
+			return -1;
+		}
+
+		Py_ssize_t length = buffer->ItemSize;
+		for (int dimension = 0; dimension < buffer->Dimensions; ++dimension)
+		{
+			length *= buffer->Shape[dimension];
+		}
+
+		view->buf = buffer->Data;
+		view->obj = Py_NewRef(self);
+		view->len = length;
+		view->readonly = buffer->ReadOnly;
+		view->itemsize = buffer->ItemSize;
+		view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>(buffer->Format) : nullptr;
+		view->ndim = buffer->Dimensions;
+		view->shape = (flags & PyBUF_ND) ? buffer->Shape : nullptr;
+		view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? buffer->Strides : nullptr;
+		view->suboffsets = nullptr;
+		view->internal = nullptr;
+		return 0;
+	}
+
+	void BufferDealloc(PyObject* self)
+	{
+		Py_XDECREF(reinterpret_cast<Buffer*>(self)->Owner);
+
+		PyTypeObject* type = Py_TYPE(self);
+		type->tp_free(self);
+		Py_DECREF(type);
+	}
+
+	PyType_Slot BufferSlots[] =
+	{
+		{ Py_bf_getbuffer, reinterpret_cast<void*>(BufferGet) },
+		{ Py_tp_dealloc, reinterpret_cast<void*>(BufferDealloc) },
+		{ 0, nullptr }
+	};
+
+	PyType_Spec BufferSpec = { "chip8._Buffer", sizeof(Buffer), 0, Py_TPFLAGS_DEFAULT, BufferSlots };
+
+	// Created by PyInit_chip8
+	PyTypeObject* BufferType = nullptr;
+
+	// A C contiguous NumPy array over data, which must stay put for as long as owner lives
+	PyObject* MakeArray(PyObject* owner, const void* data, char const* format, Py_ssize_t item_size, std::initializer_list<Py_ssize_t> shape, bool read_only)
+	{
+		static PyObject* as_array = nullptr;
+		if (as_array == nullptr)
+		{
+			PyObject* numpy = PyImport_ImportModule("numpy");
+			if (numpy == nullptr)
+			{
+				return nullptr;
+			}
+
+			as_array = PyObject_GetAttrString(numpy, "asarray");
+			Py_DECREF(numpy);
+			if (as_array == nullptr)
+			{
+				return nullptr;
+			}
+		}
+
+		Buffer* buffer = PyObject_New(Buffer, BufferType);
+		if (buffer == nullptr)
+		{
+			return nullptr;
+		}
+
+		buffer->Owner = Py_NewRef(owner);
+		buffer->Data = const_cast<void*>(data);
+		buffer->Format = format;
+		buffer->ItemSize = item_size;
+		buffer->Dimensions = static_cast<int>(shape.size());
+		buffer->ReadOnly = read_only;
+
+		Py_ssize_t stride = item_size;
+		for (int dimension = buffer->Dimensions - 1; dimension >= 0; --dimension)
+		{
+			buffer->Shape[dimension] = shape.begin()[dimension];
+			buffer->Strides[dimension] = stride;
+			stride *= buffer->Shape[dimension];
+		}
+
+		PyObject* array = PyObject_CallOneArg(as_array, reinterpret_cast<PyObject*>(buffer));
+		Py_DECREF(buffer);
+		return array;
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// The machines behind a VectorEnv
+
+	class Environments
+	{
+	public:
+		Environments(const Chip8& initial, unsigned count, unsigned cycles_per_frame, bool high_resolution, unsigned threads, uint32_t seed) :
+			m_Initial(initial),
+			m_Machines(count, initial),
+			m_Status(count, STATUS_RUNNING),
+			m_CyclesPerFrame(cycles_per_frame),
+			m_Width(high_resolution ? HIRES_VIDEO_WIDTH : VIDEO_WIDTH),
+			m_Height(high_resolution ? HIRES_VIDEO_HEIGHT : VIDEO_HEIGHT),
+			m_Threads(std::max(1u, std::min(threads, count))),
+			m_Seed(seed)
+		{
+			m_Observations.resize(static_cast<size_t>(count) * m_Width * m_Height);
+			for (unsigned index = 0; index < count; ++index)
+			{
+				Reset(index);
+			}
+		}
+
+		// Back to the state just after loading, each machine with its own CXNN seed
+		void Reset(unsigned index)
+		{
+			m_Machines[index] = m_Initial;
+			m_Machines[index].Seed(m_Seed + index);
+			m_Status[index] = STATUS_RUNNING;
+			Observe(index);
+		}
+
+		// Hold each machine's keypad for frames frames and run them, in parallel over the threads
+		void Step(const uint16_t* actions, unsigned frames)
+		{
+			unsigned count = GetCount();
+			auto run = [&](unsigned first, unsigned last)
+			{
+				for (unsigned index = first; index < last; ++index)
+				{
+					StepMachine(index, actions[index], frames);
+				}
+			};
+
+			std::vector<std::thread> workers;
+			for (unsigned thread = 1; thread < m_Threads; ++thread)
+			{
+				workers.emplace_back(run, count * thread / m_Threads, count * (thread + 1) / m_Threads);
+			}
+
+			run(0, count / m_Threads);
+			for (std::thread& worker : workers)
+			{
+				worker.join();
+			}
+		}
+
+		inline unsigned GetCount() const { return static_cast<unsigned>(m_Machines.size()); }
+		inline unsigned GetWidth() const { return m_Width; }
+		inline unsigned GetHeight() const { return m_Height; }
+		inline Chip8& GetMachine(unsigned index) { return m_Machines[index]; }
+		inline uint8_t* GetObservations() { return m_Observations.data(); }
+		inline uint8_t* GetStatus() { return m_Status.data(); }
+
+	private:
+		void StepMachine(unsigned index, uint16_t keys, unsigned frames)
+		{
+			Chip8& machine = m_Machines[index];
+			if (m_Status[index] == STATUS_FAULTED)
+			{
+				return;
+			}
+
+			try
+			{
+				machine.Keypad = keys;
+				for (unsigned frame = 0; frame < frames; ++frame)
+				{
+					for (unsigned cycle = 0; cycle < m_CyclesPerFrame; ++cycle)
+					{
+						machine.Cycle();
+					}
+
+					machine.UpdateTimers();
+				}
+
+				m_Status[index] = machine.IsHalted() ? STATUS_HALTED : STATUS_RUNNING;
+			}
+			catch (const std::exception&)
+			{
+				// Invalid instruction. The machine stays as it was until reset
+				m_Status[index] = STATUS_FAULTED;
+			}
+
+			Observe(index);
+		}
+
+		// Colour index per pixel at the observation size, worked out on packed rows. A high resolution frame in a low resolution
+		// observation sets a plane's bit where any pixel of the 2x2 block has it, a low resolution frame in a high resolution
+		// one doubles its pixels
+		void Observe(unsigned index)
+		{
+			const Display& display = m_Machines[index].VideoBuffer;
+			uint8_t* pixels = m_Observations.data() + static_cast<size_t>(index) * m_Width * m_Height;
+			const unsigned words = m_Width / 64;
+
+			for (unsigned y = 0; y < m_Height; ++y)
+			{
+				// This observation row of each plane, packed like Display's
+				uint64_t rows[DISPLAY_PLANE_COUNT][DISPLAY_ROW_WORDS] = {};
+				for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+				{
+					if (display.GetWidth() == m_Width)
+					{
+						const uint64_t* row = display.GetRow(plane, y);
+						rows[plane][0] = row[0];
+						rows[plane][1] = row[1];
+					}
+					else if (display.GetWidth() > m_Width)
+					{
+						const uint64_t* top = display.GetRow(plane, y * 2);
+						const uint64_t* bottom = display.GetRow(plane, y * 2 + 1);
+						rows[plane][0] = (HalvePairs(top[0] | bottom[0]) << 32) | HalvePairs(top[1] | bottom[1]);
+					}
+					else
+					{
+						uint64_t row = display.GetRow(plane, y / 2)[0];
+						rows[plane][0] = DoubleBits(static_cast<uint32_t>(row >> 32));
+						rows[plane][1] = DoubleBits(static_cast<uint32_t>(row));
+					}
+				}
+
+				// Eight pixels at a time: each plane's byte spread to a byte per pixel, the planes combined without carries
+				for (unsigned word = 0; word < words; ++word)
+				{
+					for (unsigned shift = 64; shift != 0; shift -= 8)
+					{
+						uint64_t spread = SPREAD_BITS[(rows[0][word] >> (shift - 8)) & 0xFF] | (SPREAD_BITS[(rows[1][word] >> (shift - 8)) & 0xFF] << 1);
+						std::memcpy(pixels, &spread, sizeof(spread));
+						pixels += sizeof(spread);
+					}
+				}
+			}
+		}
+
+		// 32 bits, each the OR of a pair of neighbouring bits of value
+		static uint64_t HalvePairs(uint64_t value)
+		{
+			value = ((value | (value << 1)) >> 1) & 0x5555555555555555ull;
+			value = (value | (value >> 1)) & 0x3333333333333333ull;
+			value = (value | (value >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+			value = (value | (value >> 4)) & 0x00FF00FF00FF00FFull;
+			value = (value | (value >> 8)) & 0x0000FFFF0000FFFFull;
+			return (value | (value >> 16)) & 0x00000000FFFFFFFFull;
+		}
+
+		// Each bit of value twice
+		static uint64_t DoubleBits(uint32_t value)
+		{
+			uint64_t bits = value;
+			bits = (bits | (bits << 16)) & 0x0000FFFF0000FFFFull;
+			bits = (bits | (bits << 8)) & 0x00FF00FF00FF00FFull;
+			bits = (bits | (bits << 4)) & 0x0F0F0F0F0F0F0F0Full;
+			bits = (bits | (bits << 2)) & 0x3333333333333333ull;
+			bits = (bits | (bits << 1)) & 0x5555555555555555ull;
+			return bits | (bits << 1);
+		}
+
+		// Machine as loaded, which Reset goes back to
+		Chip8 m_Initial;
+
+		// Never resized, so the arrays handed to Python stay valid
+		std::vector<Chip8> m_Machines;
+		std::vector<uint8_t> m_Observations;
+		std::vector<uint8_t> m_Status;
+
+		unsigned m_CyclesPerFrame;
+		unsigned m_Width;
+		unsigned m_Height;
+		unsigned m_Threads;
+		uint32_t m_Seed;
+	};
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// VectorEnv
+
+	struct VectorEnv
+	{
+		PyObject_HEAD
+		Environments* Envs;
+	};
+
+	int VectorEnvInit(PyObject* self, PyObject* args, PyObject* kwargs)
+	{
+		static char const* keywords[] = { "rom", "count", "profile", "cycles_per_frame", "high_resolution", "threads", "seed", nullptr };
+
+		PyObject* rom = nullptr;
+		unsigned count = 0;
+		int profile = 0;
+		unsigned cycles_per_frame = 11;
+		int high_resolution = 0;
+		unsigned threads = 1;
+		unsigned seed = 1;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OI|iIpII", const_cast<char**>(keywords), &rom, &count, &profile, &cycles_per_frame,
+			&high_resolution, &threads, &seed))
+		{
+			return -1;
+		}
+
+		if (count == 0)
+		{
+			PyErr_SetString(PyExc_ValueError, "count must be at least 1");
+			return -1;
+		}
+
+		if (profile < 0 || profile >= static_cast<int>(QUIRK_PROFILE_COUNT))
+		{
+			PyErr_SetString(PyExc_ValueError, "unknown quirk profile");
+			return -1;
+		}
+
+		// About 70KB each, so not on the stack
+		auto initial = std::make_unique<Chip8>(static_cast<QuirkProfile>(profile));
+
+		// A path, or the ROM itself as bytes
+		bool loaded = false;
+		if (PyUnicode_Check(rom))
+		{
+			PyObject* path = nullptr;
+			if (!PyUnicode_FSConverter(rom, &path))
+			{
+				return -1;
+			}
+
+			loaded = initial->LoadROM(PyBytes_AsString(path));
+			Py_DECREF(path);
+		}
+		else
+		{
+			Py_buffer bytes;
+			if (PyObject_GetBuffer(rom, &bytes, PyBUF_SIMPLE) != 0)
+			{
+				return -1;
+			}
+
+			loaded = initial->LoadROM(std::span<const uint8_t>(static_cast<const uint8_t*>(bytes.buf), static_cast<size_t>(bytes.len)));
+			PyBuffer_Release(&bytes);
+		}
+
+		if (!loaded)
+		{
+			PyErr_SetString(PyExc_ValueError, "can't load the ROM, or it doesn't fit in memory");
+			return -1;
+		}
+
+		// Arrays already handed out point into the machines, so they can't be replaced
+		VectorEnv* env = reinterpret_cast<VectorEnv*>(self);
+		if (env->Envs != nullptr)
+		{
+			PyErr_SetString(PyExc_RuntimeError, "VectorEnv already initialised");
+			return -1;
+		}
+
+		env->Envs = new Environments(*initial, count, cycles_per_frame, high_resolution != 0, threads, seed);
+		return 0;
+	}
+
+	void VectorEnvDealloc(PyObject* self)
+	{
+		delete reinterpret_cast<VectorEnv*>(self)->Envs;
+
+		PyTypeObject* type = Py_TYPE(self);
+		type->tp_free(self);
+		Py_DECREF(type);
+	}
+
+	Environments* GetEnvironments(PyObject* self)
+	{
+		Environments* envs = reinterpret_cast<VectorEnv*>(self)->Envs;
+		if (envs == nullptr)
+		{
+			PyErr_SetString(PyExc_RuntimeError, "VectorEnv not initialised");
+		}
+
+		return envs;
+	}
+
+	bool GetIndex(Environments& envs, PyObject* arg, unsigned* index)
+	{
+		long value = PyLong_AsLong(arg);
+		if (value == -1 && PyErr_Occurred())
+		{
+			return false;
+		}
+
+		if (value < 0 || value >= static_cast<long>(envs.GetCount()))
+		{
+			PyErr_SetString(PyExc_IndexError, "environment index out of range");
+			return false;
+		}
+
+		*index = static_cast<unsigned>(value);
+		return true;
+	}
+
+	// Arrays over the observations and status. The env only hands them out: holding on to them would make a reference cycle
+	// through their buffers
+	PyObject* GetObservationArray(PyObject* self, Environments& envs)
+	{
+		return MakeArray(self, envs.GetObservations(), "B", 1, { envs.GetCount(), envs.GetHeight(), envs.GetWidth() }, true);
+	}
+
+	PyObject* GetStatusArray(PyObject* self, Environments& envs)
+	{
+		return MakeArray(self, envs.GetStatus(), "B", 1, { envs.GetCount() }, true);
+	}
+
+	PyObject* VectorEnvStep(PyObject* self, PyObject* args, PyObject* kwargs)
+	{
+		static char const* keywords[] = { "actions", "frames", nullptr };
+
+		Environments* envs = GetEnvironments(self);
+		PyObject* actions = nullptr;
+		unsigned frames = 1;
+		if (envs == nullptr || !PyArg_ParseTupleAndKeywords(args, kwargs, "O|I", const_cast<char**>(keywords), &actions, &frames))
+		{
+			return nullptr;
+		}
+
+		// The keypad bits for every machine, as a contiguous uint16 array
+		Py_buffer keys;
+		if (PyObject_GetBuffer(actions, &keys, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) != 0)
+		{
+			return nullptr;
+		}
+
+		char const* format = keys.format != nullptr ? keys.format : "B";
+		if (format[0] == '<' || format[0] == '=' || format[0] == '@')
+		{
+			++format;
+		}
+
+		if (std::strcmp(format, "H") != 0 || keys.len != static_cast<Py_ssize_t>(envs->GetCount() * sizeof(uint16_t)))
+		{
+			PyBuffer_Release(&keys);
+			PyErr_Format(PyExc_TypeError, "actions must be a uint16 array of %u keypad masks", envs->GetCount());
+			return nullptr;
+		}
+
+		Py_BEGIN_ALLOW_THREADS
+		envs->Step(static_cast<const uint16_t*>(keys.buf), frames);
+		Py_END_ALLOW_THREADS
+
+		PyBuffer_Release(&keys);
+
+		PyObject* observations = GetObservationArray(self, *envs);
+		PyObject* status = observations != nullptr ? GetStatusArray(self, *envs) : nullptr;
+		if (status == nullptr)
+		{
+			Py_XDECREF(observations);
+			return nullptr;
+		}
+
+		PyObject* result = PyTuple_Pack(2, observations, status);
+		Py_DECREF(observations);
+		Py_DECREF(status);
+		return result;
+	}
+
+	PyObject* VectorEnvReset(PyObject* self, PyObject* args)
+	{
+		Environments* envs = GetEnvironments(self);
+		PyObject* index_arg = nullptr;
+		if (envs == nullptr || !PyArg_ParseTuple(args, "|O", &index_arg))
+		{
+			return nullptr;
+		}
+
+		if (index_arg == nullptr || index_arg == Py_None)
+		{
+			for (unsigned index = 0; index < envs->GetCount(); ++index)
+			{
+				envs->Reset(index);
+			}
+		}
+		else
+		{
+			unsigned index = 0;
+			if (!GetIndex(*envs, index_arg, &index))
+			{
+				return nullptr;
+			}
+
+			envs->Reset(index);
+		}
+
+		return GetObservationArray(self, *envs);
+	}
+
+	PyObject* VectorEnvMemory(PyObject* self, PyObject* arg)
+	{
+		Environments* envs = GetEnvironments(self);
+		unsigned index = 0;
+		if (envs == nullptr || !GetIndex(*envs, arg, &index))
+		{
+			return nullptr;
+		}
+
+		// Read-only: writes have to go through the machine to keep the mirror and dirty pages right
+		return MakeArray(self, envs->GetMachine(index).GetMemory().GetBytes().data(), "B", 1, { MEMORY_SIZE }, true);
+	}
+
+	PyObject* VectorEnvDisplay(PyObject* self, PyObject* arg)
+	{
+		Environments* envs = GetEnvironments(self);
+		unsigned index = 0;
+		if (envs == nullptr || !GetIndex(*envs, arg, &index))
+		{
+			return nullptr;
+		}
+
+		// The planes are stored back to back, so one view covers both
+		return MakeArray(self, envs->GetMachine(index).VideoBuffer.GetRow(0, 0), "Q", 8, { DISPLAY_PLANE_COUNT, HIRES_VIDEO_HEIGHT, DISPLAY_ROW_WORDS }, true);
+	}
+
+	PyObject* VectorEnvRegisters(PyObject* self, PyObject* arg)
+	{
+		Environments* envs = GetEnvironments(self);
+		unsigned index = 0;
+		if (envs == nullptr || !GetIndex(*envs, arg, &index))
+		{
+			return nullptr;
+		}
+
+		return MakeArray(self, envs->GetMachine(index).GetRegisters().data(), "B", 1, { REGISTER_COUNT }, true);
+	}
+
+	PyObject* VectorEnvGetObservations(PyObject* self, void*)
+	{
+		Environments* envs = GetEnvironments(self);
+		return envs != nullptr ? GetObservationArray(self, *envs) : nullptr;
+	}
+
+	PyObject* VectorEnvGetStatus(PyObject* self, void*)
+	{
+		Environments* envs = GetEnvironments(self);
+		return envs != nullptr ? GetStatusArray(self, *envs) : nullptr;
+	}
+
+	PyObject* VectorEnvGetCount(PyObject* self, void*)
+	{
+		Environments* envs = GetEnvironments(self);
+		return envs != nullptr ? PyLong_FromUnsignedLong(envs->GetCount()) : nullptr;
+	}
+
+	PyMethodDef VectorEnvMethods[] =
+	{
+		{ "step", reinterpret_cast<PyCFunction>(reinterpret_cast<void*>(VectorEnvStep)), METH_VARARGS | METH_KEYWORDS,
+			"step(actions, frames=1) -> (observations, status)\n\n"
+			"Hold each machine's keypad (a uint16 array, one bit per key) for a number of frames and run them all with the GIL released. "
+			"Both results are views of the env's own buffers, which later steps overwrite. Status is 0 running, 1 halted (00FD), 2 faulted (invalid instruction, "
+			"stopped until reset)" },
+		{ "reset", VectorEnvReset, METH_VARARGS, "reset(index=None) -> observations\n\nReturn one machine, or all of them, to the loaded ROM" },
+		{ "memory", VectorEnvMemory, METH_O, "memory(index) -> read-only uint8 array over the machine's 64KB of memory" },
+		{ "display", VectorEnvDisplay, METH_O, "display(index) -> read-only uint64 array (planes, 64 rows, 2 words) over the packed display" },
+		{ "registers", VectorEnvRegisters, METH_O, "registers(index) -> read-only uint8 array over V0-VF" },
+		{ nullptr, nullptr, 0, nullptr }
+	};
+
+	PyGetSetDef VectorEnvGetSet[] =
+	{
+		{ "observations", VectorEnvGetObservations, nullptr, "(count, height, width) uint8 colour indices, updated in place by step and reset", nullptr },
+		{ "status", VectorEnvGetStatus, nullptr, "(count,) uint8 status of each machine after the last step", nullptr },
+		{ "count", VectorEnvGetCount, nullptr, "Number of machines", nullptr },
+		{ nullptr, nullptr, nullptr, nullptr, nullptr }
+	};
+
+	PyType_Slot VectorEnvSlots[] =
+	{
+		{ Py_tp_doc, const_cast<char*>("VectorEnv(rom, count, profile=0, cycles_per_frame=11, high_resolution=False, threads=1, seed=1)\n\n"
+			"count machines running the ROM (a path or bytes). Observations are 64x32, or 128x64 with high_resolution") },
+		{ Py_tp_new, reinterpret_cast<void*>(PyType_GenericNew) },
+		{ Py_tp_init, reinterpret_cast<void*>(VectorEnvInit) },
+		{ Py_tp_dealloc, reinterpret_cast<void*>(VectorEnvDealloc) },
+		{ Py_tp_methods, VectorEnvMethods },
+		{ Py_tp_getset, VectorEnvGetSet },
+		{ 0, nullptr }
+	};
+
+	PyType_Spec VectorEnvSpec = { "chip8.VectorEnv", sizeof(VectorEnv), 0, Py_TPFLAGS_DEFAULT, VectorEnvSlots };
+
+	PyModuleDef Module = { PyModuleDef_HEAD_INIT, "chip8", "CHIP-8 machines for reinforcement learning", -1, nullptr, nullptr, nullptr, nullptr, nullptr };
+}
+
+PyMODINIT_FUNC PyInit_chip8()
+{
+	BufferType = reinterpret_cast<PyTypeObject*>(PyType_FromSpec(&BufferSpec));
+	if (BufferType == nullptr)
+	{
+		return nullptr;
+	}
+
+	PyObject* vector_env_type = PyType_FromSpec(&VectorEnvSpec);
+	if (vector_env_type == nullptr)
+	{
+		return nullptr;
+	}
+
+	PyObject* module = PyModule_Create(&Module);
+	if (module == nullptr || PyModule_AddObject(module, "VectorEnv", vector_env_type) < 0)
+	{
+		Py_DECREF(vector_env_type);
+		Py_XDECREF(module);
+		return nullptr;
+	}
+
+	return module;
+}
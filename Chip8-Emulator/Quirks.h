@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+
+// CHIP-8 variants disagree on a handful of instructions (https://github.com/Timendus/chip8-test-suite#quirks-test)
+enum class QuirkProfile : uint8_t
+{
+	// COSMAC VIP
+	Chip8 = 0,
+
+	// SUPER-CHIP 1.1 as implemented by modern interpreters
+	SuperChip = 1,
+
+	// XO-CHIP (Octo)
+	XoChip = 2,
+};
+
+const unsigned int QUIRK_PROFILE_COUNT = 3;
+
+// Quirks are compile-time constants so every profile gets its own interpreter without runtime checks
+template <QuirkProfile Profile>
+struct Quirks;
+
+template <>
+struct Quirks<QuirkProfile::Chip8>
+{
+	// 8XY1, 8XY2 and 8XY3 reset VF to zero
+	static constexpr bool ResetVF = true;
+
+	// FX55 and FX65 leave I pointing past the last register
+	static constexpr bool IncrementIndex = true;
+
+	// DXYN waits for the vertical blank, so only one sprite is drawn per frame
+	static constexpr bool DisplayWait = true;
+
+	// Sprites are clipped at the screen edge instead of wrapping around
+	static constexpr bool ClipSprites = true;
+
+	// 8XY6 and 8XYE shift VY into VX instead of shifting VX in place
+	static constexpr bool ShiftUsesVY = true;
+
+	// BNNN jumps to XNN + VX instead of NNN + V0
+	static constexpr bool JumpUsesVX = false;
+
+	// SUPER-CHIP instructions: high resolution, scrolling, 16x16 sprites, big font, RPL flags and exit
+	static constexpr bool SuperChipInstructions = false;
+
+	// XO-CHIP instructions: 64KB memory, bitplanes, audio pattern, register ranges and scroll up
+	static constexpr bool XoChipInstructions = false;
+};
+
+template <>
+struct Quirks<QuirkProfile::SuperChip>
+{
+	static constexpr bool ResetVF = false;
+	static constexpr bool IncrementIndex = false;
+	static constexpr bool DisplayWait = false;
+	static constexpr bool ClipSprites = true;
+	static constexpr bool ShiftUsesVY = false;
+	static constexpr bool JumpUsesVX = true;
+	static constexpr bool SuperChipInstructions = true;
+	static constexpr bool XoChipInstructions = false;
+};
+
+template <>
+struct Quirks<QuirkProfile::XoChip>
+{
+	static constexpr bool ResetVF = false;
+	static constexpr bool IncrementIndex = true;
+	static constexpr bool DisplayWait = false;
+	static constexpr bool ClipSprites = false;
+	static constexpr bool ShiftUsesVY = true;
+	static constexpr bool JumpUsesVX = false;
+	static constexpr bool SuperChipInstructions = true;
+	static constexpr bool XoChipInstructions = true;
+};
+
+// The same flags as values, for code that picks the profile at run time
+struct QuirkFlags
+{
+	bool ResetVF;
+	bool IncrementIndex;
+	bool DisplayWait;
+	bool ClipSprites;
+	bool ShiftUsesVY;
+	bool JumpUsesVX;
+	bool SuperChipInstructions;
+	bool XoChipInstructions;
+};
+
+template <QuirkProfile Profile>
+constexpr QuirkFlags MakeQuirkFlags()
+{
+	using Q = Quirks<Profile>;
+	return { Q::ResetVF, Q::IncrementIndex, Q::DisplayWait, Q::ClipSprites, Q::ShiftUsesVY, Q::JumpUsesVX, Q::SuperChipInstructions, Q::XoChipInstructions };
+}
+
+constexpr QuirkFlags GetQuirkFlags(QuirkProfile profile)
+{
+	switch (profile)
+	{
+		case QuirkProfile::SuperChip:
+			return MakeQuirkFlags<QuirkProfile::SuperChip>();
+
+		case QuirkProfile::XoChip:
+			return MakeQuirkFlags<QuirkProfile::XoChip>();
+
+		default:
+			return MakeQuirkFlags<QuirkProfile::Chip8>();
+	}
+}
@@ -0,0 +1,207 @@
+#include "RamSearch.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <thread>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RAM_SEARCH_AVX2
+#endif
+
+static_assert(RAM_SEARCH_REGISTER_BASE == CHIP8_MEMORY_SIZE, "Registers follow the CHIP-8 address space");
+
+namespace
+{
+	// Bit N set where byte N of a 32-byte block passes the predicate
+	uint32_t TestBlock(const uint8_t* previous, const uint8_t* current, SearchPredicate predicate, uint8_t operand)
+	{
+#ifdef RAM_SEARCH_AVX2
+		__m256i now = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(current));
+		__m256i before = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(previous));
+		__m256i value = _mm256_set1_epi8(static_cast<char>(operand));
+
+		// Unsigned comparisons through min/max: a > b exactly when max(a, b) != b
+		__m256i pass;
+		bool invert = false;
+		switch (predicate)
+		{
+			case SearchPredicate::Equal: pass = _mm256_cmpeq_epi8(now, value); break;
+			case SearchPredicate::NotEqual: pass = _mm256_cmpeq_epi8(now, value); invert = true; break;
+			case SearchPredicate::LessThan: pass = _mm256_cmpeq_epi8(_mm256_max_epu8(now, value), now); invert = true; break;
+			case SearchPredicate::GreaterThan: pass = _mm256_cmpeq_epi8(_mm256_min_epu8(now, value), now); invert = true; break;
+			case SearchPredicate::Changed: pass = _mm256_cmpeq_epi8(now, before); invert = true; break;
+			case SearchPredicate::Unchanged: pass = _mm256_cmpeq_epi8(now, before); break;
+			case SearchPredicate::Increased: pass = _mm256_cmpeq_epi8(_mm256_max_epu8(now, before), before); invert = true; break;
+			case SearchPredicate::Decreased: pass = _mm256_cmpeq_epi8(_mm256_min_epu8(now, before), before); invert = true; break;
+			case SearchPredicate::IncreasedBy: pass = _mm256_cmpeq_epi8(now, _mm256_add_epi8(before, value)); break;
+			case SearchPredicate::DecreasedBy: pass = _mm256_cmpeq_epi8(now, _mm256_sub_epi8(before, value)); break;
+			default: return 0;
+		}
+
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(pass));
+		return invert ? ~mask : mask;
+#else
+		uint32_t mask = 0;
+		for (unsigned i = 0; i < 32; ++i)
+		{
+			uint8_t now = current[i];
+			uint8_t before = previous[i];
+			bool pass = false;
+			switch (predicate)
+			{
+				case SearchPredicate::Equal: pass = now == operand; break;
+				case SearchPredicate::NotEqual: pass = now != operand; break;
+				case SearchPredicate::LessThan: pass = now < operand; break;
+				case SearchPredicate::GreaterThan: pass = now > operand; break;
+				case SearchPredicate::Changed: pass = now != before; break;
+				case SearchPredicate::Unchanged: pass = now == before; break;
+				case SearchPredicate::Increased: pass = now > before; break;
+				case SearchPredicate::Decreased: pass = now < before; break;
+				case SearchPredicate::IncreasedBy: pass = now == static_cast<uint8_t>(before + operand); break;
+				case SearchPredicate::DecreasedBy: pass = now == static_cast<uint8_t>(before - operand); break;
+			}
+
+			mask |= static_cast<uint32_t>(pass) << i;
+		}
+
+		return mask;
+#endif
+	}
+}
+
+void RamSearch::Start(std::span<const Chip8> machines)
+{
+	m_MachineCount = static_cast<unsigned>(machines.size());
+	m_Snapshots.assign(static_cast<size_t>(m_MachineCount) * IMAGE_STRIDE, 0);
+	m_Candidates.assign(static_cast<size_t>(m_MachineCount) * BLOCK_COUNT, ~uint32_t(0));
+
+	// The padding after the registers is never a candidate
+	const unsigned tail = RAM_SEARCH_SIZE % BLOCK_SIZE;
+	for (unsigned machine = 0; machine < m_MachineCount; ++machine)
+	{
+		if (tail != 0)
+		{
+			m_Candidates[machine * BLOCK_COUNT + BLOCK_COUNT - 1] = (uint32_t(1) << tail) - 1;
+		}
+	}
+
+	ForEachRange([&](unsigned first, unsigned last)
+	{
+		for (unsigned machine = first; machine < last; ++machine)
+		{
+			for (unsigned block = 0; block < BLOCK_COUNT; ++block)
+			{
+				CopyBlock(machines[machine], block, &m_Snapshots[machine * IMAGE_STRIDE + block * BLOCK_SIZE]);
+			}
+		}
+	});
+}
+
+void RamSearch::Filter(std::span<const Chip8> machines, SearchPredicate predicate, uint8_t operand)
+{
+	const unsigned count = std::min(m_MachineCount, static_cast<unsigned>(machines.size()));
+	ForEachRange([&](unsigned first, unsigned last)
+	{
+		alignas(32) uint8_t current[BLOCK_SIZE];
+		for (unsigned machine = first; machine < std::min(last, count); ++machine)
+		{
+			uint32_t* candidates = &m_Candidates[machine * BLOCK_COUNT];
+			uint8_t* snapshot = &m_Snapshots[machine * IMAGE_STRIDE];
+			for (unsigned block = 0; block < BLOCK_COUNT; ++block)
+			{
+				if (candidates[block] == 0)
+				{
+					continue;
+				}
+
+				uint8_t* previous = snapshot + block * BLOCK_SIZE;
+				CopyBlock(machines[machine], block, current);
+				candidates[block] &= TestBlock(previous, current, predicate, operand);
+				std::memcpy(previous, current, BLOCK_SIZE);
+			}
+		}
+	});
+}
+
+uint64_t RamSearch::GetCandidateCount() const
+{
+	uint64_t count = 0;
+	for (uint32_t word : m_Candidates)
+	{
+		count += std::popcount(word);
+	}
+
+	return count;
+}
+
+unsigned RamSearch::GetCandidateCount(unsigned machine) const
+{
+	unsigned count = 0;
+	for (unsigned block = 0; block < BLOCK_COUNT; ++block)
+	{
+		count += std::popcount(m_Candidates[machine * BLOCK_COUNT + block]);
+	}
+
+	return count;
+}
+
+void RamSearch::GetCandidates(unsigned machine, std::vector<uint16_t>& addresses, size_t limit) const
+{
+	addresses.clear();
+	for (unsigned block = 0; block < BLOCK_COUNT && addresses.size() < limit; ++block)
+	{
+		for (uint32_t word = m_Candidates[machine * BLOCK_COUNT + block]; word != 0 && addresses.size() < limit; word &= word - 1)
+		{
+			addresses.push_back(static_cast<uint16_t>(block * BLOCK_SIZE + std::countr_zero(word)));
+		}
+	}
+}
+
+void RamSearch::CountVotes(std::vector<uint32_t>& votes) const
+{
+	votes.assign(RAM_SEARCH_SIZE, 0);
+	for (unsigned machine = 0; machine < m_MachineCount; ++machine)
+	{
+		for (unsigned block = 0; block < BLOCK_COUNT; ++block)
+		{
+			for (uint32_t word = m_Candidates[machine * BLOCK_COUNT + block]; word != 0; word &= word - 1)
+			{
+				++votes[block * BLOCK_SIZE + std::countr_zero(word)];
+			}
+		}
+	}
+}
+
+template <typename Function>
+void RamSearch::ForEachRange(Function function) const
+{
+	unsigned threads = std::max(1u, std::min(m_Threads, m_MachineCount));
+
+	std::vector<std::thread> workers;
+	for (unsigned thread = 1; thread < threads; ++thread)
+	{
+		workers.emplace_back(function, m_MachineCount * thread / threads, m_MachineCount * (thread + 1) / threads);
+	}
+
+	function(0, m_MachineCount / threads);
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void RamSearch::CopyBlock(const Chip8& machine, unsigned block, uint8_t* destination)
+{
+	const unsigned start = block * BLOCK_SIZE;
+	if (start + BLOCK_SIZE <= RAM_SEARCH_REGISTER_BASE)
+	{
+		std::memcpy(destination, machine.GetMemory().GetPointer(static_cast<uint16_t>(start)), BLOCK_SIZE);
+		return;
+	}
+
+	// The block with the registers, zero padded
+	std::memset(destination, 0, BLOCK_SIZE);
+	std::memcpy(destination, machine.GetRegisters().data(), machine.GetRegisters().size());
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Chip8.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Searched image of a machine: the 4KB CHIP-8 address space, then V0-VF at RAM_SEARCH_REGISTER_BASE + X. XO-CHIP's memory
+// above 4KB isn't searched
+const unsigned int RAM_SEARCH_REGISTER_BASE = 0x1000;
+const unsigned int RAM_SEARCH_SIZE = RAM_SEARCH_REGISTER_BASE + REGISTER_COUNT;
+
+// Tests on each candidate byte. The first four compare with an operand, the rest with the byte's value in the previous
+// snapshot. Comparisons are unsigned and IncreasedBy/DecreasedBy wrap around like 7XNN
+enum class SearchPredicate : uint8_t
+{
+	Equal,
+	NotEqual,
+	LessThan,
+	GreaterThan,
+	Changed,
+	Unchanged,
+	Increased,
+	Decreased,
+	IncreasedBy,
+	DecreasedBy,
+};
+
+// Cheat finder: keeps a set of candidate addresses per machine and narrows it with predicates over successive snapshots,
+// to find where a ROM keeps its score, lives or state. Candidates are a bit per byte, and each 32-byte block is tested
+// at once (AVX2 when the build targets it). Blocks with no candidates left are neither tested nor copied, so narrowing
+// gets cheaper as the sets shrink and stays interactive over thousands of machines
+class RamSearch
+{
+public:
+	explicit RamSearch(unsigned threads = 1) : m_Threads(threads ? threads : 1) {}
+
+	// Snapshot the machines and make every address of each one a candidate
+	void Start(std::span<const Chip8> machines);
+
+	// Snapshot the machines again and keep the candidates where the predicate holds. The machines must be the ones given
+	// to Start, in the same order
+	void Filter(std::span<const Chip8> machines, SearchPredicate predicate, uint8_t operand = 0);
+
+	inline unsigned GetMachineCount() const { return m_MachineCount; }
+
+	// Candidates over every machine, or in one
+	uint64_t GetCandidateCount() const;
+	unsigned GetCandidateCount(unsigned machine) const;
+
+	// Addresses still a candidate in a machine, at most limit of them, lowest first
+	void GetCandidates(unsigned machine, std::vector<uint16_t>& addresses, size_t limit = SIZE_MAX) const;
+
+	// Value of an address in a machine's latest snapshot. Only meaningful for candidates
+	inline uint8_t GetValue(unsigned machine, uint16_t address) const { return m_Snapshots[machine * IMAGE_STRIDE + address]; }
+
+	// For every address, the number of machines it is still a candidate in. Over machines given different inputs the
+	// address that passes in most of them is the likeliest answer
+	void CountVotes(std::vector<uint32_t>& votes) const;
+
+private:
+	static const unsigned BLOCK_SIZE = 32;
+	static const unsigned BLOCK_COUNT = (RAM_SEARCH_SIZE + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	static const unsigned IMAGE_STRIDE = BLOCK_COUNT * BLOCK_SIZE;
+
+	// Run a function over machine ranges, in parallel over the threads
+	template <typename Function>
+	void ForEachRange(Function function) const;
+
+	// Copy one block of a machine's image into a snapshot
+	static void CopyBlock(const Chip8& machine, unsigned block, uint8_t* destination);
+
+	unsigned m_Threads;
+	unsigned m_MachineCount = 0;
+
+	// Latest image of each machine, IMAGE_STRIDE bytes apart. Only the blocks that still have candidates are kept up to date
+	std::vector<uint8_t> m_Snapshots;
+
+	// Candidate bits, BLOCK_COUNT words per machine, bit N of a word for byte N of its block
+	std::vector<uint32_t> m_Candidates;
+};
@@ -0,0 +1,576 @@
+#include "ReferenceInterpreter.h"
+
+namespace
+{
+	// True if count bytes starting at address are inside memory
+	bool InMemory(unsigned address, unsigned count)
+	{
+		return address + count <= MEMORY_SIZE;
+	}
+
+	// Number of bytes at I a DXYN with this height reads
+	unsigned SpriteSize(const Display& display, unsigned rows, bool wide)
+	{
+		unsigned planes = 0;
+		for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+		{
+			planes += (display.GetSelectedPlanes() >> plane) & 1;
+		}
+
+		return planes * rows * (wide ? 2 : 1);
+	}
+
+	bool DrawSprite(Display& display, unsigned x, unsigned y, const uint8_t* sprite, unsigned rows, bool wide, bool clip)
+	{
+		const unsigned width = display.GetWidth();
+		const unsigned height = display.GetHeight();
+		const unsigned sprite_width = wide ? 16 : 8;
+
+		x %= width;
+		y %= height;
+
+		bool collision = false;
+		for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+		{
+			if (!(display.GetSelectedPlanes() & (1 << plane)))
+			{
+				continue;
+			}
+
+			for (unsigned row = 0; row < rows; ++row)
+			{
+				unsigned pixel_y = y + row;
+				if (pixel_y >= height)
+				{
+					if (clip)
+					{
+						break;
+					}
+
+					pixel_y -= height;
+				}
+
+				unsigned bits = wide ? (sprite[row * 2] << 8) | sprite[row * 2 + 1] : sprite[row];
+				for (unsigned column = 0; column < sprite_width; ++column)
+				{
+					if (!((bits >> (sprite_width - 1 - column)) & 1))
+					{
+						continue;
+					}
+
+					unsigned pixel_x = x + column;
+					if (pixel_x >= width)
+					{
+						if (clip)
+						{
+							continue;
+						}
+
+						pixel_x -= width;
+					}
+
+					bool on = display.GetPlanePixel(plane, pixel_x, pixel_y);
+					collision |= on;
+					display.SetPlanePixel(plane, pixel_x, pixel_y, !on);
+				}
+			}
+
+			sprite += rows * (wide ? 2 : 1);
+		}
+
+		return collision;
+	}
+
+	void Clear(Display& display)
+	{
+		for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+		{
+			if (display.GetSelectedPlanes() & (1 << plane))
+			{
+				for (unsigned y = 0; y < HIRES_VIDEO_HEIGHT; ++y)
+				{
+					for (unsigned x = 0; x < HIRES_VIDEO_WIDTH; ++x)
+					{
+						display.SetPlanePixel(plane, x, y, false);
+					}
+				}
+			}
+		}
+	}
+
+	// Move every pixel of the selected planes by (dx, dy), blanking what is scrolled in
+	void Scroll(Display& display, int dx, int dy)
+	{
+		const int width = display.GetWidth();
+		const int height = display.GetHeight();
+
+		for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+		{
+			if (!(display.GetSelectedPlanes() & (1 << plane)))
+			{
+				continue;
+			}
+
+			Display source = display;
+			for (int y = 0; y < height; ++y)
+			{
+				for (int x = 0; x < width; ++x)
+				{
+					int source_x = x - dx;
+					int source_y = y - dy;
+					bool on = source_x >= 0 && source_x < width && source_y >= 0 && source_y < height && source.GetPlanePixel(plane, source_x, source_y);
+					display.SetPlanePixel(plane, x, y, on);
+				}
+			}
+		}
+	}
+}
+
+ReferenceResult ReferenceCycle(Chip8State& state)
+{
+	const QuirkFlags quirks = GetQuirkFlags(state.Profile);
+
+	uint16_t pc = state.ProgramCounter;
+	if (!InMemory(pc, 2))
+	{
+		return ReferenceResult::MemoryFault;
+	}
+
+	uint16_t opcode = (state.Memory[pc] << 8) | state.Memory[pc + 1];
+	unsigned x = (opcode >> 8) & 0xF;
+	unsigned y = (opcode >> 4) & 0xF;
+	unsigned n = opcode & 0xF;
+	uint8_t nn = opcode & 0xFF;
+	uint16_t nnn = opcode & 0xFFF;
+	uint8_t vx = state.Registers[x];
+	uint8_t vy = state.Registers[y];
+	uint16_t i = state.IndexRegister;
+
+	// Work out where the next instruction is before changing anything, so a fault leaves the state untouched
+	uint16_t next = pc + 2;
+	bool skip_fault = false;
+	auto skip = [&]()
+	{
+		if (quirks.XoChipInstructions)
+		{
+			if (!InMemory(next, 2))
+			{
+				skip_fault = true;
+				return;
+			}
+
+			if (state.Memory[next] == 0xF0 && state.Memory[next + 1] == 0x00)
+			{
+				next += 2;
+			}
+		}
+
+		next += 2;
+	};
+
+	auto invalid = [&]()
+	{
+		// The fast core has already fetched when it throws
+		state.ProgramCounter = next;
+		++state.CycleCount;
+		return ReferenceResult::InvalidInstruction;
+	};
+
+	auto& v = state.Registers;
+	switch (opcode >> 12)
+	{
+		case 0x0:
+			if (opcode == 0x00E0)
+			{
+				Clear(state.VideoBuffer);
+			}
+			else if (opcode == 0x00EE)
+			{
+				state.StackPointer = (state.StackPointer - 1) & (STACK_LEVELS - 1);
+				next = state.Stack[state.StackPointer];
+			}
+			else if (quirks.SuperChipInstructions && (opcode & 0xFFF0) == 0x00C0)
+			{
+				Scroll(state.VideoBuffer, 0, n);
+			}
+			else if (quirks.XoChipInstructions && (opcode & 0xFFF0) == 0x00D0)
+			{
+				Scroll(state.VideoBuffer, 0, -static_cast<int>(n));
+			}
+			else if (quirks.SuperChipInstructions && opcode == 0x00FB)
+			{
+				Scroll(state.VideoBuffer, 4, 0);
+			}
+			else if (quirks.SuperChipInstructions && opcode == 0x00FC)
+			{
+				Scroll(state.VideoBuffer, -4, 0);
+			}
+			else if (quirks.SuperChipInstructions && opcode == 0x00FD)
+			{
+				state.Halted = true;
+				next = pc;
+			}
+			else if (quirks.SuperChipInstructions && opcode == 0x00FE)
+			{
+				state.VideoBuffer.SetHighResolution(false);
+			}
+			else if (quirks.SuperChipInstructions && opcode == 0x00FF)
+			{
+				state.VideoBuffer.SetHighResolution(true);
+			}
+
+			// Any other 0NNN is a machine code call, which is ignored
+			break;
+
+		case 0x1:
+			next = nnn;
+			break;
+
+		case 0x2:
+			state.Stack[state.StackPointer] = next;
+			state.StackPointer = (state.StackPointer + 1) & (STACK_LEVELS - 1);
+			next = nnn;
+			break;
+
+		case 0x3:
+			if (vx == nn)
+				skip();
+			break;
+
+		case 0x4:
+			if (vx != nn)
+				skip();
+			break;
+
+		case 0x5:
+			if (n == 0x0)
+			{
+				if (vx == vy)
+					skip();
+			}
+			else if (quirks.XoChipInstructions && (n == 0x2 || n == 0x3))
+			{
+				unsigned count = (x <= y ? y - x : x - y) + 1;
+				if (!InMemory(i, count))
+				{
+					return ReferenceResult::MemoryFault;
+				}
+
+				for (unsigned offset = 0; offset < count; ++offset)
+				{
+					unsigned reg = x <= y ? x + offset : x - offset;
+					if (n == 0x2)
+						state.Memory[i + offset] = v[reg];
+					else
+						v[reg] = state.Memory[i + offset];
+				}
+			}
+			else
+			{
+				return invalid();
+			}
+			break;
+
+		case 0x6:
+			v[x] = nn;
+			break;
+
+		case 0x7:
+			v[x] = vx + nn;
+			break;
+
+		case 0x8:
+			switch (n)
+			{
+				case 0x0:
+					v[x] = vy;
+					break;
+
+				case 0x1:
+				case 0x2:
+				case 0x3:
+					v[x] = n == 0x1 ? vx | vy : n == 0x2 ? vx & vy : vx ^ vy;
+					if (quirks.ResetVF)
+						v[0xF] = 0;
+					break;
+
+				case 0x4:
+					v[x] = vx + vy;
+					v[0xF] = vx + vy > 0xFF;
+					break;
+
+				case 0x5:
+					v[x] = vx - vy;
+					v[0xF] = vx >= vy;
+					break;
+
+				case 0x6:
+				{
+					uint8_t value = quirks.ShiftUsesVY ? vy : vx;
+					v[x] = value >> 1;
+					v[0xF] = value & 1;
+					break;
+				}
+
+				case 0x7:
+					v[x] = vy - vx;
+					v[0xF] = vy >= vx;
+					break;
+
+				case 0xE:
+				{
+					uint8_t value = quirks.ShiftUsesVY ? vy : vx;
+					v[x] = value << 1;
+					v[0xF] = value >> 7;
+					break;
+				}
+
+				default:
+					return invalid();
+			}
+			break;
+
+		case 0x9:
+			if (vx != vy)
+				skip();
+			break;
+
+		case 0xA:
+			state.IndexRegister = nnn;
+			break;
+
+		case 0xB:
+			next = nnn + (quirks.JumpUsesVX ? vx : v[0]);
+			break;
+
+		case 0xC:
+			v[x] = NextRandom(state.RandomState) & nn;
+			break;
+
+		case 0xD:
+		{
+			if (quirks.DisplayWait)
+			{
+				if (!state.VBlank)
+				{
+					next = pc;
+					break;
+				}
+			}
+
+			unsigned rows = n;
+			bool wide = false;
+			if (quirks.SuperChipInstructions && rows == 0)
+			{
+				rows = 16;
+				wide = true;
+			}
+
+			if (!InMemory(i, SpriteSize(state.VideoBuffer, rows, wide)))
+			{
+				return ReferenceResult::MemoryFault;
+			}
+
+			state.VBlank = false;
+			v[0xF] = DrawSprite(state.VideoBuffer, vx, vy, &state.Memory[i], rows, wide, quirks.ClipSprites);
+			break;
+		}
+
+		case 0xE:
+			if (nn == 0x9E)
+			{
+				if ((state.Keypad >> (vx & 0xF)) & 1)
+					skip();
+			}
+			else if (nn == 0xA1)
+			{
+				if (!((state.Keypad >> (vx & 0xF)) & 1))
+					skip();
+			}
+			else
+			{
+				return invalid();
+			}
+			break;
+
+		case 0xF:
+			switch (nn)
+			{
+				case 0x00:
+					if (!quirks.XoChipInstructions || x != 0)
+					{
+						return invalid();
+					}
+
+					if (!InMemory(next, 2))
+					{
+						return ReferenceResult::MemoryFault;
+					}
+
+					state.IndexRegister = (state.Memory[next] << 8) | state.Memory[next + 1];
+					next += 2;
+					break;
+
+				case 0x01:
+					if (!quirks.XoChipInstructions)
+					{
+						return invalid();
+					}
+
+					state.VideoBuffer.SelectPlanes(x);
+					break;
+
+				case 0x02:
+					if (!quirks.XoChipInstructions || x != 0)
+					{
+						return invalid();
+					}
+
+					if (!InMemory(i, AUDIO_PATTERN_SIZE))
+					{
+						return ReferenceResult::MemoryFault;
+					}
+
+					for (unsigned offset = 0; offset < AUDIO_PATTERN_SIZE; ++offset)
+					{
+						state.AudioPattern[offset] = state.Memory[i + offset];
+					}
+					break;
+
+				case 0x07:
+					v[x] = state.DelayTimer;
+					break;
+
+				case 0x0A:
+				{
+					uint16_t released = state.KeyWaitMask & ~state.Keypad;
+					state.KeyWaitMask |= state.Keypad;
+					if (released == 0)
+					{
+						next = pc;
+						break;
+					}
+
+					unsigned key = 0;
+					while (!((released >> key) & 1))
+					{
+						++key;
+					}
+
+					v[x] = key;
+					state.KeyWaitMask = 0;
+					break;
+				}
+
+				case 0x15:
+					state.DelayTimer = vx;
+					break;
+
+				case 0x18:
+					state.SoundTimer = vx;
+					break;
+
+				case 0x1E:
+					state.IndexRegister = i + vx;
+					break;
+
+				case 0x29:
+					state.IndexRegister = FONTSET_START_ADDRESS + 5 * (vx & 0xF);
+					break;
+
+				case 0x30:
+					if (!quirks.SuperChipInstructions)
+					{
+						return invalid();
+					}
+
+					state.IndexRegister = BIG_FONTSET_START_ADDRESS + 10 * (vx & 0xF);
+					break;
+
+				case 0x33:
+					if (!InMemory(i, 3))
+					{
+						return ReferenceResult::MemoryFault;
+					}
+
+					state.Memory[i] = vx / 100;
+					state.Memory[i + 1] = vx / 10 % 10;
+					state.Memory[i + 2] = vx % 10;
+					break;
+
+				case 0x3A:
+					if (!quirks.XoChipInstructions)
+					{
+						return invalid();
+					}
+
+					state.Pitch = vx;
+					break;
+
+				case 0x55:
+				case 0x65:
+					if (!InMemory(i, x + 1))
+					{
+						return ReferenceResult::MemoryFault;
+					}
+
+					for (unsigned offset = 0; offset <= x; ++offset)
+					{
+						if (nn == 0x55)
+							state.Memory[i + offset] = v[offset];
+						else
+							v[offset] = state.Memory[i + offset];
+					}
+
+					if (quirks.IncrementIndex)
+					{
+						state.IndexRegister = i + x + 1;
+					}
+					break;
+
+				case 0x75:
+				case 0x85:
+					if (!quirks.SuperChipInstructions)
+					{
+						return invalid();
+					}
+
+					for (unsigned offset = 0; offset <= x; ++offset)
+					{
+						if (nn == 0x75)
+							state.RplFlags[offset] = v[offset];
+						else
+							v[offset] = state.RplFlags[offset];
+					}
+					break;
+
+				default:
+					return invalid();
+			}
+			break;
+	}
+
+	if (skip_fault)
+	{
+		return ReferenceResult::MemoryFault;
+	}
+
+	state.ProgramCounter = next;
+	++state.CycleCount;
+	return ReferenceResult::Ok;
+}
+
+void ReferenceUpdateTimers(Chip8State& state)
+{
+	if (state.DelayTimer > 0)
+	{
+		--state.DelayTimer;
+	}
+
+	if (state.SoundTimer > 0)
+	{
+		--state.SoundTimer;
+	}
+
+	state.VBlank = true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Chip8State.h"
+
+enum class ReferenceResult : uint8_t
+{
+	// The instruction executed
+	Ok,
+
+	// The opcode is not valid for the quirk profile (the fast core throws)
+	InvalidInstruction,
+
+	// The instruction would have read or written outside of memory. The state is left as it was before the instruction
+	MemoryFault
+};
+
+// A deliberately simple CHIP-8 interpreter working on a Chip8State. Quirks are checked at run time, every memory access is
+// bounds checked and the display is drawn and scrolled a pixel at a time, so it shares none of the fast paths in Chip8 and
+// Display. It exists to be compared against Chip8 instruction by instruction
+ReferenceResult ReferenceCycle(Chip8State& state);
+
+// Same as Chip8::UpdateTimers
+void ReferenceUpdateTimers(Chip8State& state);
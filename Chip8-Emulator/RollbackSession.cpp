@@ -0,0 +1,162 @@
+#include "RollbackSession.h"
+
+#include <algorithm>
+#include <chrono>
+
+RollbackSession::RollbackSession(Chip8& machine, RollbackTransport& transport, uint16_t local_keys_mask, uint16_t remote_keys_mask, unsigned cycles_per_frame) :
+	m_Machine(machine),
+	m_Transport(transport),
+	m_LocalKeysMask(local_keys_mask),
+	m_RemoteKeysMask(remote_keys_mask),
+	m_CyclesPerFrame(cycles_per_frame),
+	m_Snapshots(ROLLBACK_WINDOW, machine)
+{
+}
+
+bool RollbackSession::AdvanceFrame(uint16_t local_keys)
+{
+	uint32_t mispredicted = ReceiveInputs();
+	if (mispredicted < m_Frame)
+	{
+		Rollback(mispredicted);
+	}
+
+	// Too far ahead to roll back, or to hold on to the input the remote side is still missing
+	if (m_Frame - m_RemoteConfirmed >= ROLLBACK_WINDOW || m_Frame + 1 - m_RemoteAck > INPUT_HISTORY)
+	{
+		++m_Stats.Stalls;
+		SendInputs();
+		return false;
+	}
+
+	m_LocalInputs[m_Frame % INPUT_HISTORY] = local_keys;
+	SimulateFrame(m_Frame);
+	++m_Frame;
+	++m_Stats.Frames;
+
+	SendInputs();
+	return true;
+}
+
+void RollbackSession::Poll()
+{
+	uint32_t mispredicted = ReceiveInputs();
+	if (mispredicted < m_Frame)
+	{
+		Rollback(mispredicted);
+	}
+
+	SendInputs();
+}
+
+void RollbackSession::RunFrame(Chip8& machine, uint16_t keypad, unsigned cycles_per_frame)
+{
+	machine.Keypad = keypad;
+	for (unsigned cycle = 0; cycle < cycles_per_frame; ++cycle)
+	{
+		machine.Cycle();
+	}
+
+	machine.UpdateTimers();
+}
+
+uint32_t RollbackSession::ReceiveInputs()
+{
+	uint32_t mispredicted = m_Frame;
+
+	InputPacket packet;
+	while (m_Transport.Receive(&packet))
+	{
+		// Acknowledgements only go forwards, an old packet can arrive after a newer one
+		if (packet.Ack > m_RemoteAck && packet.Ack <= m_Frame)
+		{
+			m_RemoteAck = packet.Ack;
+		}
+
+		// Only take input that carries on from what we have. The remote side never runs more than a window ahead of our
+		// input, so anything further on is garbage
+		if (packet.FirstFrame > m_RemoteConfirmed || packet.FirstFrame + packet.Count <= m_RemoteConfirmed)
+		{
+			continue;
+		}
+
+		uint32_t last = packet.FirstFrame + packet.Count;
+		if (last > m_Frame + ROLLBACK_WINDOW + 1)
+		{
+			continue;
+		}
+
+		for (uint32_t frame = m_RemoteConfirmed; frame < last; ++frame)
+		{
+			uint16_t keys = packet.Keys[frame - packet.FirstFrame];
+			m_RemoteInputs[frame % INPUT_HISTORY] = keys;
+
+			if (frame < m_Frame && frame < mispredicted && ((m_RemoteUsed[frame % INPUT_HISTORY] ^ keys) & m_RemoteKeysMask))
+			{
+				mispredicted = frame;
+			}
+		}
+
+		m_RemoteConfirmed = last;
+	}
+
+	return mispredicted;
+}
+
+void RollbackSession::SendInputs()
+{
+	InputPacket packet;
+	packet.FirstFrame = m_RemoteAck;
+	packet.Ack = m_RemoteConfirmed;
+
+	// AdvanceFrame stalls before this could overflow the history
+	packet.Count = static_cast<uint8_t>(m_Frame - m_RemoteAck);
+	for (unsigned index = 0; index < packet.Count; ++index)
+	{
+		packet.Keys[index] = m_LocalInputs[(packet.FirstFrame + index) % INPUT_HISTORY];
+	}
+
+	m_Transport.Send(packet);
+}
+
+void RollbackSession::Rollback(uint32_t frame)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	m_Machine = m_Snapshots[frame % ROLLBACK_WINDOW];
+	for (uint32_t resimulated = frame; resimulated < m_Frame; ++resimulated)
+	{
+		SimulateFrame(resimulated);
+	}
+
+	double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	unsigned depth = m_Frame - frame;
+	++m_Stats.Rollbacks;
+	m_Stats.ResimulatedFrames += depth;
+	++m_Stats.DepthHistogram[depth];
+	m_Stats.MaxDepth = std::max(m_Stats.MaxDepth, depth);
+	m_Stats.TotalResimulationMs += elapsed;
+	m_Stats.MaxResimulationMs = std::max(m_Stats.MaxResimulationMs, elapsed);
+}
+
+void RollbackSession::SimulateFrame(uint32_t frame)
+{
+	m_Snapshots[frame % ROLLBACK_WINDOW] = m_Machine;
+
+	// Predict that the remote keypad is held as it was last seen
+	uint16_t remote = 0;
+	if (frame < m_RemoteConfirmed)
+	{
+		remote = m_RemoteInputs[frame % INPUT_HISTORY];
+	}
+	else if (m_RemoteConfirmed > 0)
+	{
+		remote = m_RemoteInputs[(m_RemoteConfirmed - 1) % INPUT_HISTORY];
+	}
+
+	m_RemoteUsed[frame % INPUT_HISTORY] = remote;
+
+	uint16_t keypad = (m_LocalInputs[frame % INPUT_HISTORY] & m_LocalKeysMask) | (remote & m_RemoteKeysMask);
+	RunFrame(m_Machine, keypad, m_CyclesPerFrame);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Chip8.h"
+#include "RollbackTransport.h"
+#include <cstdint>
+#include <array>
+#include <vector>
+
+// Frames the session runs ahead of the last confirmed remote input before it stalls, which is also the deepest rollback
+const unsigned int ROLLBACK_WINDOW = 16;
+
+// Remote input can be confirmed up to a window ahead of the local frame as well as a window behind it
+static_assert(INPUT_HISTORY > 2 * ROLLBACK_WINDOW, "The input history has to cover a window either side of the current frame");
+
+struct RollbackStats
+{
+	// Frames advanced
+	uint64_t Frames = 0;
+
+	// Late inputs that differed from the prediction, and the frames run again to correct them
+	uint64_t Rollbacks = 0;
+	uint64_t ResimulatedFrames = 0;
+
+	// AdvanceFrame calls that waited for the remote side instead of running a frame
+	uint64_t Stalls = 0;
+
+	// Rollbacks by depth in frames
+	std::array<uint64_t, ROLLBACK_WINDOW + 1> DepthHistogram = {};
+	unsigned MaxDepth = 0;
+
+	// Wall time spent restoring and resimulating
+	double TotalResimulationMs = 0.0;
+	double MaxResimulationMs = 0.0;
+};
+
+// Two players on one machine over a network, GGPO style. Each side runs its frame as soon as it has its own input, predicting
+// that the remote keypad hasn't changed since the last state it received. When the real remote input turns out to differ, the
+// machine goes back to its snapshot of the first wrong frame and runs forward again with the corrected input, all inside
+// one AdvanceFrame. Both sides end up with the same state because the emulation is deterministic given the keypad each frame.
+// The keypad is split between the players by mask
+class RollbackSession
+{
+public:
+	// The machine should be loaded and identical (ROM, quirk profile, seed) on both sides
+	RollbackSession(Chip8& machine, RollbackTransport& transport, uint16_t local_keys_mask, uint16_t remote_keys_mask, unsigned cycles_per_frame);
+
+	// Run the next frame with this side's keypad. Returns false, without running it, while the remote side is a whole window behind
+	bool AdvanceFrame(uint16_t local_keys);
+
+	// Take in remote input (rolling back if needed) and resend local input, without advancing. For idling while stalled or
+	// once play has finished, so the other side can catch up
+	void Poll();
+
+	// One frame the same way the session runs it, for replaying the inputs offline
+	static void RunFrame(Chip8& machine, uint16_t keypad, unsigned cycles_per_frame);
+
+	// Frames run so far
+	inline uint32_t GetFrame() const { return m_Frame; }
+
+	// Frames of remote input received so far. Everything before min(GetFrame(), GetConfirmedFrame()) is final
+	inline uint32_t GetConfirmedFrame() const { return m_RemoteConfirmed; }
+
+	// First frame of local input the remote side doesn't have yet
+	inline uint32_t GetAcknowledgedFrame() const { return m_RemoteAck; }
+
+	inline const RollbackStats& GetStats() const { return m_Stats; }
+
+private:
+	// Read every packet waiting. Returns the earliest frame already run with a wrong prediction, or m_Frame if there is none
+	uint32_t ReceiveInputs();
+
+	// Send local input from the remote side's acknowledgement up to the last frame run
+	void SendInputs();
+
+	// Go back to the snapshot of frame and run forward to the current frame again
+	void Rollback(uint32_t frame);
+
+	// Save the snapshot for frame, work out the keypad and run it
+	void SimulateFrame(uint32_t frame);
+
+	Chip8& m_Machine;
+	RollbackTransport& m_Transport;
+	uint16_t m_LocalKeysMask;
+	uint16_t m_RemoteKeysMask;
+	unsigned m_CyclesPerFrame;
+
+	// Next frame to run
+	uint32_t m_Frame = 0;
+
+	// Next remote frame to receive. Input arrives in order, anything after a gap is dropped and arrives again later
+	uint32_t m_RemoteConfirmed = 0;
+
+	// Remote side's m_RemoteConfirmed, as of its latest packet
+	uint32_t m_RemoteAck = 0;
+
+	// Inputs by frame % INPUT_HISTORY: this side's, the remote side's as received, and the remote keypad each frame was
+	// actually run with (a prediction until confirmed)
+	std::array<uint16_t, INPUT_HISTORY> m_LocalInputs = {};
+	std::array<uint16_t, INPUT_HISTORY> m_RemoteInputs = {};
+	std::array<uint16_t, INPUT_HISTORY> m_RemoteUsed = {};
+
+	// Machine at the start of each of the last ROLLBACK_WINDOW frames, by frame % ROLLBACK_WINDOW
+	std::vector<Chip8> m_Snapshots;
+
+	RollbackStats m_Stats;
+};
@@ -0,0 +1,329 @@
+#include "RollbackTransport.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(sockaddr_in) <= 16, "The remote address is stored in 16 bytes");
+
+size_t InputPacket::Encode(std::span<uint8_t, INPUT_PACKET_MAX_SIZE> bytes) const
+{
+	size_t size = 0;
+	auto put = [&](uint32_t value, unsigned count)
+	{
+		for (unsigned index = 0; index < count; ++index)
+		{
+			bytes[size++] = static_cast<uint8_t>(value >> (index * 8));
+		}
+	};
+
+	put(FirstFrame, 4);
+	put(Ack, 4);
+	put(Count, 1);
+	for (unsigned index = 0; index < Count; ++index)
+	{
+		put(Keys[index], 2);
+	}
+
+	return size;
+}
+
+bool InputPacket::Decode(std::span<const uint8_t> bytes)
+{
+	if (bytes.size() < 9)
+	{
+		return false;
+	}
+
+	auto get = [&](size_t offset, unsigned count)
+	{
+		uint32_t value = 0;
+		for (unsigned index = 0; index < count; ++index)
+		{
+			value |= static_cast<uint32_t>(bytes[offset + index]) << (index * 8);
+		}
+
+		return value;
+	};
+
+	FirstFrame = get(0, 4);
+	Ack = get(4, 4);
+	Count = static_cast<uint8_t>(get(8, 1));
+	if (Count > INPUT_HISTORY || bytes.size() != 9 + 2 * static_cast<size_t>(Count))
+	{
+		return false;
+	}
+
+	for (unsigned index = 0; index < Count; ++index)
+	{
+		Keys[index] = static_cast<uint16_t>(get(9 + 2 * index, 2));
+	}
+
+	return true;
+}
+
+void LoopbackTransport::Connect(LoopbackTransport& a, LoopbackTransport& b)
+{
+	a.m_Peer = &b;
+	b.m_Peer = &a;
+}
+
+void LoopbackTransport::Send(const InputPacket& packet)
+{
+	if (m_Peer != nullptr)
+	{
+		m_Peer->m_Received.push_back(packet);
+	}
+}
+
+bool LoopbackTransport::Receive(InputPacket* packet)
+{
+	if (m_Received.empty())
+	{
+		return false;
+	}
+
+	*packet = m_Received.front();
+	m_Received.pop_front();
+	return true;
+}
+
+#ifdef _WIN32
+
+using SocketHandle = SOCKET;
+
+static bool StartSockets()
+{
+	// Reference counted by Winsock, balanced by WSACleanup in the destructor
+	WSADATA data;
+	return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+}
+
+static void StopSockets()
+{
+	WSACleanup();
+}
+
+static bool SetNonBlocking(SocketHandle handle)
+{
+	u_long enabled = 1;
+	return ioctlsocket(handle, FIONBIO, &enabled) == 0;
+}
+
+static void CloseSocket(SocketHandle handle)
+{
+	closesocket(handle);
+}
+
+#else
+
+using SocketHandle = int;
+const SocketHandle INVALID_SOCKET = -1;
+
+static bool StartSockets()
+{
+	return true;
+}
+
+static void StopSockets()
+{
+}
+
+static bool SetNonBlocking(SocketHandle handle)
+{
+	int flags = fcntl(handle, F_GETFL, 0);
+	return flags >= 0 && fcntl(handle, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static void CloseSocket(SocketHandle handle)
+{
+	close(handle);
+}
+
+#endif
+
+UdpTransport::UdpTransport()
+{
+	m_Started = StartSockets();
+}
+
+UdpTransport::~UdpTransport()
+{
+	Close();
+
+	if (m_Started)
+	{
+		StopSockets();
+	}
+}
+
+bool UdpTransport::Open(uint16_t port)
+{
+	Close();
+
+	if (!m_Started)
+	{
+		return false;
+	}
+
+	SocketHandle handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (handle == INVALID_SOCKET)
+	{
+		return false;
+	}
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || !SetNonBlocking(handle))
+	{
+		CloseSocket(handle);
+		return false;
+	}
+
+	m_Socket = static_cast<intptr_t>(handle);
+	return true;
+}
+
+bool UdpTransport::Connect(char const* address, uint16_t port)
+{
+	sockaddr_in remote = {};
+	remote.sin_family = AF_INET;
+	remote.sin_port = htons(port);
+	if (inet_pton(AF_INET, address, &remote.sin_addr) != 1)
+	{
+		return false;
+	}
+
+	std::memcpy(m_Remote.data(), &remote, sizeof(remote));
+	m_Connected = true;
+	return true;
+}
+
+uint16_t UdpTransport::GetPort() const
+{
+	if (m_Socket == -1)
+	{
+		return 0;
+	}
+
+	sockaddr_in address = {};
+	socklen_t length = sizeof(address);
+	if (getsockname(static_cast<SocketHandle>(m_Socket), reinterpret_cast<sockaddr*>(&address), &length) != 0)
+	{
+		return 0;
+	}
+
+	return ntohs(address.sin_port);
+}
+
+void UdpTransport::Send(const InputPacket& packet)
+{
+	if (m_Socket == -1 || !m_Connected)
+	{
+		return;
+	}
+
+	std::array<uint8_t, INPUT_PACKET_MAX_SIZE> bytes;
+	size_t size = packet.Encode(bytes);
+
+	// Losing a datagram is fine, the next one carries the same inputs
+	sendto(static_cast<SocketHandle>(m_Socket), reinterpret_cast<const char*>(bytes.data()), static_cast<int>(size), 0,
+		reinterpret_cast<const sockaddr*>(m_Remote.data()), sizeof(sockaddr_in));
+}
+
+bool UdpTransport::Receive(InputPacket* packet)
+{
+	if (m_Socket == -1)
+	{
+		return false;
+	}
+
+	// Skip anything that doesn't decode, so a stray datagram can't stall the session
+	std::array<uint8_t, INPUT_PACKET_MAX_SIZE + 1> bytes;
+	for (;;)
+	{
+		auto size = recv(static_cast<SocketHandle>(m_Socket), reinterpret_cast<char*>(bytes.data()), static_cast<int>(bytes.size()), 0);
+		if (size < 0)
+		{
+			return false;
+		}
+
+		if (packet->Decode(std::span<const uint8_t>(bytes.data(), static_cast<size_t>(size))))
+		{
+			return true;
+		}
+	}
+}
+
+void UdpTransport::Close()
+{
+	if (m_Socket != -1)
+	{
+		CloseSocket(static_cast<SocketHandle>(m_Socket));
+	}
+
+	m_Socket = -1;
+}
+
+LatencyTransport::LatencyTransport(RollbackTransport& inner, unsigned latency, unsigned jitter, unsigned loss_percent, uint32_t seed) :
+	m_Inner(inner),
+	m_Latency(latency),
+	m_Jitter(jitter),
+	m_LossPercent(loss_percent),
+	m_Random(seed != 0 ? seed : 1)
+{
+}
+
+void LatencyTransport::Tick()
+{
+	++m_Time;
+}
+
+void LatencyTransport::Send(const InputPacket& packet)
+{
+	m_Inner.Send(packet);
+}
+
+bool LatencyTransport::Receive(InputPacket* packet)
+{
+	// Take everything that has arrived and give it an arrival time of its own, which is what reorders packets
+	InputPacket arrived;
+	while (m_Inner.Receive(&arrived))
+	{
+		m_Random ^= m_Random << 13;
+		m_Random ^= m_Random >> 17;
+		m_Random ^= m_Random << 5;
+
+		if (m_Random % 100 < m_LossPercent)
+		{
+			continue;
+		}
+
+		unsigned delay = m_Latency + (m_Jitter != 0 ? (m_Random >> 8) % (m_Jitter + 1) : 0);
+		m_Pending.push_back({ m_Time + delay, arrived });
+	}
+
+	for (auto pending = m_Pending.begin(); pending != m_Pending.end(); ++pending)
+	{
+		if (pending->Due <= m_Time)
+		{
+			*packet = pending->Packet;
+			m_Pending.erase(pending);
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <deque>
+#include <span>
+#include <vector>
+
+// Frames of local input kept for resending until the other side acknowledges them
+const unsigned int INPUT_HISTORY = 64;
+
+// Largest encoded InputPacket
+const unsigned int INPUT_PACKET_MAX_SIZE = 4 + 4 + 1 + 2 * INPUT_HISTORY;
+
+// Keypad states for a run of consecutive frames, plus how far the sender has got with the receiver's input
+struct InputPacket
+{
+	// Frame of Keys[0]
+	uint32_t FirstFrame = 0;
+
+	// First frame of the receiver's input the sender hasn't got yet
+	uint32_t Ack = 0;
+
+	// Keypad for FirstFrame, FirstFrame + 1, ...
+	uint8_t Count = 0;
+	std::array<uint16_t, INPUT_HISTORY> Keys = {};
+
+	// Little endian wire format. Decode returns false for a malformed packet
+	size_t Encode(std::span<uint8_t, INPUT_PACKET_MAX_SIZE> bytes) const;
+	bool Decode(std::span<const uint8_t> bytes);
+};
+
+// Unreliable, unordered delivery of input packets to the other player
+class RollbackTransport
+{
+public:
+	virtual ~RollbackTransport() = default;
+
+	virtual void Send(const InputPacket& packet) = 0;
+
+	// Take the next packet that has arrived. Returns false if there isn't one
+	virtual bool Receive(InputPacket* packet) = 0;
+};
+
+// Two transports in the same process connected back to back. Delivery is immediate
+class LoopbackTransport : public RollbackTransport
+{
+public:
+	LoopbackTransport() = default;
+
+	// Connect a and b to each other
+	static void Connect(LoopbackTransport& a, LoopbackTransport& b);
+
+	void Send(const InputPacket& packet) override;
+	bool Receive(InputPacket* packet) override;
+
+private:
+	LoopbackTransport* m_Peer = nullptr;
+	std::deque<InputPacket> m_Received;
+};
+
+// Datagrams over UDP
+class UdpTransport : public RollbackTransport
+{
+public:
+	UdpTransport();
+	~UdpTransport();
+
+	UdpTransport(const UdpTransport&) = delete;
+	UdpTransport& operator=(const UdpTransport&) = delete;
+
+	// Bind to a local port (0 picks a free one). Returns false on failure
+	bool Open(uint16_t port);
+
+	// Where packets are sent (IPv4 address in dotted form)
+	bool Connect(char const* address, uint16_t port);
+
+	// Port bound by Open
+	uint16_t GetPort() const;
+
+	void Send(const InputPacket& packet) override;
+	bool Receive(InputPacket* packet) override;
+
+private:
+	void Close();
+
+	// Socket library initialised (Winsock needs it)
+	bool m_Started = false;
+
+	// SOCKET or file descriptor, -1 when closed
+	intptr_t m_Socket = -1;
+
+	// sockaddr_in to send to, kept as bytes so the header doesn't pull in the socket headers
+	std::array<uint8_t, 16> m_Remote = {};
+	bool m_Connected = false;
+};
+
+// Wraps another transport and delays, reorders and drops packets on the receiving side, to test rollback without a real
+// network. Time is counted in calls to Tick (one per frame)
+class LatencyTransport : public RollbackTransport
+{
+public:
+	LatencyTransport(RollbackTransport& inner, unsigned latency, unsigned jitter, unsigned loss_percent, uint32_t seed);
+
+	void Tick();
+
+	void Send(const InputPacket& packet) override;
+	bool Receive(InputPacket* packet) override;
+
+private:
+	struct Delayed
+	{
+		uint64_t Due;
+		InputPacket Packet;
+	};
+
+	RollbackTransport& m_Inner;
+
+	// Frames every packet is held for, plus up to m_Jitter more at random
+	unsigned m_Latency;
+	unsigned m_Jitter;
+	unsigned m_LossPercent;
+
+	// xorshift state
+	uint32_t m_Random;
+
+	// Ticks so far
+	uint64_t m_Time = 0;
+
+	// Received but not yet due, in arrival order
+	std::vector<Delayed> m_Pending;
+};
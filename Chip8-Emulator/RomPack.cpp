@@ -0,0 +1,154 @@
+#include "RomPack.h"
+#include "Hash.h"
+#include <algorithm>
+#include <fstream>
+
+bool RomPack::Open(char const* filename)
+{
+	m_Entries = {};
+	if (!m_File.Open(filename))
+	{
+		return false;
+	}
+
+	std::span<const uint8_t> data = m_File.GetData();
+	if (data.size() < sizeof(RomPackHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const RomPackHeader* header = reinterpret_cast<const RomPackHeader*>(data.data());
+	if (header->Magic != ROM_PACK_MAGIC || header->Version != ROM_PACK_VERSION)
+	{
+		Close();
+		return false;
+	}
+
+	uint64_t index_end = sizeof(RomPackHeader) + static_cast<uint64_t>(header->Count) * sizeof(RomPackEntry);
+	if (index_end > data.size())
+	{
+		Close();
+		return false;
+	}
+
+	// The index is used in place, so validate every entry once up front
+	const RomPackEntry* entries = reinterpret_cast<const RomPackEntry*>(data.data() + sizeof(RomPackHeader));
+	for (uint32_t i = 0; i < header->Count; ++i)
+	{
+		const RomPackEntry& entry = entries[i];
+		if (entry.Size == 0 || entry.Size > MAX_ROM_SIZE || entry.Offset < index_end || static_cast<uint64_t>(entry.Offset) + entry.Size > data.size())
+		{
+			Close();
+			return false;
+		}
+
+		if (i > 0 && entries[i - 1].Hash > entry.Hash)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	m_Entries = { entries, header->Count };
+	return true;
+}
+
+void RomPack::Close()
+{
+	m_Entries = {};
+	m_File.Close();
+}
+
+const RomPackEntry* RomPack::Find(uint64_t hash) const
+{
+	auto it = std::lower_bound(m_Entries.begin(), m_Entries.end(), hash, [](const RomPackEntry& entry, uint64_t value)
+	{
+		return entry.Hash < value;
+	});
+
+	if (it == m_Entries.end() || it->Hash != hash)
+	{
+		return nullptr;
+	}
+
+	return &*it;
+}
+
+std::span<const uint8_t> RomPack::GetData(const RomPackEntry& entry) const
+{
+	return m_File.GetData().subspan(entry.Offset, entry.Size);
+}
+
+bool LoadFromPack(Chip8& chip8, const RomPack& pack, const RomPackEntry& entry)
+{
+	chip8.SetQuirkProfile(static_cast<QuirkProfile>(entry.Profile));
+	return chip8.LoadROM(pack.GetData(entry));
+}
+
+bool WriteRomPack(char const* filename, const std::vector<RomPackInput>& roms)
+{
+	// Build the index
+	std::vector<RomPackEntry> entries;
+	std::vector<const RomPackInput*> inputs;
+	for (const RomPackInput& rom : roms)
+	{
+		if (rom.Data.empty() || rom.Data.size() > MAX_ROM_SIZE)
+		{
+			return false;
+		}
+
+		RomPackEntry entry;
+		entry.Hash = XXHash64(rom.Data.data(), rom.Data.size());
+		entry.Size = static_cast<uint32_t>(rom.Data.size());
+		entry.ClockHz = rom.ClockHz;
+		entry.Profile = rom.Profile;
+
+		entries.push_back(entry);
+		inputs.push_back(&rom);
+	}
+
+	// Sort by hash and drop duplicates
+	std::vector<size_t> order(entries.size());
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		order[i] = i;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return entries[a].Hash < entries[b].Hash; });
+	order.erase(std::unique(order.begin(), order.end(), [&](size_t a, size_t b) { return entries[a].Hash == entries[b].Hash; }), order.end());
+
+	RomPackHeader header;
+	header.Count = static_cast<uint32_t>(order.size());
+
+	// Lay out the data after the index
+	std::vector<RomPackEntry> index;
+	uint64_t offset = sizeof(RomPackHeader) + order.size() * sizeof(RomPackEntry);
+	for (size_t i : order)
+	{
+		RomPackEntry entry = entries[i];
+		entry.Offset = static_cast<uint32_t>(offset);
+		offset += entry.Size;
+		index.push_back(entry);
+	}
+
+	if (offset > UINT32_MAX)
+	{
+		return false;
+	}
+
+	std::ofstream file(filename, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(RomPackEntry));
+	for (size_t i : order)
+	{
+		file.write(reinterpret_cast<const char*>(inputs[i]->Data.data()), inputs[i]->Data.size());
+	}
+
+	return static_cast<bool>(file);
+}
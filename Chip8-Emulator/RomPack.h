@@ -0,0 +1,86 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Chip8.h"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// ROM pack file layout (little endian):
+//   RomPackHeader
+//   RomPackEntry[Count], sorted by Hash
+//   ROM data
+const uint32_t ROM_PACK_MAGIC = 0x4B503843; // "C8PK"
+const uint32_t ROM_PACK_VERSION = 1;
+
+struct RomPackHeader
+{
+	uint32_t Magic = ROM_PACK_MAGIC;
+	uint32_t Version = ROM_PACK_VERSION;
+	uint32_t Count = 0;
+	uint32_t Reserved = 0;
+};
+
+struct RomPackEntry
+{
+	// xxHash64 of the ROM data
+	uint64_t Hash = 0;
+
+	// Location of the ROM data from the start of the file
+	uint32_t Offset = 0;
+	uint32_t Size = 0;
+
+	// Recommended instructions per second (0 for the frontend default)
+	uint32_t ClockHz = 0;
+
+	// Quirk profile the ROM was written for (a QuirkProfile value)
+	uint8_t Profile = 0;
+	uint8_t Reserved[3] = {};
+};
+
+static_assert(sizeof(RomPackHeader) == 16, "RomPackHeader layout is part of the file format");
+static_assert(sizeof(RomPackEntry) == 24, "RomPackEntry layout is part of the file format");
+
+// Memory mapped ROM pack. ROM data is handed out as views into the mapping, nothing is copied
+class RomPack
+{
+public:
+	RomPack() = default;
+
+	// Map and validate a pack. A pack that fails validation is unmapped again
+	bool Open(char const* filename);
+
+	// Unmap the pack
+	void Close();
+
+	// Number of ROMs in the pack
+	inline uint32_t GetCount() const { return static_cast<uint32_t>(m_Entries.size()); }
+
+	// Index entries, sorted by hash
+	inline std::span<const RomPackEntry> GetEntries() const { return m_Entries; }
+
+	// Find a ROM by content hash. Returns nullptr if it is not in the pack
+	const RomPackEntry* Find(uint64_t hash) const;
+
+	// ROM bytes for an entry
+	std::span<const uint8_t> GetData(const RomPackEntry& entry) const;
+
+private:
+	MappedFile m_File;
+	std::span<const RomPackEntry> m_Entries;
+};
+
+// Select the interpreter for the ROM's quirk profile and load the ROM
+bool LoadFromPack(Chip8& chip8, const RomPack& pack, const RomPackEntry& entry);
+
+// A ROM to be written into a pack
+struct RomPackInput
+{
+	std::vector<uint8_t> Data;
+	uint32_t ClockHz = 0;
+	uint8_t Profile = 0;
+};
+
+// Write a pack file. Duplicate ROMs (same hash) are stored once
+bool WriteRomPack(char const* filename, const std::vector<RomPackInput>& roms);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+
+// Layout of the shared memory segment an emulator publishes its machines in (see SharedFramePublisher and SharedFrameReader).
+// This header stands alone so other programs can read the segment without the emulator's sources
+
+// "C8FB" in little endian byte order
+const uint32_t SHARED_FRAME_MAGIC = 0x42463843;
+
+// Bumped whenever the layout changes
+const uint32_t SHARED_FRAME_VERSION = 1;
+
+// Display size in packed form: the same as Display, one bit per pixel, two 64-bit words per 128 pixel row, leftmost pixel
+// in the most significant bit of the first word. Low resolution frames use the first word of the first 32 rows
+const unsigned int SHARED_FRAME_ROW_WORDS = 2;
+const unsigned int SHARED_FRAME_ROWS = 64;
+const unsigned int SHARED_FRAME_PLANES = 2;
+
+// One published frame of a machine
+struct SharedFrameData
+{
+	// Frames published so far on this slot, counting this one
+	uint64_t Frame = 0;
+	uint64_t CycleCount = 0;
+
+	// When the frame was published, in steady clock nanoseconds (CLOCK_MONOTONIC, or QueryPerformanceCounter on Windows),
+	// which every process on the machine shares
+	int64_t PublishTime = 0;
+
+	uint16_t ProgramCounter = 0;
+	uint16_t IndexRegister = 0;
+
+	// Keypad the frame ran with, one bit per key
+	uint16_t Keypad = 0;
+	uint8_t DelayTimer = 0;
+	uint8_t SoundTimer = 0;
+	uint8_t HighResolution = 0;
+	uint8_t Halted = 0;
+
+	std::array<std::array<std::array<uint64_t, SHARED_FRAME_ROW_WORDS>, SHARED_FRAME_ROWS>, SHARED_FRAME_PLANES> Planes = {};
+};
+
+// One machine. Data is guarded by a seqlock: the emulator makes Sequence odd, writes Data and makes it even again, and a
+// reader copies Data out between two reads of Sequence and keeps the copy only if both were the same even number.
+// Readers never block the emulator
+struct alignas(64) SharedFrameSlot
+{
+	std::atomic<uint32_t> Sequence = 0;
+
+	SharedFrameData Data;
+
+	// Written by readers: keys held down on top of the emulator's own input, one bit per key. On its own cache line so key
+	// presses don't disturb the frame data
+	alignas(64) std::atomic<uint16_t> InjectedKeys = 0;
+};
+
+// Start of the segment, followed by SlotCount slots
+struct alignas(64) SharedFrameHeader
+{
+	// Written last by the emulator, so a reader that finds it has a fully set up segment
+	std::atomic<uint32_t> Magic = 0;
+	uint32_t Version = 0;
+	uint32_t SlotCount = 0;
+	uint32_t SlotSize = 0;
+};
+
+// Atomics in memory mapped into two processes only work if they don't need a lock
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint16_t>::is_always_lock_free, "Shared atomics must be lock free");
+
+// Bytes needed for slot_count machines
+constexpr size_t GetSharedFrameSize(unsigned slot_count)
+{
+	return sizeof(SharedFrameHeader) + slot_count * sizeof(SharedFrameSlot);
+}
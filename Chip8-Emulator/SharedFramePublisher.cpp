@@ -0,0 +1,69 @@
+#include "SharedFramePublisher.h"
+
+#include <chrono>
+#include <new>
+
+static_assert(SHARED_FRAME_ROW_WORDS == DISPLAY_ROW_WORDS && SHARED_FRAME_ROWS == HIRES_VIDEO_HEIGHT && SHARED_FRAME_PLANES == DISPLAY_PLANE_COUNT,
+	"The shared frame layout has to match Display");
+
+bool SharedFramePublisher::Create(char const* name, unsigned slot_count)
+{
+	Close();
+
+	if (slot_count == 0 || !m_Memory.Create(name, GetSharedFrameSize(slot_count)))
+	{
+		return false;
+	}
+
+	// The segment starts out zero filled, construct the atomics in it properly anyway
+	m_Header = new (m_Memory.GetData()) SharedFrameHeader;
+	m_Slots = new (m_Memory.GetData() + sizeof(SharedFrameHeader)) SharedFrameSlot[slot_count];
+	m_SlotCount = slot_count;
+
+	m_Header->Version = SHARED_FRAME_VERSION;
+	m_Header->SlotCount = slot_count;
+	m_Header->SlotSize = sizeof(SharedFrameSlot);
+	m_Header->Magic.store(SHARED_FRAME_MAGIC, std::memory_order_release);
+	return true;
+}
+
+void SharedFramePublisher::Close()
+{
+	m_Memory.Close();
+	m_Header = nullptr;
+	m_Slots = nullptr;
+	m_SlotCount = 0;
+}
+
+void SharedFramePublisher::Publish(unsigned slot, const Chip8& machine)
+{
+	SharedFrameSlot& target = m_Slots[slot];
+	SharedFrameData& data = target.Data;
+
+	// Odd while writing. The fence keeps the writes below from being seen before the odd sequence
+	uint32_t sequence = target.Sequence.load(std::memory_order_relaxed);
+	target.Sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	data.Frame += 1;
+	data.CycleCount = machine.GetCycleCount();
+	data.PublishTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	data.ProgramCounter = machine.GetProgramCounter();
+	data.IndexRegister = machine.GetIndexRegister();
+	data.Keypad = machine.Keypad;
+	data.DelayTimer = machine.GetDelayTimer();
+	data.SoundTimer = machine.GetSoundTimer();
+	data.HighResolution = machine.VideoBuffer.IsHighResolution();
+	data.Halted = machine.IsHalted();
+
+	for (unsigned plane = 0; plane < DISPLAY_PLANE_COUNT; ++plane)
+	{
+		for (unsigned y = 0; y < HIRES_VIDEO_HEIGHT; ++y)
+		{
+			const uint64_t* row = machine.VideoBuffer.GetRow(plane, y);
+			data.Planes[plane][y] = { row[0], row[1] };
+		}
+	}
+
+	target.Sequence.store(sequence + 2, std::memory_order_release);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Chip8.h"
+#include "SharedFrame.h"
+#include "SharedMemory.h"
+
+// Emulator side of the shared frame segment: publishes display, keypad and counters of one or more machines every frame and
+// picks up keys injected by readers
+class SharedFramePublisher
+{
+public:
+	SharedFramePublisher() = default;
+
+	// Create the segment with a slot per machine
+	bool Create(char const* name, unsigned slot_count);
+
+	// Remove the segment. Readers keep what they have mapped, but no new frames arrive
+	void Close();
+
+	inline bool IsOpen() const { return m_Header != nullptr; }
+	inline unsigned GetSlotCount() const { return m_SlotCount; }
+
+	// Publish the machine's current frame. Only the emulation thread should call it for a given slot
+	void Publish(unsigned slot, const Chip8& machine);
+
+	// Keys readers are holding down on a slot
+	inline uint16_t GetInjectedKeys(unsigned slot) const { return m_Slots[slot].InjectedKeys.load(std::memory_order_relaxed); }
+
+private:
+	SharedMemory m_Memory;
+	SharedFrameHeader* m_Header = nullptr;
+	SharedFrameSlot* m_Slots = nullptr;
+	unsigned m_SlotCount = 0;
+};
@@ -0,0 +1,74 @@
+#include "SharedFrameReader.h"
+
+#include <cstring>
+#include <thread>
+
+bool SharedFrameReader::Open(char const* name)
+{
+	Close();
+
+	if (!m_Memory.Open(name) || m_Memory.GetSize() < sizeof(SharedFrameHeader))
+	{
+		m_Memory.Close();
+		return false;
+	}
+
+	const SharedFrameHeader* header = reinterpret_cast<const SharedFrameHeader*>(m_Memory.GetData());
+	if (header->Magic.load(std::memory_order_acquire) != SHARED_FRAME_MAGIC || header->Version != SHARED_FRAME_VERSION ||
+		header->SlotSize != sizeof(SharedFrameSlot) || m_Memory.GetSize() < GetSharedFrameSize(header->SlotCount))
+	{
+		m_Memory.Close();
+		return false;
+	}
+
+	m_Header = header;
+	m_Slots = reinterpret_cast<SharedFrameSlot*>(m_Memory.GetData() + sizeof(SharedFrameHeader));
+	m_SlotCount = header->SlotCount;
+	return true;
+}
+
+void SharedFrameReader::Close()
+{
+	m_Memory.Close();
+	m_Header = nullptr;
+	m_Slots = nullptr;
+	m_SlotCount = 0;
+}
+
+bool SharedFrameReader::Read(unsigned slot, SharedFrameData* frame, uint32_t* sequence) const
+{
+	return ReadInPlace(slot, [&](const SharedFrameData& data)
+	{
+		std::memcpy(static_cast<void*>(frame), &data, sizeof(data));
+		if (sequence != nullptr)
+		{
+			*sequence = GetSequence(slot);
+		}
+	});
+}
+
+bool SharedFrameReader::WaitForFrame(unsigned slot, uint32_t sequence, std::chrono::microseconds timeout) const
+{
+	// Frames come 16ms apart, so after a short spin give the core back
+	const unsigned spins = 4096;
+
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+	for (unsigned spin = 0;; ++spin)
+	{
+		uint32_t current = GetSequence(slot);
+		if (current != sequence && !(current & 1))
+		{
+			return true;
+		}
+
+		if (spin >= spins)
+		{
+			if (std::chrono::steady_clock::now() >= deadline)
+			{
+				return false;
+			}
+
+			std::this_thread::yield();
+		}
+	}
+}
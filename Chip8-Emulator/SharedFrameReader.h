@@ -0,0 +1,73 @@
+#pragma once
+
+#include "SharedFrame.h"
+#include "SharedMemory.h"
+#include <chrono>
+
+// Consumer side of the shared frame segment, for bots and dashboards in other processes. Needs only SharedFrame.h,
+// SharedMemory and this class, not the emulator
+class SharedFrameReader
+{
+public:
+	SharedFrameReader() = default;
+
+	// Map a segment the emulator has created. Fails if it isn't there yet or has a different layout version
+	bool Open(char const* name);
+	void Close();
+
+	inline bool IsOpen() const { return m_Header != nullptr; }
+	inline unsigned GetSlotCount() const { return m_SlotCount; }
+
+	// Goes up by two every published frame, odd while one is being written. A cheap way to poll for a new frame
+	inline uint32_t GetSequence(unsigned slot) const { return m_Slots[slot].Sequence.load(std::memory_order_acquire); }
+
+	// Copy out the latest frame. Returns false only if the emulator was writing every time it tried
+	bool Read(unsigned slot, SharedFrameData* frame, uint32_t* sequence = nullptr) const;
+
+	// Look at the latest frame where it lies, without copying it. function may see a frame being overwritten, so it must only
+	// read, and whatever it worked out counts only if this returns true
+	template <typename Function>
+	bool ReadInPlace(unsigned slot, Function&& function) const;
+
+	// Spin, then yield, until a frame after sequence is published. Returns false on timeout
+	bool WaitForFrame(unsigned slot, uint32_t sequence, std::chrono::microseconds timeout) const;
+
+	// Hold keys down on top of the emulator's own input (one bit per key)
+	inline void SetInjectedKeys(unsigned slot, uint16_t keys) { m_Slots[slot].InjectedKeys.store(keys, std::memory_order_relaxed); }
+	inline void PressKey(unsigned slot, uint8_t key) { m_Slots[slot].InjectedKeys.fetch_or(static_cast<uint16_t>(1u << (key & 0xF)), std::memory_order_relaxed); }
+	inline void ReleaseKey(unsigned slot, uint8_t key) { m_Slots[slot].InjectedKeys.fetch_and(static_cast<uint16_t>(~(1u << (key & 0xF))), std::memory_order_relaxed); }
+
+private:
+	// Attempts before Read gives up. The emulator holds a slot odd for well under a microsecond
+	static const unsigned READ_ATTEMPTS = 1000;
+
+	SharedMemory m_Memory;
+	const SharedFrameHeader* m_Header = nullptr;
+	SharedFrameSlot* m_Slots = nullptr;
+	unsigned m_SlotCount = 0;
+};
+
+template <typename Function>
+bool SharedFrameReader::ReadInPlace(unsigned slot, Function&& function) const
+{
+	const SharedFrameSlot& source = m_Slots[slot];
+	for (unsigned attempt = 0; attempt < READ_ATTEMPTS; ++attempt)
+	{
+		uint32_t before = source.Sequence.load(std::memory_order_acquire);
+		if (before & 1)
+		{
+			continue;
+		}
+
+		function(source.Data);
+
+		// Pairs with the release fence in SharedFramePublisher::Publish: if the sequence is unchanged, nothing was overwritten
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (source.Sequence.load(std::memory_order_relaxed) == before)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
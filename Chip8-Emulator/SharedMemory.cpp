@@ -0,0 +1,197 @@
+#include "SharedMemory.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SharedMemory::~SharedMemory()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+// Session local namespace, which needs no privileges
+static std::string MappingName(char const* name)
+{
+	return std::string("Local\\") + name;
+}
+
+bool SharedMemory::Create(char const* name, size_t size)
+{
+	Close();
+
+	uint64_t size64 = size;
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64),
+		MappingName(name).c_str());
+	if (mapping == NULL)
+	{
+		return false;
+	}
+
+	// A mapping still open in another process keeps its old size, which can't be replaced
+	if (GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (data == nullptr)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+
+	m_Mapping = mapping;
+	m_Data = static_cast<uint8_t*>(data);
+	m_Size = size;
+	m_Owner = true;
+	m_Name = name;
+	return true;
+}
+
+bool SharedMemory::Open(char const* name)
+{
+	Close();
+
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, MappingName(name).c_str());
+	if (mapping == NULL)
+	{
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (data == nullptr)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+
+	// The view covers the whole mapping, rounded up to pages
+	MEMORY_BASIC_INFORMATION info = {};
+	VirtualQuery(data, &info, sizeof(info));
+
+	m_Mapping = mapping;
+	m_Data = static_cast<uint8_t*>(data);
+	m_Size = info.RegionSize;
+	m_Name = name;
+	return true;
+}
+
+void SharedMemory::Close()
+{
+	// The mapping goes away with its last handle
+	if (m_Data != nullptr)
+	{
+		UnmapViewOfFile(m_Data);
+		CloseHandle(m_Mapping);
+	}
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Owner = false;
+	m_Name.clear();
+	m_Mapping = nullptr;
+}
+
+#else
+
+// POSIX names are a single path component starting with a slash
+static std::string ObjectName(char const* name)
+{
+	return std::string("/") + name;
+}
+
+bool SharedMemory::Create(char const* name, size_t size)
+{
+	Close();
+
+	std::string object = ObjectName(name);
+	shm_unlink(object.c_str());
+
+	int fd = shm_open(object.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+	{
+		close(fd);
+		shm_unlink(object.c_str());
+		return false;
+	}
+
+	void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+	{
+		shm_unlink(object.c_str());
+		return false;
+	}
+
+	m_Data = static_cast<uint8_t*>(data);
+	m_Size = size;
+	m_Owner = true;
+	m_Name = name;
+	return true;
+}
+
+bool SharedMemory::Open(char const* name)
+{
+	Close();
+
+	int fd = shm_open(ObjectName(name).c_str(), O_RDWR, 0);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat info = {};
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_Data = static_cast<uint8_t*>(data);
+	m_Size = static_cast<size_t>(info.st_size);
+	m_Name = name;
+	return true;
+}
+
+void SharedMemory::Close()
+{
+	if (m_Data != nullptr)
+	{
+		munmap(m_Data, m_Size);
+
+		// Readers that still have it mapped keep their view
+		if (m_Owner)
+		{
+			shm_unlink(ObjectName(m_Name.c_str()).c_str());
+		}
+	}
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Owner = false;
+	m_Name.clear();
+}
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Named memory shared between processes: a POSIX shared memory object, or a pagefile backed file mapping on Windows
+class SharedMemory
+{
+public:
+	SharedMemory() = default;
+	~SharedMemory();
+
+	SharedMemory(const SharedMemory&) = delete;
+	SharedMemory& operator=(const SharedMemory&) = delete;
+
+	// Create a zero filled segment, replacing any left behind under the same name. It is removed again by Close
+	bool Create(char const* name, size_t size);
+
+	// Map a segment another process created, read-write
+	bool Open(char const* name);
+
+	// Unmap the segment, and remove the name if this side created it
+	void Close();
+
+	inline uint8_t* GetData() const { return m_Data; }
+	inline size_t GetSize() const { return m_Size; }
+
+private:
+	uint8_t* m_Data = nullptr;
+	size_t m_Size = 0;
+
+	// Created here rather than opened, so the name is removed on Close
+	bool m_Owner = false;
+	std::string m_Name;
+
+#ifdef _WIN32
+	void* m_Mapping = nullptr;
+#endif
+};
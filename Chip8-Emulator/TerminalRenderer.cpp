@@ -0,0 +1,101 @@
+#include "TerminalRenderer.h"
+
+#include <cstdio>
+
+namespace
+{
+	// Display's palette in xterm 256 colour indices: off, plane 0, plane 1, both planes
+	const unsigned palette[DISPLAY_COLOR_COUNT] = { 16, 231, 244, 250 };
+
+	// Glyphs for a cell with colours 0 and 1 only, by (top | bottom << 1): empty, upper half, lower half, full block
+	const char* const mono_glyphs[4] = { " ", "\xe2\x96\x80", "\xe2\x96\x84", "\xe2\x96\x88" };
+	const char* const upper_half = "\xe2\x96\x80";
+}
+
+const std::string& TerminalRenderer::Render(const Display& display)
+{
+	m_Output.clear();
+
+	const unsigned columns = display.GetWidth();
+	const unsigned rows = display.GetHeight() / 2;
+	if (columns != m_Columns || rows != m_Rows)
+	{
+		m_Columns = columns;
+		m_Rows = rows;
+		m_Cells.assign(columns * rows, CELL_UNKNOWN);
+		m_Output += "\x1b[0m\x1b[2J";
+		m_Attribute = -1;
+		m_CursorRow = -1;
+	}
+
+	for (unsigned row = 0; row < rows; ++row)
+	{
+		for (unsigned column = 0; column < columns; ++column)
+		{
+			uint8_t top = display.GetPixel(column, row * 2);
+			uint8_t bottom = display.GetPixel(column, row * 2 + 1);
+			uint8_t cell = static_cast<uint8_t>(top | (bottom << 2));
+
+			uint8_t& shown = m_Cells[row * columns + column];
+			if (cell == shown)
+			{
+				continue;
+			}
+
+			shown = cell;
+			MoveTo(row, column);
+
+			if (top <= 1 && bottom <= 1)
+			{
+				SetAttribute(ATTRIBUTE_MONO);
+				m_Output += mono_glyphs[top | (bottom << 1)];
+			}
+			else
+			{
+				SetAttribute(cell);
+				m_Output += upper_half;
+			}
+
+			// Printing moves the cursor on a cell, except past the right edge
+			++m_CursorColumn;
+		}
+	}
+
+	return m_Output;
+}
+
+void TerminalRenderer::Invalidate()
+{
+	m_Columns = 0;
+	m_Rows = 0;
+}
+
+void TerminalRenderer::MoveTo(unsigned row, unsigned column)
+{
+	if (static_cast<int>(row) == m_CursorRow && static_cast<int>(column) == m_CursorColumn)
+	{
+		return;
+	}
+
+	char sequence[16];
+	std::snprintf(sequence, sizeof(sequence), "\x1b[%u;%uH", row + 1, column + 1);
+	m_Output += sequence;
+	m_CursorRow = static_cast<int>(row);
+	m_CursorColumn = static_cast<int>(column);
+}
+
+void TerminalRenderer::SetAttribute(int attribute)
+{
+	if (attribute == m_Attribute)
+	{
+		return;
+	}
+
+	unsigned foreground = attribute == ATTRIBUTE_MONO ? palette[1] : palette[attribute & 3];
+	unsigned background = attribute == ATTRIBUTE_MONO ? palette[0] : palette[attribute >> 2];
+
+	char sequence[32];
+	std::snprintf(sequence, sizeof(sequence), "\x1b[38;5;%u;48;5;%um", foreground, background);
+	m_Output += sequence;
+	m_Attribute = attribute;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Display.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Draws the display in a terminal with ANSI escape sequences, two pixels per character cell using the Unicode half blocks.
+// Only the cells that changed since the last frame are sent, so a typical frame is a few hundred bytes
+class TerminalRenderer
+{
+public:
+	TerminalRenderer() = default;
+
+	// Switch to the alternate screen and hide the cursor, and back again
+	static const char* GetEnterSequence() { return "\x1b[?1049h\x1b[?25l\x1b[2J"; }
+	static const char* GetLeaveSequence() { return "\x1b[0m\x1b[?25h\x1b[?1049l"; }
+
+	// Escape sequences that bring the terminal from the last frame to this one. The first frame, or the first after a
+	// resolution change or Invalidate, redraws every cell
+	const std::string& Render(const Display& display);
+
+	// Forget what the terminal shows, e.g. after it was resized
+	void Invalidate();
+
+private:
+	// Cell contents: colour index of the top pixel, and of the bottom pixel shifted up by 2
+	static const uint8_t CELL_UNKNOWN = 0xFF;
+
+	// Cells drawn with only colours 0 and 1 share one attribute and pick a glyph from the four block characters, others
+	// need a half block with their own foreground and background
+	static const int ATTRIBUTE_MONO = 16;
+
+	void MoveTo(unsigned row, unsigned column);
+	void SetAttribute(int attribute);
+
+	// What the terminal shows, row by row
+	std::vector<uint8_t> m_Cells;
+	unsigned m_Columns = 0;
+	unsigned m_Rows = 0;
+
+	// Cursor position and attribute the terminal is left with (-1 when unknown)
+	int m_CursorRow = -1;
+	int m_CursorColumn = -1;
+	int m_Attribute = -1;
+
+	std::string m_Output;
+};
@@ -0,0 +1,227 @@
+// Checks that the core doesn't allocate once a machine is constructed and its ROM loaded. Global operator new is replaced
+// with one that counts, and every bundled ROM is run for a while under each quirk profile that suits it: random key
+// presses through InputQueue, Chip8::Run, timer ticks, display hashing and conversion, save states and Restore rewinds.
+// Any allocation in that loop fails the ROM.
+//
+// Usage: AllocationCheck [repository root] [frames]
+//
+// ROM paths are relative to the repository root, by default the parent directory so it runs from Chip8-Emulator. The
+// exit code is the number of failed runs
+#include "../Chip8.h"
+#include "../Chip8State.h"
+#include "../InputQueue.h"
+#include <atomic>
+#include <cstdio>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::atomic<uint64_t> allocations = 0;
+
+	// Size of the latest allocation, to point at the culprit
+	std::atomic<size_t> last_size = 0;
+
+	void* Allocate(size_t size, size_t alignment)
+	{
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		last_size.store(size, std::memory_order_relaxed);
+
+		size = size ? size : 1;
+		if (alignment == 0)
+		{
+			return std::malloc(size);
+		}
+
+#ifdef _WIN32
+		return _aligned_malloc(size, alignment);
+#else
+		return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+	}
+
+	void FreeAligned(void* pointer)
+	{
+#ifdef _WIN32
+		_aligned_free(pointer);
+#else
+		std::free(pointer);
+#endif
+	}
+}
+
+void* operator new(size_t size)
+{
+	if (void* pointer = Allocate(size, 0))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	if (void* pointer = Allocate(size, 0))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	if (void* pointer = Allocate(size, static_cast<size_t>(alignment)))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	if (void* pointer = Allocate(size, static_cast<size_t>(alignment)))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return Allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return Allocate(size, 0); }
+
+// GCC inlines these into callers, sees a pointer from operator new reach free and warns about the mismatch. The pairing
+// is right, since the replaced operator new allocates with malloc
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { FreeAligned(pointer); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace
+{
+	const unsigned CYCLES_PER_FRAME = 1000;
+
+	// Frames between save states, and between rewinds to the last one
+	const unsigned SAVE_INTERVAL = 60;
+	const unsigned REWIND_INTERVAL = 150;
+
+	// Chance in 256 of a key changing on a frame
+	const unsigned KEY_CHANGE_CHANCE = 24;
+
+	struct Run
+	{
+		const char* Rom;
+		QuirkProfile Profile;
+	};
+
+	const Run runs[] = {
+		{ "Chip8-Emulator/chip8-test-suite.ch8", QuirkProfile::Chip8 },
+		{ "Chip8-Emulator/chip8-test-suite.ch8", QuirkProfile::SuperChip },
+		{ "Chip8-Emulator/chip8-test-suite.ch8", QuirkProfile::XoChip },
+		{ "Chip8-Emulator/test_opcode.ch8", QuirkProfile::Chip8 },
+		{ "Chip8-Emulator/IBM Logo.ch8", QuirkProfile::Chip8 },
+		{ "Chip8-Emulator/breakout.ch8", QuirkProfile::Chip8 },
+		{ "Chip8.NET/ROMS/1-chip8-logo.ch8", QuirkProfile::Chip8 },
+		{ "Chip8.NET/ROMS/3-corax+.ch8", QuirkProfile::Chip8 },
+		{ "Chip8.NET/ROMS/4-flags.ch8", QuirkProfile::Chip8 },
+		{ "Chip8.NET/ROMS/5-quirks.ch8", QuirkProfile::Chip8 },
+		{ "Chip8.NET/ROMS/5-quirks.ch8", QuirkProfile::SuperChip },
+		{ "Chip8.NET/ROMS/5-quirks.ch8", QuirkProfile::XoChip },
+		{ "Chip8.NET/ROMS/6-keypad.ch8", QuirkProfile::Chip8 },
+	};
+
+	const char* const profile_names[] = { "chip8", "schip", "xochip" };
+}
+
+int main(int argc, char** argv)
+{
+	std::string root = argc > 1 ? argv[1] : "..";
+	unsigned frames = argc > 2 ? std::atoi(argv[2]) : 3000;
+
+	// Everything the loop uses is set up here, outside the counted part
+	auto machine = std::make_unique<Chip8>();
+	auto snapshot = std::make_unique<Chip8>();
+	auto state = std::make_unique<Chip8State>();
+	std::unique_ptr<InputQueue> input;
+	std::vector<uint32_t> pixels(HIRES_VIDEO_WIDTH * 2 * HIRES_VIDEO_HEIGHT * 2);
+
+	int failures = 0;
+	for (const Run& run : runs)
+	{
+		*machine = Chip8(run.Profile);
+		std::string path = root + "/" + run.Rom;
+		if (!machine->LoadROM(path.c_str()))
+		{
+			std::printf("FAIL %-40s %-6s can't load\n", run.Rom, profile_names[static_cast<unsigned>(run.Profile)]);
+			++failures;
+			continue;
+		}
+
+		*snapshot = *machine;
+		snapshot->ClearDirtyPages();
+		machine->ClearDirtyPages();
+		input = std::make_unique<InputQueue>();
+
+		uint32_t key_state = 0x2545F491;
+		uint64_t hash = 0;
+		const char* fault = nullptr;
+		uint64_t before = allocations.load();
+
+		try
+		{
+			for (unsigned frame = 0; frame < frames && !machine->IsHalted(); ++frame)
+			{
+				if (NextRandom(key_state) < KEY_CHANGE_CHANCE)
+				{
+					uint8_t key = NextRandom(key_state) & 0xF;
+					input->Push({ machine->GetCycleCount() + NextRandom(key_state), key, (machine->Keypad & (1u << key)) == 0 });
+				}
+
+				machine->Run(CYCLES_PER_FRAME, *input);
+				machine->UpdateTimers();
+
+				hash = machine->VideoBuffer.GetHash();
+				machine->VideoBuffer.ToRGBA(pixels.data(), HIRES_VIDEO_WIDTH * 2, HIRES_VIDEO_HEIGHT * 2);
+
+				if (frame % SAVE_INTERVAL == 0)
+				{
+					machine->SaveState(*state);
+				}
+
+				// Rewind: back to the start with Restore, then forward to the last save state
+				if (frame % REWIND_INTERVAL == REWIND_INTERVAL - 1)
+				{
+					machine->Restore(*snapshot);
+					machine->LoadState(*state);
+				}
+			}
+		}
+		catch (const std::exception&)
+		{
+			// A fault fails the run by itself. The count then includes the exception's message
+			fault = "stopped on an invalid instruction";
+		}
+
+		uint64_t count = allocations.load() - before;
+		bool failed = count != 0 || fault != nullptr;
+		failures += failed ? 1 : 0;
+
+		std::printf("%s %-40s %-6s %llu allocations", failed ? "FAIL" : "ok  ", run.Rom, profile_names[static_cast<unsigned>(run.Profile)],
+			static_cast<unsigned long long>(count));
+		if (count != 0)
+			std::printf(", last of %zu bytes", last_size.load());
+		if (fault != nullptr)
+			std::printf(", %s", fault);
+		std::printf(" (screen %016llx)\n", static_cast<unsigned long long>(hash));
+	}
+
+	std::printf("%d of %zu runs failed\n", failures, sizeof(runs) / sizeof(runs[0]));
+	return failures;
+}
@@ -0,0 +1,64 @@
+// Runs a ROM headless and writes the sound it makes to a .wav file
+//
+// Usage: AudioRender <rom.ch8> <output.wav> [frames] [cycles per frame] [quirk profile]
+#include "../Chip8.h"
+#include "../AudioRing.h"
+#include "../AudioSynth.h"
+#include "../WavWriter.h"
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::fprintf(stderr, "Usage: %s <rom.ch8> <output.wav> [frames] [cycles per frame] [quirk profile]\n", argv[0]);
+		return -1;
+	}
+
+	unsigned frames = argc > 3 ? std::atoi(argv[3]) : 600;
+	unsigned cycles_per_frame = argc > 4 ? std::atoi(argv[4]) : 11;
+	QuirkProfile profile = argc > 5 ? static_cast<QuirkProfile>(std::atoi(argv[5])) : QuirkProfile::Chip8;
+
+	Chip8 chip8(profile);
+	if (!chip8.LoadROM(argv[1]))
+	{
+		std::fprintf(stderr, "Can't load %s\n", argv[1]);
+		return -1;
+	}
+
+	AudioRing ring;
+	AudioSynth synth;
+	WavWriter wav;
+	if (!wav.Open(argv[2], synth.GetSampleRate()))
+	{
+		std::fprintf(stderr, "Can't create %s\n", argv[2]);
+		return -1;
+	}
+
+	try
+	{
+		for (unsigned frame = 0; frame < frames; ++frame)
+		{
+			for (unsigned i = 0; i < cycles_per_frame; ++i)
+			{
+				chip8.Cycle();
+			}
+
+			synth.Tick(chip8, ring);
+			chip8.UpdateTimers();
+
+			// The file is the consumer, so drain every frame and nothing is ever dropped
+			wav.Drain(ring);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+	}
+
+	wav.Close();
+	std::printf("%u frames, %llu underruns, %llu overruns\n", frames, static_cast<unsigned long long>(ring.GetUnderrunCount()), static_cast<unsigned long long>(ring.GetOverrunCount()));
+	return 0;
+}
@@ -0,0 +1,160 @@
+// Runs a ROM headless and captures its frames through FrameFilter, for recording on machines without a GPU
+//
+// Usage: Capture <rom.ch8> <output> [filter] [size] [frames] [threads] [scanlines] [ghosting] [cycles per frame] [quirk profile]
+//
+// output is - for raw RGBA frames on stdout, a .ppm file for the last frame, null to only time the filter, or any other
+// file for raw RGBA frames. filter is nearest, scale2x or scale3x, size is WIDTHxHEIGHT (default 1280x640). Scanlines and
+// ghosting are fractions from 0 (off) to 1. Raw output plays with e.g.
+//   ffmpeg -f rawvideo -pix_fmt rgba -s 1280x640 -r 60 -i frames.rgba out.mp4
+#include "../Chip8.h"
+#include "../FrameFilter.h"
+#include "../HdrHistogram.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace
+{
+	bool WritePpm(const char* filename, const std::vector<uint32_t>& pixels, unsigned width, unsigned height)
+	{
+		FILE* file = std::fopen(filename, "wb");
+		if (!file)
+		{
+			return false;
+		}
+
+		std::fprintf(file, "P6\n%u %u\n255\n", width, height);
+		std::vector<uint8_t> rgb(pixels.size() * 3);
+		for (size_t i = 0; i < pixels.size(); ++i)
+		{
+			// 0xAARRGGBB
+			rgb[i * 3] = static_cast<uint8_t>(pixels[i] >> 16);
+			rgb[i * 3 + 1] = static_cast<uint8_t>(pixels[i] >> 8);
+			rgb[i * 3 + 2] = static_cast<uint8_t>(pixels[i]);
+		}
+
+		bool written = std::fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+		return std::fclose(file) == 0 && written;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::fprintf(stderr, "Usage: %s <rom.ch8> <output> [filter] [size] [frames] [threads] [scanlines] [ghosting] [cycles per frame] [quirk profile]\n", argv[0]);
+		return -1;
+	}
+
+	std::string output = argv[2];
+	std::string filter = argc > 3 ? argv[3] : "scale2x";
+	unsigned width = 1280;
+	unsigned height = 640;
+	if (argc > 4 && std::sscanf(argv[4], "%ux%u", &width, &height) != 2)
+	{
+		std::fprintf(stderr, "Bad size %s\n", argv[4]);
+		return -1;
+	}
+
+	unsigned frames = argc > 5 ? std::atoi(argv[5]) : 600;
+	unsigned threads = argc > 6 ? std::max(1, std::atoi(argv[6])) : 1;
+	double scanlines = argc > 7 ? std::atof(argv[7]) : 0.25;
+	double ghosting = argc > 8 ? std::atof(argv[8]) : 0.5;
+	unsigned cycles_per_frame = argc > 9 ? std::atoi(argv[9]) : 11;
+	QuirkProfile profile = argc > 10 ? static_cast<QuirkProfile>(std::atoi(argv[10])) : QuirkProfile::Chip8;
+
+	if (width < HIRES_VIDEO_WIDTH || height < HIRES_VIDEO_HEIGHT)
+	{
+		std::fprintf(stderr, "The output has to be at least %ux%u\n", HIRES_VIDEO_WIDTH, HIRES_VIDEO_HEIGHT);
+		return -1;
+	}
+
+	UpscaleMode mode = filter == "scale3x" ? UpscaleMode::Scale3x : filter == "scale2x" ? UpscaleMode::Scale2x : UpscaleMode::Nearest;
+
+	Chip8 chip8(profile);
+	if (!chip8.LoadROM(argv[1]))
+	{
+		std::fprintf(stderr, "Can't load %s\n", argv[1]);
+		return -1;
+	}
+
+	// Raw frames go to stdout or a file as they are made
+	FILE* stream = nullptr;
+	if (output == "-")
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		stream = stdout;
+	}
+	else if (output != "null" && !(output.size() > 4 && output.compare(output.size() - 4, 4, ".ppm") == 0))
+	{
+		stream = std::fopen(output.c_str(), "wb");
+		if (!stream)
+		{
+			std::fprintf(stderr, "Can't create %s\n", output.c_str());
+			return -1;
+		}
+	}
+
+	FrameFilter frame_filter(width, height, threads);
+	frame_filter.SetMode(mode);
+	frame_filter.SetScanlines(scanlines);
+	frame_filter.SetGhosting(ghosting);
+
+	std::vector<uint32_t> pixels(static_cast<size_t>(width) * height);
+	HdrHistogram filter_ns;
+	unsigned frame = 0;
+	try
+	{
+		for (; frame < frames && !chip8.IsHalted(); ++frame)
+		{
+			for (unsigned i = 0; i < cycles_per_frame; ++i)
+			{
+				chip8.Cycle();
+			}
+
+			chip8.UpdateTimers();
+
+			auto start = std::chrono::steady_clock::now();
+			frame_filter.Apply(chip8.VideoBuffer, pixels.data());
+			filter_ns.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+
+			if (stream && std::fwrite(pixels.data(), sizeof(uint32_t), pixels.size(), stream) != pixels.size())
+			{
+				std::fprintf(stderr, "Can't write frame %u\n", frame);
+				break;
+			}
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+	}
+
+	if (stream && stream != stdout)
+	{
+		std::fclose(stream);
+	}
+
+	if (stream == nullptr && output != "null" && !WritePpm(output.c_str(), pixels, width, height))
+	{
+		std::fprintf(stderr, "Can't write %s\n", output.c_str());
+		return -1;
+	}
+
+	// A stream at 60Hz needs a frame every 16.7ms, so this is how many the filter could keep up with on these threads
+	double mean_ms = filter_ns.GetMean() / 1e6;
+	std::fprintf(stderr, "%u frames of %ux%u, filter %.3fms mean, %.3fms p99 on %u threads, %.0f frames/s, %.0f streams at 60Hz\n",
+		frame, width, height, mean_ms, filter_ns.GetPercentile(99.0) / 1e6, threads, 1000.0 / mean_ms, 1000.0 / mean_ms / 60.0);
+	return 0;
+}
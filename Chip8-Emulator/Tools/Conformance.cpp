@@ -0,0 +1,415 @@
+// Runs the bundled test ROMs headless and compares each final screen against a stored hash, as a quick correctness gate
+// for changes to the interpreter. Menus are driven by scripted key presses, and the cases run in parallel.
+//
+// Usage: Conformance [repository root] [--update] [--show <case>] [--latency]
+//
+// ROM paths are relative to the repository root, by default the parent directory so it runs from Chip8-Emulator. --update
+// prints the case table with the hashes found this run, for pasting back here after checking the screens with --show. The
+// exit code is the number of failed cases. --latency runs the cases through LatencyProbe and reports how long the scripted
+// key presses took to show on screen. Two last checks continue the debugger from breakpoint and watchpoint stops
+#include "../Chip8.h"
+#include "../Debugger.h"
+#include "../InputQueue.h"
+#include "../LatencyProbe.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// The screen has to be the same this many frames before the end, so a case never passes or fails mid-draw
+	const unsigned STABLE_FRAMES = 60;
+
+	struct Case
+	{
+		const char* Name;
+		const char* Rom;
+		QuirkProfile Profile;
+		unsigned CyclesPerFrame;
+		unsigned Frames;
+
+		// Key presses and releases: "+5@300 -5@310" presses key 5 at the start of frame 300 and releases it at frame 310
+		const char* Script;
+
+		// Display::GetHash of the final screen
+		uint64_t Hash;
+	};
+
+	// The suite's menu waits for a key on the splash screen, then takes the test's number. The quirks test measures how many
+	// instructions run per frame, so its CHIP-8 case runs at a COSMAC VIP-like 15 instead of the 1000 used elsewhere to
+	// get through the menus quickly
+	const Case cases[] = {
+		{ "suite-ibm-logo", "Chip8-Emulator/chip8-test-suite.ch8", QuirkProfile::Chip8, 1000, 600, "+1@100 -1@110 +1@300 -1@310", 0x1DB5A61A26972043 },
+		{ "suite-corax+", "Chip8-Emulator/chip8-test-suite.ch8", QuirkProfile::Chip8, 1000, 600, "+1@100 -1@110 +2@300 -2@310", 0x85E0BBD0CAA57381 },
+		{ "suite-flags", "Chip8-Emulator/chip8-test-suite.ch8", QuirkProfile::Chip8, 1000, 600, "+1@100 -1@110 +3@300 -3@310", 0x48A16F0D051BBFDC },
+		{ "suite-quirks-chip8", "Chip8-Emulator/chip8-test-suite.ch8", QuirkProfile::Chip8, 15, 4000, "+1@500 -1@510 +4@1500 -4@1510 +1@2500 -1@2510", 0x8B0FD38F9C3FCE46 },
+		{ "suite-quirks-schip", "Chip8-Emulator/chip8-test-suite.ch8", QuirkProfile::SuperChip, 1000, 1000, "+1@100 -1@110 +4@300 -4@310 +2@450 -2@460", 0xDA31F919FBAE649A },
+		{ "suite-quirks-xochip", "Chip8-Emulator/chip8-test-suite.ch8", QuirkProfile::XoChip, 1000, 1000, "+1@100 -1@110 +4@300 -4@310 +3@450 -3@460", 0x0C8386F33992FADE },
+		{ "suite-keypad-down", "Chip8-Emulator/chip8-test-suite.ch8", QuirkProfile::Chip8, 1000, 800, "+1@100 -1@110 +5@300 -5@310 +1@450 -1@460 +7@600", 0x35C1288AD93B2B21 },
+		{ "suite-keypad-up", "Chip8-Emulator/chip8-test-suite.ch8", QuirkProfile::Chip8, 1000, 800, "+1@100 -1@110 +5@300 -5@310 +2@450 -2@460 +7@600", 0x0163379FAB7742E8 },
+		{ "suite-keypad-getkey", "Chip8-Emulator/chip8-test-suite.ch8", QuirkProfile::Chip8, 1000, 900, "+1@100 -1@110 +5@300 -5@310 +3@450 -3@460 +7@600 -7@610", 0xA69B5C8475563041 },
+		{ "test-opcode", "Chip8-Emulator/test_opcode.ch8", QuirkProfile::Chip8, 1000, 200, "", 0xB23E71AEBD1D2B3C },
+		{ "ibm-logo", "Chip8-Emulator/IBM Logo.ch8", QuirkProfile::Chip8, 1000, 200, "", 0x1DB5A61A26972043 },
+		{ "1-chip8-logo", "Chip8.NET/ROMS/1-chip8-logo.ch8", QuirkProfile::Chip8, 1000, 200, "", 0xD869503FB59A6AE6 },
+		{ "2-ibm-logo", "Chip8.NET/ROMS/2-ibm-logo.ch8", QuirkProfile::Chip8, 1000, 200, "", 0xEB22DDAB850AA4AD },
+		{ "3-corax+", "Chip8.NET/ROMS/3-corax+.ch8", QuirkProfile::Chip8, 1000, 300, "", 0xFCEA031C72F84C2E },
+		{ "4-flags", "Chip8.NET/ROMS/4-flags.ch8", QuirkProfile::Chip8, 1000, 300, "", 0x98172D140673A063 },
+		{ "5-quirks-chip8", "Chip8.NET/ROMS/5-quirks.ch8", QuirkProfile::Chip8, 15, 3000, "+1@600 -1@610", 0x8B0FD38F9C3FCE46 },
+		{ "5-quirks-schip", "Chip8.NET/ROMS/5-quirks.ch8", QuirkProfile::SuperChip, 1000, 600, "+2@200 -2@210", 0xDA31F919FBAE649A },
+		{ "5-quirks-xochip", "Chip8.NET/ROMS/5-quirks.ch8", QuirkProfile::XoChip, 1000, 600, "+3@200 -3@210", 0x0C8386F33992FADE },
+		{ "6-keypad-getkey", "Chip8.NET/ROMS/6-keypad.ch8", QuirkProfile::Chip8, 1000, 600, "+3@200 -3@210 +7@400 -7@410", 0xA69B5C8475563041 },
+	};
+
+	const unsigned CASE_COUNT = sizeof(cases) / sizeof(cases[0]);
+
+	struct ScriptEvent
+	{
+		unsigned Frame;
+		uint8_t Key;
+		bool Pressed;
+	};
+
+	struct Result
+	{
+		uint64_t Hash = 0;
+		uint64_t Cycles = 0;
+		double Milliseconds = 0.0;
+
+		// Empty when the case ran to the end with a stable screen
+		std::string Error;
+
+		// Final screen, for --show
+		std::unique_ptr<Chip8> Machine;
+
+		// Only with --latency
+		std::unique_ptr<LatencyProbe> Latency;
+	};
+
+	bool ParseScript(const char* script, std::vector<ScriptEvent>& events)
+	{
+		const char* p = script;
+		while (*p != '\0')
+		{
+			if (*p == ' ')
+			{
+				++p;
+				continue;
+			}
+
+			unsigned key = 0;
+			unsigned frame = 0;
+			int length = 0;
+			if ((*p != '+' && *p != '-') || std::sscanf(p + 1, "%x@%u%n", &key, &frame, &length) != 2 || key >= KEY_COUNT)
+			{
+				return false;
+			}
+
+			events.push_back({ frame, static_cast<uint8_t>(key), *p == '+' });
+			p += 1 + length;
+		}
+
+		std::stable_sort(events.begin(), events.end(), [](const ScriptEvent& a, const ScriptEvent& b) { return a.Frame < b.Frame; });
+		return true;
+	}
+
+	void Run(const Case& test, const std::string& root, Result& result)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		std::vector<ScriptEvent> events;
+		if (!ParseScript(test.Script, events))
+		{
+			result.Error = "bad script";
+			return;
+		}
+
+		result.Machine = std::make_unique<Chip8>(test.Profile);
+		Chip8& chip8 = *result.Machine;
+		std::string path = root + "/" + test.Rom;
+		if (!chip8.LoadROM(path.c_str()))
+		{
+			result.Error = "can't load " + path;
+			return;
+		}
+
+		// Input goes through the queue like a frontend's, stamped with the first cycle of the frame
+		InputQueue input;
+		size_t next_event = 0;
+		uint64_t stable_hash = 0;
+		try
+		{
+			for (unsigned frame = 0; frame < test.Frames; ++frame)
+			{
+				for (; next_event < events.size() && events[next_event].Frame == frame; ++next_event)
+				{
+					input.Push({ chip8.GetCycleCount(), events[next_event].Key, events[next_event].Pressed });
+				}
+
+				if (frame + STABLE_FRAMES == test.Frames)
+				{
+					stable_hash = chip8.VideoBuffer.GetHash();
+				}
+
+				if (result.Latency)
+				{
+					result.Latency->Run(chip8, test.CyclesPerFrame, input);
+					result.Latency->OnPresent();
+				}
+				else
+				{
+					chip8.Run(test.CyclesPerFrame, input);
+				}
+
+				chip8.UpdateTimers();
+			}
+		}
+		catch (const std::exception& e)
+		{
+			result.Error = e.what();
+		}
+
+		result.Hash = chip8.VideoBuffer.GetHash();
+		result.Cycles = chip8.GetCycleCount();
+		result.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		if (result.Error.empty() && test.Frames >= STABLE_FRAMES && result.Hash != stable_hash)
+		{
+			result.Error = "screen still changing at the end";
+		}
+	}
+
+	// Continuing from a watchpoint hit has to execute the instruction it stopped before, or every continue stops again
+	// straight away. The IBM logo reads its sprites through I on every DXYN. Returns an empty string on success
+	std::string CheckDebuggerContinue(const std::string& root)
+	{
+		Chip8 chip8;
+		std::string path = root + "/Chip8-Emulator/IBM Logo.ch8";
+		if (!chip8.LoadROM(path.c_str()))
+		{
+			return "can't load " + path;
+		}
+
+		Debugger debugger(chip8, 11);
+		debugger.AddWatchpoint(0, 0x1000, WatchType::Read);
+
+		uint16_t previous = 0;
+		for (unsigned hit = 0; hit < 3; ++hit)
+		{
+			DebugStop stop = debugger.Run(1000);
+			if (stop.Reason != StopReason::Watchpoint)
+			{
+				return "hit " + std::to_string(hit) + " didn't stop on the watchpoint";
+			}
+
+			if (hit != 0 && (stop.Cycles == 0 || stop.ProgramCounter == previous))
+			{
+				return "continue stopped on the same watchpoint hit";
+			}
+
+			previous = stop.ProgramCounter;
+		}
+
+		return "";
+	}
+
+	// A breakpoint stop must not hide a watchpoint on the same instruction, and resuming from that watchpoint must not stop
+	// on the breakpoint again. SUPER-CHIP has no display wait, so the logo's first DXYN reads its sprite as soon as it runs
+	std::string CheckDebuggerBreakThenWatch(const std::string& root)
+	{
+		Chip8 chip8(QuirkProfile::SuperChip);
+		std::string path = root + "/Chip8-Emulator/IBM Logo.ch8";
+		if (!chip8.LoadROM(path.c_str()))
+		{
+			return "can't load " + path;
+		}
+
+		// D01F at 0x208 draws the sprite at 0x22A
+		Debugger debugger(chip8, 11);
+		debugger.SetBreakpoint(0x208);
+		debugger.AddWatchpoint(0x22A, 1, WatchType::Read);
+
+		const StopReason expected[] = { StopReason::Breakpoint, StopReason::Watchpoint, StopReason::None };
+		for (unsigned i = 0; i < 3; ++i)
+		{
+			DebugStop stop = debugger.Run(1000);
+			if (stop.Reason != expected[i] || (expected[i] != StopReason::None && stop.ProgramCounter != 0x208))
+			{
+				return "stop " + std::to_string(i) + " was reason " + std::to_string(static_cast<unsigned>(stop.Reason)) + " at " + std::to_string(stop.ProgramCounter);
+			}
+		}
+
+		return "";
+	}
+
+	struct DebuggerCheck
+	{
+		const char* Name;
+		std::string (*Run)(const std::string& root);
+	};
+
+	// Checks that drive the debugger rather than compare screens
+	const DebuggerCheck debugger_checks[] = {
+		{ "debugger-continue", CheckDebuggerContinue },
+		{ "debugger-break-watch", CheckDebuggerBreakThenWatch },
+	};
+
+	const unsigned DEBUGGER_CHECK_COUNT = sizeof(debugger_checks) / sizeof(debugger_checks[0]);
+
+	void PrintScreen(const Display& display)
+	{
+		std::string line;
+		for (unsigned y = 0; y < display.GetHeight(); ++y)
+		{
+			line.clear();
+			for (unsigned x = 0; x < display.GetWidth(); ++x)
+			{
+				line += " #+*"[display.GetPixel(x, y)];
+			}
+
+			std::printf("|%s|\n", line.c_str());
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string root = "..";
+	bool update = false;
+	bool latency = false;
+	const char* show = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--update") == 0)
+		{
+			update = true;
+		}
+		else if (std::strcmp(argv[i], "--latency") == 0)
+		{
+			latency = true;
+		}
+		else if (std::strcmp(argv[i], "--show") == 0 && i + 1 < argc)
+		{
+			show = argv[++i];
+		}
+		else if (argv[i][0] != '-')
+		{
+			root = argv[i];
+		}
+		else
+		{
+			std::fprintf(stderr, "Usage: %s [repository root] [--update] [--show <case>] [--latency]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	// Cases take very different times (the slow quirks runs dominate), so the workers take the next case as they finish
+	// rather than a fixed share
+	std::vector<Result> results(CASE_COUNT);
+	if (latency)
+	{
+		for (Result& result : results)
+		{
+			result.Latency = std::make_unique<LatencyProbe>();
+		}
+	}
+	std::atomic<unsigned> next_case = 0;
+	unsigned thread_count = std::clamp(std::thread::hardware_concurrency(), 1u, CASE_COUNT);
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (unsigned t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&]()
+		{
+			for (unsigned i = next_case++; i < CASE_COUNT; i = next_case++)
+			{
+				Run(cases[i], root, results[i]);
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	unsigned failed = 0;
+	uint64_t cycles = 0;
+	for (unsigned i = 0; i < CASE_COUNT; ++i)
+	{
+		const Case& test = cases[i];
+		const Result& result = results[i];
+		cycles += result.Cycles;
+
+		if (update)
+		{
+			std::printf("\t\t{ \"%s\", \"%s\", QuirkProfile::%s, %u, %u, \"%s\", 0x%016llX },\n", test.Name, test.Rom,
+				test.Profile == QuirkProfile::Chip8 ? "Chip8" : test.Profile == QuirkProfile::SuperChip ? "SuperChip" : "XoChip",
+				test.CyclesPerFrame, test.Frames, test.Script, static_cast<unsigned long long>(result.Hash));
+			continue;
+		}
+
+		bool pass = result.Error.empty() && result.Hash == test.Hash;
+		failed += pass ? 0 : 1;
+		std::printf("%-4s %-22s %7.1fms", pass ? "ok" : "FAIL", test.Name, result.Milliseconds);
+		if (!result.Error.empty())
+		{
+			std::printf("  %s", result.Error.c_str());
+		}
+		else if (!pass)
+		{
+			std::printf("  hash %016llX, expected %016llX", static_cast<unsigned long long>(result.Hash), static_cast<unsigned long long>(test.Hash));
+		}
+
+		std::printf("\n");
+	}
+
+	for (const DebuggerCheck& check : debugger_checks)
+	{
+		std::string error = check.Run(root);
+		if (!update)
+		{
+			failed += error.empty() ? 0 : 1;
+			std::printf("%-4s %-22s  %s\n", error.empty() ? "ok" : "FAIL", check.Name, error.c_str());
+		}
+	}
+
+	if (show != nullptr)
+	{
+		for (unsigned i = 0; i < CASE_COUNT; ++i)
+		{
+			if (std::strcmp(cases[i].Name, show) == 0 && results[i].Machine)
+			{
+				PrintScreen(results[i].Machine->VideoBuffer);
+			}
+		}
+	}
+
+	if (latency)
+	{
+		LatencyProbe total;
+		for (const Result& result : results)
+		{
+			total.Merge(*result.Latency);
+		}
+
+		std::printf("%s", total.FormatReport().c_str());
+	}
+
+	if (!update)
+	{
+		std::printf("%u of %u passed in %.1fms on %u threads (%.1fM cycles)\n", CASE_COUNT + DEBUGGER_CHECK_COUNT - failed, CASE_COUNT + DEBUGGER_CHECK_COUNT, elapsed, thread_count, cycles / 1e6);
+	}
+
+	return static_cast<int>(failed);
+}
@@ -0,0 +1,485 @@
+// Coverage guided ROM fuzzer. Mutates ROMs and keypad scripts, keeps every input that reaches a new guest PC edge and writes
+// out any input that makes the guest fault: an access past the end of memory, a return with an empty stack, a call with a
+// full one, a PC past the end of memory or an invalid instruction.
+//
+// Usage: CoverageFuzzer <quirk profile> <seconds> <crash prefix> [seed.ch8 ...]
+//
+// Every execution starts from a snapshot of a freshly constructed Chip8. Chip8::Restore copies back the registers and only
+// the memory pages the last execution wrote, so nothing is constructed, allocated or read from disk in the loop.
+#include "../Chip8.h"
+#include "../MemoryAccess.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Restore assigns the snapshot member by member, which must never allocate or free
+static_assert(std::is_trivially_copyable_v<Chip8>, "Chip8 must stay trivially copyable to be snapshotted");
+
+namespace
+{
+	// Instructions executed per timer tick
+	const unsigned CYCLES_PER_TICK = 11;
+
+	// Instructions each keypad script entry is held for
+	const unsigned CYCLES_PER_KEY_STEP = 16;
+	const unsigned KEY_SCRIPT_LENGTH = 32;
+
+	// Instructions per execution
+	const unsigned MAX_INSTRUCTIONS = 4000;
+
+	// An execution that goes this many instructions without touching a new edge is stuck in a loop and ends early.
+	// Long enough for the whole keypad script to play out
+	const unsigned STALL_INSTRUCTIONS = CYCLES_PER_KEY_STEP * KEY_SCRIPT_LENGTH;
+
+	// One counter per PC edge, AFL style: the edge from A to B lands at (A >> 1) ^ B
+	const unsigned COVERAGE_MAP_SIZE = 1 << 16;
+
+	// Largest ROM the mutator grows to
+	const unsigned MAX_FUZZ_ROM_SIZE = 1024;
+
+	enum class Fault
+	{
+		None,
+		InvalidInstruction,
+		ProgramCounterOutOfRange,
+		MemoryOutOfRange,
+		StackUnderflow,
+		StackOverflow,
+	};
+
+	const char* GetFaultName(Fault fault)
+	{
+		switch (fault)
+		{
+			case Fault::InvalidInstruction: return "invalid-instruction";
+			case Fault::ProgramCounterOutOfRange: return "pc-out-of-range";
+			case Fault::MemoryOutOfRange: return "memory-out-of-range";
+			case Fault::StackUnderflow: return "stack-underflow";
+			case Fault::StackOverflow: return "stack-overflow";
+			default: return "none";
+		}
+	}
+
+	struct TestCase
+	{
+		std::vector<uint8_t> Rom;
+
+		// Keypad state for each step of the run
+		std::array<uint16_t, KEY_SCRIPT_LENGTH> Keys = {};
+	};
+
+	class Random
+	{
+	public:
+		explicit Random(uint32_t seed) : m_State(seed != 0 ? seed : 1) {}
+
+		inline uint32_t Next()
+		{
+			m_State ^= m_State << 13;
+			m_State ^= m_State >> 17;
+			m_State ^= m_State << 5;
+			return m_State;
+		}
+
+		inline uint32_t Below(uint32_t limit) { return Next() % limit; }
+
+	private:
+		uint32_t m_State;
+	};
+
+	// Bucket a hit count the way AFL does, so loops only count as new behaviour when their trip count changes by a power of two
+	inline uint8_t Bucket(uint8_t count)
+	{
+		if (count <= 3) return count == 3 ? 4 : count;
+		if (count <= 7) return 8;
+		if (count <= 15) return 16;
+		if (count <= 31) return 32;
+		if (count <= 127) return 64;
+		return 128;
+	}
+
+	// Check the instruction at PC before it runs. The interpreter itself doesn't bounds check, so this is the crash detector
+	Fault CheckInstruction(const Chip8& chip8, unsigned stack_depth)
+	{
+		const auto& memory = chip8.GetMemory();
+		const unsigned memory_size = chip8.GetMemorySize();
+		const unsigned pc = chip8.GetProgramCounter();
+
+		if (pc + 2 > memory_size)
+		{
+			return Fault::ProgramCounterOutOfRange;
+		}
+
+		uint16_t opcode = (memory[pc] << 8) | memory[pc + 1];
+		if (opcode == 0x00EE && stack_depth == 0)
+		{
+			return Fault::StackUnderflow;
+		}
+
+		if ((opcode & 0xF000) == 0x2000 && stack_depth == STACK_LEVELS)
+		{
+			return Fault::StackOverflow;
+		}
+
+		// F000 NNNN is four bytes long
+		if (opcode == 0xF000 && chip8.GetQuirkProfile() == QuirkProfile::XoChip && pc + 4 > memory_size)
+		{
+			return Fault::ProgramCounterOutOfRange;
+		}
+
+		MemoryAccess access = GetMemoryAccess(chip8);
+		if (access.Type != AccessType::None && access.Address + access.Size > memory_size)
+		{
+			return Fault::MemoryOutOfRange;
+		}
+
+		return Fault::None;
+	}
+
+	class Fuzzer
+	{
+	public:
+		Fuzzer(QuirkProfile profile, uint32_t seed) : m_Snapshot(profile), m_Machine(profile), m_Random(seed)
+		{
+			m_Touched.reserve(MAX_INSTRUCTIONS);
+		}
+
+		// Run one test case from the snapshot, recording edges into the trace map. Returns the fault, if any, and where it happened
+		std::pair<Fault, uint16_t> Execute(const TestCase& test)
+		{
+			// Only the edges the last execution touched need clearing
+			for (uint16_t edge : m_Touched)
+			{
+				m_Trace[edge] = 0;
+			}
+			m_Touched.clear();
+
+			// Restore (only the memory pages the last execution wrote), then write the ROM over the snapshot's empty program area
+			m_Machine.Restore(m_Snapshot);
+			if (!m_Machine.LoadROM(std::span<const uint8_t>(test.Rom)))
+			{
+				return { Fault::None, 0 };
+			}
+
+			unsigned stack_depth = 0;
+			uint16_t previous = m_Machine.GetProgramCounter();
+			unsigned last_new_edge = 0;
+
+			for (unsigned step = 0; step < MAX_INSTRUCTIONS && step - last_new_edge < STALL_INSTRUCTIONS; ++step)
+			{
+				if (step % CYCLES_PER_TICK == 0)
+				{
+					m_Machine.UpdateTimers();
+				}
+
+				m_Machine.Keypad = test.Keys[(step / CYCLES_PER_KEY_STEP) % KEY_SCRIPT_LENGTH];
+
+				uint16_t pc = m_Machine.GetProgramCounter();
+				Fault fault = CheckInstruction(m_Machine, stack_depth);
+				if (fault != Fault::None)
+				{
+					return { fault, pc };
+				}
+
+				uint16_t opcode = (m_Machine.GetMemory()[pc] << 8) | m_Machine.GetMemory()[pc + 1];
+				if (opcode == 0x0000)
+				{
+					// Empty memory. The program ran off its end and would only walk through zeroes from here
+					break;
+				}
+
+				if ((opcode & 0xF000) == 0x2000)
+					++stack_depth;
+				else if (opcode == 0x00EE)
+					--stack_depth;
+
+				try
+				{
+					m_Machine.Cycle();
+				}
+				catch (const std::exception&)
+				{
+					return { Fault::InvalidInstruction, pc };
+				}
+
+				uint16_t next = m_Machine.GetProgramCounter();
+				if (next == pc)
+				{
+					// Jumping to itself is how most programs stop. Waits (FX0A, display wait) resume on their own
+					if (opcode == (0x1000 | pc))
+						break;
+					continue;
+				}
+
+				uint16_t edge = ((previous >> 1) ^ next) & (COVERAGE_MAP_SIZE - 1);
+				if (m_Trace[edge] == 0)
+				{
+					m_Touched.push_back(edge);
+					last_new_edge = step;
+				}
+				if (m_Trace[edge] != 0xFF)
+				{
+					++m_Trace[edge];
+				}
+				previous = next;
+			}
+
+			return { Fault::None, 0 };
+		}
+
+		// Fold the trace into the global map. Returns true if it reached an edge or hit count bucket not seen before
+		bool MergeCoverage()
+		{
+			bool found = false;
+			for (uint16_t i : m_Touched)
+			{
+				uint8_t bucket = Bucket(m_Trace[i]);
+				if ((m_Coverage[i] | bucket) != m_Coverage[i])
+				{
+					m_Edges += m_Coverage[i] == 0;
+					m_Coverage[i] |= bucket;
+					found = true;
+				}
+			}
+
+			return found;
+		}
+
+		void Mutate(TestCase& test)
+		{
+			unsigned count = 1 + m_Random.Below(4);
+			for (unsigned i = 0; i < count; ++i)
+			{
+				std::vector<uint8_t>& rom = test.Rom;
+				unsigned offset = rom.empty() ? 0 : m_Random.Below(static_cast<uint32_t>(rom.size()));
+
+				switch (m_Random.Below(8))
+				{
+					case 0: // Flip a bit
+						if (!rom.empty())
+							rom[offset] ^= 1 << m_Random.Below(8);
+						break;
+
+					case 1: // Random byte
+						if (!rom.empty())
+							rom[offset] = static_cast<uint8_t>(m_Random.Next());
+						break;
+
+					case 2: // Random opcode, keeping instructions aligned
+						if (rom.size() >= 2)
+						{
+							offset &= ~1u;
+							uint16_t opcode = static_cast<uint16_t>(m_Random.Next());
+							rom[offset] = opcode >> 8;
+							rom[offset + 1] = opcode & 0xFF;
+						}
+						break;
+
+					case 3: // Point the operand of a jump, call or ANNN back into the program
+						if (rom.size() >= 2)
+						{
+							offset &= ~1u;
+							static const uint8_t kinds[] = { 0x10, 0x20, 0xA0, 0xB0 };
+							uint16_t address = ROM_START_ADDRESS + (m_Random.Below(static_cast<uint32_t>(rom.size())) & ~1u);
+							rom[offset] = kinds[m_Random.Below(4)] | (address >> 8);
+							rom[offset + 1] = address & 0xFF;
+						}
+						break;
+
+					case 4: // Insert an instruction
+						if (rom.size() + 2 <= MAX_FUZZ_ROM_SIZE)
+						{
+							offset &= ~1u;
+							uint32_t value = m_Random.Next();
+							rom.insert(rom.begin() + offset, { static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) });
+						}
+						break;
+
+					case 5: // Delete an instruction
+						if (rom.size() > 2)
+						{
+							offset &= ~1u;
+							rom.erase(rom.begin() + offset, rom.begin() + std::min<size_t>(offset + 2, rom.size()));
+						}
+						break;
+
+					case 6: // Splice in a run of bytes from another corpus entry
+						if (!m_Corpus.empty() && !rom.empty())
+						{
+							const std::vector<uint8_t>& other = m_Corpus[m_Random.Below(static_cast<uint32_t>(m_Corpus.size()))].Rom;
+							if (!other.empty())
+							{
+								unsigned from = m_Random.Below(static_cast<uint32_t>(other.size()));
+								unsigned length = 1 + m_Random.Below(16);
+								for (unsigned j = 0; j < length && from + j < other.size() && offset + j < rom.size(); ++j)
+									rom[offset + j] = other[from + j];
+							}
+						}
+						break;
+
+					case 7: // Change the keypad script
+					{
+						unsigned step = m_Random.Below(KEY_SCRIPT_LENGTH);
+						test.Keys[step] = m_Random.Below(2) ? test.Keys[step] ^ (1 << m_Random.Below(KEY_COUNT)) : static_cast<uint16_t>(m_Random.Next());
+						break;
+					}
+				}
+			}
+		}
+
+		void AddSeed(TestCase test)
+		{
+			Execute(test);
+			MergeCoverage();
+			m_Corpus.push_back(std::move(test));
+		}
+
+		// Mutate a corpus entry, run it and keep it if it found something. Returns a new fault, if any
+		std::pair<Fault, uint16_t> Step(TestCase& candidate)
+		{
+			candidate = m_Corpus[m_Random.Below(static_cast<uint32_t>(m_Corpus.size()))];
+			Mutate(candidate);
+
+			auto result = Execute(candidate);
+			if (MergeCoverage())
+			{
+				m_Corpus.push_back(candidate);
+			}
+
+			// One crash per kind and PC
+			if (result.first != Fault::None && m_Crashes.insert({ static_cast<int>(result.first), result.second }).second)
+			{
+				return result;
+			}
+
+			return { Fault::None, 0 };
+		}
+
+		inline size_t GetCorpusSize() const { return m_Corpus.size(); }
+		inline unsigned GetEdgeCount() const { return m_Edges; }
+		inline size_t GetCrashCount() const { return m_Crashes.size(); }
+
+	private:
+		// Machine every execution is restored from
+		Chip8 m_Snapshot;
+
+		// Machine the execution runs on
+		Chip8 m_Machine;
+
+		Random m_Random;
+
+		// Edge hit counts for the current execution
+		std::array<uint8_t, COVERAGE_MAP_SIZE> m_Trace = {};
+
+		// Edges in the trace map that are not zero
+		std::vector<uint16_t> m_Touched;
+
+		// Every hit count bucket seen so far for each edge
+		std::array<uint8_t, COVERAGE_MAP_SIZE> m_Coverage = {};
+		unsigned m_Edges = 0;
+
+		std::vector<TestCase> m_Corpus;
+		std::set<std::pair<int, uint16_t>> m_Crashes;
+	};
+
+	void WriteFile(const std::string& path, const std::vector<uint8_t>& data)
+	{
+		std::ofstream out(path, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		std::fprintf(stderr, "Usage: %s <quirk profile> <seconds> <crash prefix> [seed.ch8 ...]\n", argv[0]);
+		return -1;
+	}
+
+	QuirkProfile profile = static_cast<QuirkProfile>(std::atoi(argv[1]));
+	double seconds = std::atof(argv[2]);
+	std::string prefix = argv[3];
+
+	// The fuzzer holds two whole machines and the coverage maps, too much for the stack
+	auto fuzzer = std::make_unique<Fuzzer>(profile, 0x1234567);
+
+	for (int i = 4; i < argc; ++i)
+	{
+		std::ifstream file(argv[i], std::ios::binary);
+		TestCase seed;
+		seed.Rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		if (seed.Rom.empty())
+		{
+			std::fprintf(stderr, "Can't load %s\n", argv[i]);
+			return -1;
+		}
+
+		fuzzer->AddSeed(std::move(seed));
+	}
+
+	if (fuzzer->GetCorpusSize() == 0)
+	{
+		// Without seeds start from a program that loops forever
+		fuzzer->AddSeed({ { 0x12, 0x00 } });
+	}
+
+	TestCase candidate;
+	uint64_t executions = 0;
+	auto start = std::chrono::steady_clock::now();
+	auto report = start;
+
+	for (;;)
+	{
+		// Check the clock every so often rather than every execution
+		for (unsigned i = 0; i < 256; ++i, ++executions)
+		{
+			auto [fault, pc] = fuzzer->Step(candidate);
+			if (fault != Fault::None)
+			{
+				char name[64];
+				std::snprintf(name, sizeof(name), "-%s-%03X.ch8", GetFaultName(fault), pc);
+				WriteFile(prefix + name, candidate.Rom);
+
+				// The keypad script goes next to it, one 16-bit mask per step
+				std::vector<uint8_t> keys;
+				for (uint16_t mask : candidate.Keys)
+				{
+					keys.push_back(mask & 0xFF);
+					keys.push_back(mask >> 8);
+				}
+				WriteFile(prefix + name + ".keys", keys);
+
+				std::printf("%s at %03X\n", GetFaultName(fault), pc);
+			}
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		if (now - report >= std::chrono::seconds(1) || now - start >= std::chrono::duration<double>(seconds))
+		{
+			double elapsed = std::chrono::duration<double>(now - start).count();
+			std::printf("%llu execs (%.0f/s), %zu in corpus, %u edges, %zu crashes\n", static_cast<unsigned long long>(executions),
+				executions / elapsed, fuzzer->GetCorpusSize(), fuzzer->GetEdgeCount(), fuzzer->GetCrashCount());
+			std::fflush(stdout);
+			report = now;
+
+			if (elapsed >= seconds)
+			{
+				break;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,182 @@
+// Command line debugger
+//
+// Usage: Debug <rom.ch8> [cycles per frame] [quirk profile]
+//
+// Commands (addresses and values in hex):
+//   b <addr>               set a breakpoint       bd <addr>   delete it
+//   w <addr> <size> [r|w]  watch reads/writes     wd          delete all watchpoints
+//   r <v0-vf|i> [value]    stop when the register changes (to value)
+//   rd                     delete all register conditions
+//   c [cycles]             continue               s           step
+//   n                      step over              o           step out
+//   k <key> <0|1>          release/press a key
+//   regs                   dump registers         m <addr> [length]  dump memory
+//   q                      quit
+#include "../Chip8.h"
+#include "../Debugger.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	const char* GetReasonName(StopReason reason)
+	{
+		switch (reason)
+		{
+			case StopReason::Breakpoint: return "breakpoint";
+			case StopReason::Watchpoint: return "watchpoint";
+			case StopReason::RegisterCondition: return "register";
+			case StopReason::Step: return "step";
+			case StopReason::InvalidInstruction: return "invalid instruction";
+			default: return "ran all cycles";
+		}
+	}
+
+	void PrintStop(const Chip8& chip8, const DebugStop& stop)
+	{
+		const auto& memory = chip8.GetMemory();
+		uint16_t pc = stop.ProgramCounter;
+		std::printf("%s after %llu cycles, next %04X: %02X%02X", GetReasonName(stop.Reason), static_cast<unsigned long long>(stop.Cycles),
+			pc, memory[pc], memory[(pc + 1) & 0xFFFF]);
+
+		if (stop.Reason == StopReason::Watchpoint)
+		{
+			std::printf(" (%s %X bytes at %04X)", stop.Access.Type == AccessType::Write ? "writes" : "reads", stop.Access.Size, stop.Access.Address);
+		}
+		else if (stop.Reason == StopReason::RegisterCondition)
+		{
+			if (stop.Register == DEBUG_REGISTER_I)
+				std::printf(" (I=%04X)", chip8.GetIndexRegister());
+			else
+				std::printf(" (V%X=%02X)", stop.Register, chip8.GetRegisters()[stop.Register]);
+		}
+
+		std::printf("\n");
+	}
+
+	bool ParseRegister(const std::string& name, uint8_t& reg)
+	{
+		if (name == "i" || name == "I")
+		{
+			reg = DEBUG_REGISTER_I;
+			return true;
+		}
+
+		if (name.size() == 2 && (name[0] == 'v' || name[0] == 'V'))
+		{
+			reg = static_cast<uint8_t>(std::strtoul(name.c_str() + 1, nullptr, 16) & 0xF);
+			return true;
+		}
+
+		return false;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s <rom.ch8> [cycles per frame] [quirk profile]\n", argv[0]);
+		return -1;
+	}
+
+	unsigned cycles_per_frame = argc > 2 ? std::atoi(argv[2]) : 11;
+	QuirkProfile profile = argc > 3 ? static_cast<QuirkProfile>(std::atoi(argv[3])) : QuirkProfile::Chip8;
+
+	Chip8 chip8(profile);
+	if (!chip8.LoadROM(argv[1]))
+	{
+		std::fprintf(stderr, "Can't load %s\n", argv[1]);
+		return -1;
+	}
+
+	Debugger debugger(chip8, cycles_per_frame);
+
+	std::string line;
+	while (std::printf("> "), std::fflush(stdout), std::getline(std::cin, line))
+	{
+		std::istringstream args(line);
+		std::string command;
+		if (!(args >> command))
+		{
+			continue;
+		}
+
+		std::string a, b, c;
+		args >> a >> b >> c;
+		auto hex = [](const std::string& text, unsigned fallback) { return text.empty() ? fallback : static_cast<unsigned>(std::strtoul(text.c_str(), nullptr, 16)); };
+
+		if (command == "b" || command == "bd")
+		{
+			debugger.SetBreakpoint(static_cast<uint16_t>(hex(a, chip8.GetProgramCounter())), command == "b");
+		}
+		else if (command == "w")
+		{
+			WatchType type = c == "r" ? WatchType::Read : c == "w" ? WatchType::Write : WatchType::ReadWrite;
+			debugger.AddWatchpoint(static_cast<uint16_t>(hex(a, 0)), static_cast<uint16_t>(hex(b, 1)), type);
+		}
+		else if (command == "wd")
+		{
+			debugger.ClearWatchpoints();
+		}
+		else if (command == "r")
+		{
+			uint8_t reg;
+			if (!ParseRegister(a, reg))
+				std::printf("Unknown register %s\n", a.c_str());
+			else if (b.empty())
+				debugger.AddRegisterCondition(reg);
+			else
+				debugger.AddRegisterCondition(reg, static_cast<uint16_t>(hex(b, 0)));
+		}
+		else if (command == "rd")
+		{
+			debugger.ClearRegisterConditions();
+		}
+		else if (command == "c")
+		{
+			PrintStop(chip8, debugger.Run(a.empty() ? UINT64_MAX : std::strtoull(a.c_str(), nullptr, 10)));
+		}
+		else if (command == "s")
+		{
+			PrintStop(chip8, debugger.Step());
+		}
+		else if (command == "n")
+		{
+			PrintStop(chip8, debugger.StepOver());
+		}
+		else if (command == "o")
+		{
+			PrintStop(chip8, debugger.StepOut());
+		}
+		else if (command == "k")
+		{
+			uint8_t key = static_cast<uint8_t>(hex(a, 0) & 0xF);
+			if (hex(b, 1))
+				chip8.PressKey(key);
+			else
+				chip8.ReleaseKey(key);
+		}
+		else if (command == "regs")
+		{
+			std::printf("%s", debugger.DumpRegisters().c_str());
+		}
+		else if (command == "m")
+		{
+			std::printf("%s", debugger.DumpMemory(static_cast<uint16_t>(hex(a, chip8.GetIndexRegister())), hex(b, 64)).c_str());
+		}
+		else if (command == "q")
+		{
+			break;
+		}
+		else
+		{
+			std::printf("Unknown command %s\n", command.c_str());
+		}
+	}
+
+	return 0;
+}
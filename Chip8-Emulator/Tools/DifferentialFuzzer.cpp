@@ -0,0 +1,412 @@
+// Runs the fast interpreter (Chip8) and the reference interpreter side by side on generated programs and stops at the first
+// instruction where their states differ, then shrinks the program to a small reproducer ROM.
+//
+// Usage: DifferentialFuzzer [runs] [seed] [reproducer.ch8]
+//        DifferentialFuzzer --replay <rom.ch8> <quirk profile> <seed>
+//
+// Built with -DCHIP8_LIBFUZZER -fsanitize=fuzzer it is a libFuzzer target instead: the first input byte selects the quirk
+// profile, the next four seed CXNN and the keypad script, and the rest is the ROM.
+#include "../Chip8.h"
+#include "../Chip8State.h"
+#include "../ReferenceInterpreter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Instructions executed per timer tick
+	const unsigned CYCLES_PER_TICK = 11;
+
+	// Instructions between keypad changes
+	const unsigned CYCLES_PER_KEY_CHANGE = 97;
+
+	// Instructions per program before moving on to the next one
+	const uint64_t INSTRUCTIONS_PER_RUN = 20000;
+
+	// Bytes compared around I after every instruction. Every instruction that writes memory writes at most 16 bytes from I
+	const unsigned MEMORY_WINDOW = 32;
+
+	enum class Outcome
+	{
+		// Ran to the instruction limit, halted or hit the same invalid instruction on both sides
+		Agree,
+
+		// The reference interpreter caught an access outside of memory. The fast core wraps at 64KB instead of faulting, so the run stops
+		MemoryFault,
+
+		Diverge
+	};
+
+	struct RunResult
+	{
+		Outcome Result = Outcome::Agree;
+		uint64_t Instructions = 0;
+		std::string Report;
+	};
+
+	std::string Hex(unsigned value)
+	{
+		char text[16];
+		std::snprintf(text, sizeof(text), "%X", value);
+		return text;
+	}
+
+	// First difference between the two machines, or an empty string. The display and the whole of memory are only compared
+	// when asked, the rest of the state every time
+	std::string Compare(const Chip8& fast, const Chip8State& reference, uint16_t index, bool display, bool full_memory)
+	{
+		for (unsigned i = 0; i < REGISTER_COUNT; ++i)
+		{
+			if (fast.GetRegisters()[i] != reference.Registers[i])
+				return "V" + Hex(i) + " " + Hex(fast.GetRegisters()[i]) + " != " + Hex(reference.Registers[i]);
+		}
+
+		if (fast.GetIndexRegister() != reference.IndexRegister)
+			return "I " + Hex(fast.GetIndexRegister()) + " != " + Hex(reference.IndexRegister);
+		if (fast.GetProgramCounter() != reference.ProgramCounter)
+			return "PC " + Hex(fast.GetProgramCounter()) + " != " + Hex(reference.ProgramCounter);
+		if (fast.GetStackPointer() != reference.StackPointer)
+			return "SP " + Hex(fast.GetStackPointer()) + " != " + Hex(reference.StackPointer);
+		if (fast.GetStack() != reference.Stack)
+			return "stack";
+		if (fast.GetDelayTimer() != reference.DelayTimer)
+			return "delay timer " + Hex(fast.GetDelayTimer()) + " != " + Hex(reference.DelayTimer);
+		if (fast.GetSoundTimer() != reference.SoundTimer)
+			return "sound timer " + Hex(fast.GetSoundTimer()) + " != " + Hex(reference.SoundTimer);
+		if (fast.IsHalted() != reference.Halted)
+			return "halted";
+		if (fast.GetPitch() != reference.Pitch)
+			return "pitch " + Hex(fast.GetPitch()) + " != " + Hex(reference.Pitch);
+		if (fast.GetAudioPattern() != reference.AudioPattern)
+			return "audio pattern";
+		if (fast.GetRplFlags() != reference.RplFlags)
+			return "RPL flags";
+		if (fast.GetCycleCount() != reference.CycleCount)
+			return "cycle count";
+		if (display && !(fast.VideoBuffer == reference.VideoBuffer))
+			return "display";
+
+		unsigned begin = full_memory ? 0 : index;
+		unsigned end = full_memory ? MEMORY_SIZE : std::min<unsigned>(index + MEMORY_WINDOW, MEMORY_SIZE);
+		for (unsigned address = begin; address < end; ++address)
+		{
+			if (fast.GetMemory()[address] != reference.Memory[address])
+				return "memory at " + Hex(address) + " " + Hex(fast.GetMemory()[address]) + " != " + Hex(reference.Memory[address]);
+		}
+
+		return {};
+	}
+
+	// Run both interpreters over the same ROM, checking after every instruction
+	RunResult RunLockstep(const std::vector<uint8_t>& rom, QuirkProfile profile, uint32_t seed, uint64_t max_instructions)
+	{
+		RunResult result;
+
+		Chip8 fast(profile);
+		fast.Seed(seed);
+		if (rom.empty() || !fast.LoadROM(std::span<const uint8_t>(rom)))
+		{
+			return result;
+		}
+
+		Chip8State reference;
+		fast.SaveState(reference);
+
+		// Keypad script, the same for both sides
+		uint32_t key_state = seed ^ 0x9E3779B9;
+		if (key_state == 0)
+			key_state = 1;
+
+		for (uint64_t step = 0; step < max_instructions; ++step)
+		{
+			if (step % CYCLES_PER_KEY_CHANGE == 0)
+			{
+				uint16_t keys = (NextRandom(key_state) << 8) | NextRandom(key_state);
+				keys &= (NextRandom(key_state) << 8) | NextRandom(key_state);
+				fast.Keypad = keys;
+				reference.Keypad = keys;
+			}
+
+			if (step % CYCLES_PER_TICK == 0 && step != 0)
+			{
+				fast.UpdateTimers();
+				ReferenceUpdateTimers(reference);
+			}
+
+			uint16_t pc = reference.ProgramCounter;
+			uint16_t opcode = pc + 1u < MEMORY_SIZE ? (reference.Memory[pc] << 8) | reference.Memory[pc + 1] : 0;
+			uint16_t index = reference.IndexRegister;
+
+			ReferenceResult expected = ReferenceCycle(reference);
+			if (expected == ReferenceResult::MemoryFault)
+			{
+				result.Result = Outcome::MemoryFault;
+				return result;
+			}
+
+			bool threw = false;
+			try
+			{
+				fast.Cycle();
+			}
+			catch (const std::exception&)
+			{
+				threw = true;
+			}
+
+			++result.Instructions;
+
+			std::string difference;
+			if (threw != (expected == ReferenceResult::InvalidInstruction))
+				difference = threw ? "only the fast core rejected the opcode" : "only the reference rejected the opcode";
+			else
+				difference = Compare(fast, reference, index, (opcode >> 12) == 0x0 || (opcode >> 12) == 0xD, false);
+
+			// Everything at the end of the run, which catches the display being touched by anything other than 0NNN and DXYN
+			if (difference.empty() && (threw || reference.Halted || step + 1 == max_instructions))
+				difference = Compare(fast, reference, index, true, true);
+
+			if (!difference.empty())
+			{
+				result.Result = Outcome::Diverge;
+				result.Report = "instruction " + std::to_string(step) + " at " + Hex(pc) + " (" + Hex(opcode) + "): " + difference;
+				return result;
+			}
+
+			if (threw || reference.Halted)
+			{
+				break;
+			}
+		}
+
+		return result;
+	}
+
+	void Report(const std::vector<uint8_t>& rom, QuirkProfile profile, uint32_t seed, const std::string& report)
+	{
+		std::fprintf(stderr, "Divergence (profile %u, seed %u, %zu bytes): %s\n", static_cast<unsigned>(profile), seed, rom.size(), report.c_str());
+	}
+}
+
+#ifdef CHIP8_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	if (size < 7)
+	{
+		return 0;
+	}
+
+	QuirkProfile profile = static_cast<QuirkProfile>(data[0] % QUIRK_PROFILE_COUNT);
+	uint32_t seed = data[1] | (data[2] << 8) | (data[3] << 16) | (static_cast<uint32_t>(data[4]) << 24);
+	std::vector<uint8_t> rom(data + 5, data + size);
+
+	RunResult result = RunLockstep(rom, profile, seed, INSTRUCTIONS_PER_RUN);
+	if (result.Result == Outcome::Diverge)
+	{
+		Report(rom, profile, seed, result.Report);
+		std::abort();
+	}
+
+	return 0;
+}
+
+#else
+
+namespace
+{
+	bool Diverges(const std::vector<uint8_t>& rom, QuirkProfile profile, uint32_t seed)
+	{
+		return RunLockstep(rom, profile, seed, INSTRUCTIONS_PER_RUN).Result == Outcome::Diverge;
+	}
+
+	// Delta debugging over instructions: drop ever smaller chunks, then turn what is left into 0000 (ignored) one by one,
+	// keeping every change that still diverges
+	std::vector<uint8_t> Minimise(std::vector<uint8_t> rom, QuirkProfile profile, uint32_t seed)
+	{
+		for (size_t chunk = (rom.size() / 2) & ~size_t(1); chunk >= 2; chunk /= 2)
+		{
+			chunk &= ~size_t(1);
+			for (size_t start = 0; start + chunk <= rom.size(); )
+			{
+				std::vector<uint8_t> candidate(rom);
+				candidate.erase(candidate.begin() + start, candidate.begin() + start + chunk);
+				if (!candidate.empty() && Diverges(candidate, profile, seed))
+					rom = std::move(candidate);
+				else
+					start += chunk;
+			}
+		}
+
+		for (size_t offset = 0; offset + 1 < rom.size(); offset += 2)
+		{
+			if (rom[offset] == 0 && rom[offset + 1] == 0)
+				continue;
+
+			std::vector<uint8_t> candidate(rom);
+			candidate[offset] = 0;
+			candidate[offset + 1] = 0;
+			if (Diverges(candidate, profile, seed))
+				rom = std::move(candidate);
+		}
+
+		while (rom.size() > 2 && rom.back() == 0 && Diverges(std::vector<uint8_t>(rom.begin(), rom.end() - 1), profile, seed))
+			rom.pop_back();
+
+		return rom;
+	}
+
+	// Random programs made of plausible instructions for the profile, so runs get past the first few opcodes
+	std::vector<uint8_t> GenerateRom(uint32_t& rng)
+	{
+		static const uint16_t templates[] =
+		{
+			0x00E0, 0x00EE, 0x00C0, 0x00D0, 0x00FB, 0x00FC, 0x00FE, 0x00FF,
+			0x1000, 0x2000, 0x3000, 0x4000, 0x5000, 0x5002, 0x5003, 0x6000, 0x7000,
+			0x8000, 0x8001, 0x8002, 0x8003, 0x8004, 0x8005, 0x8006, 0x8007, 0x800E,
+			0x9000, 0xA000, 0xB000, 0xC000, 0xD000, 0xE09E, 0xE0A1,
+			0xF000, 0xF001, 0xF002, 0xF007, 0xF00A, 0xF015, 0xF018, 0xF01E, 0xF029, 0xF030,
+			0xF033, 0xF03A, 0xF055, 0xF065, 0xF075, 0xF085
+		};
+
+		unsigned length = 2 + (NextRandom(rng) % 128) * 2;
+		std::vector<uint8_t> rom(length);
+		for (unsigned offset = 0; offset < length; offset += 2)
+		{
+			uint16_t opcode;
+			unsigned choice = NextRandom(rng);
+			if (choice < 8)
+			{
+				// Raw bytes, mostly invalid
+				opcode = (NextRandom(rng) << 8) | NextRandom(rng);
+			}
+			else
+			{
+				opcode = templates[NextRandom(rng) % (sizeof(templates) / sizeof(templates[0]))];
+				uint16_t x = NextRandom(rng) & 0xF;
+				uint16_t y = NextRandom(rng) & 0xF;
+
+				switch (opcode >> 12)
+				{
+					case 0x0:
+						if ((opcode & 0xFFE0) == 0x00C0)
+							opcode |= NextRandom(rng) & 0xF;
+						break;
+
+					case 0x1:
+					case 0x2:
+					case 0xA:
+					case 0xB:
+						// Keep jumps and I inside or near the program
+						opcode |= ROM_START_ADDRESS + ((NextRandom(rng) % (length + 16)) & ~1u);
+						break;
+
+					case 0x3:
+					case 0x4:
+					case 0x6:
+					case 0x7:
+					case 0xC:
+						opcode |= (x << 8) | NextRandom(rng);
+						break;
+
+					case 0xD:
+						opcode |= (x << 8) | (y << 4) | (NextRandom(rng) & 0xF);
+						break;
+
+					case 0xF:
+						if (opcode == 0xF000 || opcode == 0xF002)
+							break;
+						if (opcode == 0xF001)
+							opcode |= (NextRandom(rng) & 0x3) << 8;
+						else
+							opcode |= x << 8;
+						break;
+
+					default:
+						opcode |= (x << 8) | (y << 4);
+						break;
+				}
+			}
+
+			rom[offset] = opcode >> 8;
+			rom[offset + 1] = opcode & 0xFF;
+		}
+
+		return rom;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && std::strcmp(argv[1], "--replay") == 0)
+	{
+		if (argc < 5)
+		{
+			std::fprintf(stderr, "Usage: %s --replay <rom.ch8> <quirk profile> <seed>\n", argv[0]);
+			return -1;
+		}
+
+		std::ifstream file(argv[2], std::ios::binary);
+		std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		QuirkProfile profile = static_cast<QuirkProfile>(std::atoi(argv[3]));
+		uint32_t seed = static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 0));
+
+		RunResult result = RunLockstep(rom, profile, seed, INSTRUCTIONS_PER_RUN);
+		if (result.Result == Outcome::Diverge)
+		{
+			Report(rom, profile, seed, result.Report);
+			return 1;
+		}
+
+		std::printf("%llu instructions, no divergence\n", static_cast<unsigned long long>(result.Instructions));
+		return 0;
+	}
+
+	unsigned runs = argc > 1 ? std::atoi(argv[1]) : 10000;
+	uint32_t rng = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 0)) : 1;
+	const char* reproducer = argc > 3 ? argv[3] : "divergence.ch8";
+	if (rng == 0)
+		rng = 1;
+
+	uint64_t instructions = 0;
+	unsigned faults = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	for (unsigned run = 0; run < runs; ++run)
+	{
+		QuirkProfile profile = static_cast<QuirkProfile>(run % QUIRK_PROFILE_COUNT);
+		uint32_t seed = (NextRandom(rng) << 24) | (NextRandom(rng) << 16) | (NextRandom(rng) << 8) | NextRandom(rng) | 1;
+		std::vector<uint8_t> rom = GenerateRom(rng);
+
+		RunResult result = RunLockstep(rom, profile, seed, INSTRUCTIONS_PER_RUN);
+		instructions += result.Instructions;
+		faults += result.Result == Outcome::MemoryFault;
+
+		if (result.Result == Outcome::Diverge)
+		{
+			Report(rom, profile, seed, result.Report);
+
+			rom = Minimise(rom, profile, seed);
+			Report(rom, profile, seed, RunLockstep(rom, profile, seed, INSTRUCTIONS_PER_RUN).Report);
+
+			std::ofstream out(reproducer, std::ios::binary);
+			out.write(reinterpret_cast<const char*>(rom.data()), rom.size());
+			std::fprintf(stderr, "Reproducer written to %s (replay with --replay %s %u %u)\n", reproducer, reproducer, static_cast<unsigned>(profile), seed);
+			return 1;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::printf("%u runs, %llu instructions in lockstep, %u stopped at memory faults, %.2f million instructions/s\n",
+		runs, static_cast<unsigned long long>(instructions), faults, instructions / seconds / 1e6);
+	return 0;
+}
+
+#endif
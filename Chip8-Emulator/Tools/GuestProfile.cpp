@@ -0,0 +1,86 @@
+// Runs a ROM headless under the guest sampling profiler and writes collapsed stacks for flamegraph.pl or speedscope
+//
+// Usage: GuestProfile <rom.ch8> <output.folded> [frames] [cycles per frame] [quirk profile] [sample interval] [labels.txt]
+#include "../Chip8.h"
+#include "../GuestProfiler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+
+namespace
+{
+	// Run the ROM for the given number of frames, returning the seconds it took
+	double RunFrames(Chip8& chip8, GuestProfiler* profiler, unsigned frames, unsigned cycles_per_frame)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		try
+		{
+			for (unsigned frame = 0; frame < frames; ++frame)
+			{
+				if (profiler)
+				{
+					profiler->Run(chip8, cycles_per_frame);
+				}
+				else
+				{
+					for (unsigned i = 0; i < cycles_per_frame; ++i)
+					{
+						chip8.Cycle();
+					}
+				}
+
+				chip8.UpdateTimers();
+			}
+		}
+		catch (const std::exception& e)
+		{
+			std::fprintf(stderr, "%s\n", e.what());
+		}
+
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::fprintf(stderr, "Usage: %s <rom.ch8> <output.folded> [frames] [cycles per frame] [quirk profile] [sample interval] [labels.txt]\n", argv[0]);
+		return -1;
+	}
+
+	unsigned frames = argc > 3 ? std::atoi(argv[3]) : 600;
+	unsigned cycles_per_frame = argc > 4 ? std::atoi(argv[4]) : 11;
+	QuirkProfile profile = argc > 5 ? static_cast<QuirkProfile>(std::atoi(argv[5])) : QuirkProfile::Chip8;
+	unsigned interval = argc > 6 ? std::atoi(argv[6]) : 1000;
+
+	GuestProfiler profiler(interval);
+	if (argc > 7 && !profiler.LoadLabels(argv[7]))
+	{
+		std::fprintf(stderr, "Can't load %s\n", argv[7]);
+		return -1;
+	}
+
+	// Once without the profiler for the overhead figure, then for real
+	Chip8 baseline(profile);
+	Chip8 chip8(profile);
+	if (!baseline.LoadROM(argv[1]) || !chip8.LoadROM(argv[1]))
+	{
+		std::fprintf(stderr, "Can't load %s\n", argv[1]);
+		return -1;
+	}
+
+	double unprofiled = RunFrames(baseline, nullptr, frames, cycles_per_frame);
+	double profiled = RunFrames(chip8, &profiler, frames, cycles_per_frame);
+
+	if (!profiler.WriteCollapsed(argv[2]))
+	{
+		std::fprintf(stderr, "Can't write %s\n", argv[2]);
+		return -1;
+	}
+
+	std::printf("%llu samples, %.1f%% overhead\n", static_cast<unsigned long long>(profiler.GetSampleCount()), (profiled / unprofiled - 1.0) * 100.0);
+	return 0;
+}
@@ -0,0 +1,72 @@
+// Runs a ROM headless with instrumentation and writes the counters as <prefix>.json and a heatmap of the address space as <prefix>.ppm
+//
+// Usage: Instrument <rom.ch8> <output prefix> [frames] [cycles per frame] [quirk profile]
+//
+// The whole emulator has to be built with CHIP8_INSTRUMENTATION for the hooks to exist
+#ifndef CHIP8_INSTRUMENTATION
+#error Build with -DCHIP8_INSTRUMENTATION
+#endif
+
+#include "../Chip8.h"
+#include "../Instrumentation.h"
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <string>
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::fprintf(stderr, "Usage: %s <rom.ch8> <output prefix> [frames] [cycles per frame] [quirk profile]\n", argv[0]);
+		return -1;
+	}
+
+	unsigned frames = argc > 3 ? std::atoi(argv[3]) : 600;
+	unsigned cycles_per_frame = argc > 4 ? std::atoi(argv[4]) : 11;
+	QuirkProfile profile = argc > 5 ? static_cast<QuirkProfile>(std::atoi(argv[5])) : QuirkProfile::Chip8;
+
+	Chip8 chip8(profile);
+	if (!chip8.LoadROM(argv[1]))
+	{
+		std::fprintf(stderr, "Can't load %s\n", argv[1]);
+		return -1;
+	}
+
+	// 128KB of PC counters, so not on the stack
+	auto instrumentation = std::make_unique<Instrumentation>();
+	chip8.SetInstrumentation(instrumentation.get());
+
+	try
+	{
+		for (unsigned frame = 0; frame < frames; ++frame)
+		{
+			for (unsigned i = 0; i < cycles_per_frame; ++i)
+			{
+				chip8.Cycle();
+			}
+
+			chip8.UpdateTimers();
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+	}
+
+	std::string prefix = argv[2];
+	if (!instrumentation->WriteJson((prefix + ".json").c_str()) || !instrumentation->WriteHeatmap((prefix + ".ppm").c_str(), chip8.GetMemorySize()))
+	{
+		std::fprintf(stderr, "Can't write %s.json/.ppm\n", prefix.c_str());
+		return -1;
+	}
+
+	// Hottest instruction classes on the console
+	std::printf("%llu instructions, %llu skips, %llu pixels drawn, %llu collisions, stack high water %u\n",
+		static_cast<unsigned long long>(instrumentation->GetInstructionCount()), static_cast<unsigned long long>(instrumentation->GetSkipCount()),
+		static_cast<unsigned long long>(instrumentation->GetPixelsDrawn()), static_cast<unsigned long long>(instrumentation->GetCollisionCount()),
+		instrumentation->GetStackHighWater());
+
+	return 0;
+}
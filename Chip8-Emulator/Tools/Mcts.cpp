@@ -0,0 +1,161 @@
+// Plays a game with MctsAgent, as a soak test and a benchmark of cloning and running machines on every core.
+//
+// Usage: Mcts <rom.ch8> [moves] [rollouts per move] [threads] [reward] [keys] [rollout frames] [quirk profile]
+//
+// The defaults play breakout.ch8, which keeps its score in V5 and its lives in VE and moves the paddle with 4 and 6.
+// reward is a sum of weighted bytes, "V5*1,VE*20" (registers as VX, memory as a hex address such as 316*10). keys lists
+// the actions, one hex key each with - for no key. threads can be a list, "1,2,4", to play the same game at each thread
+// count and compare how throughput scales. Each move holds its key for 4 frames
+#include "../Chip8.h"
+#include "../MctsAgent.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const unsigned CYCLES_PER_FRAME = 11;
+	const unsigned FRAMES_PER_ACTION = 4;
+
+	// Moves between progress lines
+	const unsigned PROGRESS_INTERVAL = 50;
+
+	struct RewardTerm
+	{
+		// A register if Register is set, a memory address otherwise
+		bool Register;
+		uint16_t Location;
+		double Weight;
+	};
+
+	bool ParseReward(const std::string& text, std::vector<RewardTerm>& terms)
+	{
+		std::istringstream stream(text);
+		std::string item;
+		while (std::getline(stream, item, ','))
+		{
+			size_t star = item.find('*');
+			if (item.empty() || star == 0)
+			{
+				return false;
+			}
+
+			RewardTerm term;
+			term.Register = item[0] == 'V' || item[0] == 'v';
+			const char* location = item.c_str() + (term.Register ? 1 : 0);
+			char* end = nullptr;
+			term.Location = static_cast<uint16_t>(std::strtoul(location, &end, 16));
+			term.Weight = star != std::string::npos ? std::atof(item.c_str() + star + 1) : 1.0;
+			if (end == location || (*end != '*' && *end != '\0') || (term.Register ? term.Location >= REGISTER_COUNT : term.Location >= CHIP8_MEMORY_SIZE))
+			{
+				return false;
+			}
+
+			terms.push_back(term);
+		}
+
+		return !terms.empty();
+	}
+
+	std::vector<uint16_t> ParseKeys(const std::string& text)
+	{
+		std::vector<uint16_t> actions;
+		for (char key : text)
+		{
+			if (key == '-')
+				actions.push_back(0);
+			else if (std::isxdigit(static_cast<unsigned char>(key)))
+				actions.push_back(static_cast<uint16_t>(1u << std::stoi(std::string(1, key), nullptr, 16)));
+		}
+
+		return actions;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s <rom.ch8> [moves] [rollouts per move] [threads] [reward] [keys] [rollout frames] [quirk profile]\n", argv[0]);
+		return -1;
+	}
+
+	unsigned moves = argc > 2 ? std::atoi(argv[2]) : 1000;
+	unsigned rollouts = argc > 3 ? std::max(1, std::atoi(argv[3])) : 500;
+	std::string thread_list = argc > 4 ? argv[4] : std::to_string(std::max(1u, std::thread::hardware_concurrency()));
+	std::string reward_text = argc > 5 ? argv[5] : "V5*1,VE*20";
+	std::vector<uint16_t> actions = ParseKeys(argc > 6 ? argv[6] : "-46");
+	unsigned rollout_frames = argc > 7 ? std::atoi(argv[7]) : 200;
+	QuirkProfile profile = argc > 8 ? static_cast<QuirkProfile>(std::atoi(argv[8])) : QuirkProfile::Chip8;
+
+	std::vector<RewardTerm> terms;
+	if (!ParseReward(reward_text, terms) || actions.empty())
+	{
+		std::fprintf(stderr, "Bad reward %s or keys\n", reward_text.c_str());
+		return -1;
+	}
+
+	auto reward = [terms](const Chip8& machine)
+	{
+		double total = 0.0;
+		for (const RewardTerm& term : terms)
+		{
+			uint8_t value = term.Register ? machine.GetRegisters()[term.Location] : machine.GetMemory().GetBytes()[term.Location];
+			total += term.Weight * value;
+		}
+
+		return total;
+	};
+
+	Chip8 start(profile);
+	if (!start.LoadROM(argv[1]))
+	{
+		std::fprintf(stderr, "Can't load %s\n", argv[1]);
+		return -1;
+	}
+
+	std::printf("%u moves of %u rollouts, %u frames each, %u hardware threads\n", moves, rollouts, rollout_frames, std::thread::hardware_concurrency());
+	std::printf("%8s %12s %14s %14s %10s %10s %10s\n", "threads", "reward", "rollouts/s", "per thread", "MIPS", "restore", "ms/move");
+
+	std::istringstream threads_stream(thread_list);
+	std::string item;
+	while (std::getline(threads_stream, item, ','))
+	{
+		unsigned threads = std::max(1, std::atoi(item.c_str()));
+		MctsAgent agent(actions, reward, threads);
+		agent.SetCyclesPerFrame(CYCLES_PER_FRAME);
+		agent.SetFramesPerAction(FRAMES_PER_ACTION);
+		agent.SetRolloutFrames(rollout_frames);
+
+		Chip8 machine = start;
+		unsigned move = 0;
+		for (; move < moves; ++move)
+		{
+			uint16_t keypad = agent.Search(machine, rollouts);
+			if (!agent.RunAction(machine, keypad))
+			{
+				++move;
+				break;
+			}
+
+			if (thread_list.find(',') == std::string::npos && (move + 1) % PROGRESS_INTERVAL == 0)
+			{
+				std::fprintf(stderr, "move %u: reward %.1f\n", move + 1, reward(machine));
+			}
+		}
+
+		// Per thread is rollouts over the time the workers were busy, which drops once threads outnumber cores
+		const MctsStats& stats = agent.GetStats();
+		double seconds = stats.SearchMs / 1000.0;
+		std::printf("%8u %12.1f %14.0f %14.0f %10.1f %9.1f%% %10.2f\n", threads, reward(machine),
+			stats.Rollouts / seconds, stats.Rollouts / (stats.WorkerMs / 1000.0),
+			stats.Frames * CYCLES_PER_FRAME / seconds / 1e6, 100.0 * stats.RestoreMs / stats.WorkerMs, stats.SearchMs / move);
+	}
+
+	return 0;
+}
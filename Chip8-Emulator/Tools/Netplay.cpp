@@ -0,0 +1,224 @@
+// Plays a ROM as two rollback netplay peers in one process, with scripted input for each player and a simulated network
+// between them, then checks both peers finished with exactly the machine an offline run with the true inputs produces.
+// Player one has keys 0-7, player two keys 8-F.
+//
+// Usage: Netplay <rom.ch8> [frames] [latency frames] [jitter frames] [loss %] [loopback|udp] [quirk profile]
+//
+// udp sends the packets through two sockets on 127.0.0.1 rather than straight across. Either way latency, jitter and loss
+// are added on top, counted in frames
+#include "../Chip8.h"
+#include "../Chip8State.h"
+#include "../RollbackSession.h"
+#include "../RollbackTransport.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	const unsigned CYCLES_PER_FRAME = 11;
+
+	// Keys each player owns
+	const uint16_t PLAYER_ONE_KEYS = 0x00FF;
+	const uint16_t PLAYER_TWO_KEYS = 0xFF00;
+
+	// Give up if the peers stop making progress for this many frames (a transport that has lost its peer)
+	const unsigned IDLE_LIMIT = 10000;
+
+	// Frame time the resimulation has to fit in
+	const double FRAME_MS = 1000.0 / 60.0;
+
+	// Held keys for each frame: a key or none from the player's half of the keypad, changing every few frames like a human
+	std::vector<uint16_t> ScriptInput(unsigned frames, uint16_t keys, uint32_t seed)
+	{
+		std::vector<uint16_t> script(frames);
+
+		uint32_t state = seed;
+		auto next = [&]()
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		};
+
+		uint16_t held = 0;
+		unsigned hold = 0;
+		for (unsigned frame = 0; frame < frames; ++frame)
+		{
+			if (hold == 0)
+			{
+				unsigned key = next() % 20;
+				held = key < 16 ? static_cast<uint16_t>((1u << key) & keys) : 0;
+				hold = 4 + next() % 30;
+			}
+
+			script[frame] = held;
+			--hold;
+		}
+
+		return script;
+	}
+
+	void PrintStats(char const* name, const RollbackSession& session)
+	{
+		const RollbackStats& stats = session.GetStats();
+		std::printf("%s: %llu frames, %llu rollbacks, %llu frames resimulated, %llu stalls, max depth %u, resimulation %.3f ms total, %.3f ms worst\n",
+			name, static_cast<unsigned long long>(stats.Frames), static_cast<unsigned long long>(stats.Rollbacks),
+			static_cast<unsigned long long>(stats.ResimulatedFrames), static_cast<unsigned long long>(stats.Stalls), stats.MaxDepth,
+			stats.TotalResimulationMs, stats.MaxResimulationMs);
+
+		std::printf("  depth:");
+		for (unsigned depth = 1; depth <= ROLLBACK_WINDOW; ++depth)
+		{
+			if (stats.DepthHistogram[depth] != 0)
+			{
+				std::printf(" %u:%llu", depth, static_cast<unsigned long long>(stats.DepthHistogram[depth]));
+			}
+		}
+
+		std::printf("\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s <rom.ch8> [frames] [latency frames] [jitter frames] [loss %%] [loopback|udp] [quirk profile]\n", argv[0]);
+		return -1;
+	}
+
+	unsigned frames = argc > 2 ? std::atoi(argv[2]) : 3600;
+	unsigned latency = argc > 3 ? std::atoi(argv[3]) : 4;
+	unsigned jitter = argc > 4 ? std::atoi(argv[4]) : 3;
+	unsigned loss = argc > 5 ? std::atoi(argv[5]) : 5;
+	bool udp = argc > 6 && std::strcmp(argv[6], "udp") == 0;
+	QuirkProfile profile = argc > 7 ? static_cast<QuirkProfile>(std::atoi(argv[7])) : QuirkProfile::Chip8;
+
+	// Three copies of the machine: the two peers and the offline reference. Each is about 70KB, so not on the stack
+	auto reference = std::make_unique<Chip8>(profile);
+	if (!reference->LoadROM(argv[1]))
+	{
+		std::fprintf(stderr, "Can't load %s\n", argv[1]);
+		return -1;
+	}
+
+	auto one = std::make_unique<Chip8>(*reference);
+	auto two = std::make_unique<Chip8>(*reference);
+
+	std::vector<uint16_t> one_input = ScriptInput(frames, PLAYER_ONE_KEYS, 0x1234567);
+	std::vector<uint16_t> two_input = ScriptInput(frames, PLAYER_TWO_KEYS, 0x7654321);
+
+	// The wire, then the simulated network on each side's receiving end
+	LoopbackTransport one_loopback;
+	LoopbackTransport two_loopback;
+	UdpTransport one_udp;
+	UdpTransport two_udp;
+	RollbackTransport* one_wire = &one_loopback;
+	RollbackTransport* two_wire = &two_loopback;
+	if (udp)
+	{
+		if (!one_udp.Open(0) || !two_udp.Open(0) || !one_udp.Connect("127.0.0.1", two_udp.GetPort()) || !two_udp.Connect("127.0.0.1", one_udp.GetPort()))
+		{
+			std::fprintf(stderr, "Can't open UDP sockets on 127.0.0.1\n");
+			return -1;
+		}
+
+		one_wire = &one_udp;
+		two_wire = &two_udp;
+	}
+	else
+	{
+		LoopbackTransport::Connect(one_loopback, two_loopback);
+	}
+
+	LatencyTransport one_network(*one_wire, latency, jitter, loss, 0x2468ACE);
+	LatencyTransport two_network(*two_wire, latency, jitter, loss, 0x13579BD);
+
+	RollbackSession one_session(*one, one_network, PLAYER_ONE_KEYS, PLAYER_TWO_KEYS, CYCLES_PER_FRAME);
+	RollbackSession two_session(*two, two_network, PLAYER_TWO_KEYS, PLAYER_ONE_KEYS, CYCLES_PER_FRAME);
+
+	try
+	{
+		// Each pass is one frame of wall time on both sides. Play until both have run every frame and seen all of the other's input
+		unsigned idle = 0;
+		auto finished = [&](const RollbackSession& session) { return session.GetFrame() == frames && session.GetConfirmedFrame() == frames; };
+		while (!finished(one_session) || !finished(two_session))
+		{
+			one_network.Tick();
+			two_network.Tick();
+
+			bool progress = false;
+			for (auto [session, input] : { std::pair(&one_session, &one_input), std::pair(&two_session, &two_input) })
+			{
+				uint32_t confirmed = session->GetConfirmedFrame();
+				if (session->GetFrame() < frames)
+				{
+					progress |= session->AdvanceFrame((*input)[session->GetFrame()]);
+				}
+				else
+				{
+					session->Poll();
+				}
+
+				progress |= session->GetConfirmedFrame() != confirmed;
+			}
+
+			idle = progress ? 0 : idle + 1;
+			if (idle == IDLE_LIMIT)
+			{
+				std::fprintf(stderr, "No progress for %u frames, stopped at frames %u/%u\n", IDLE_LIMIT, one_session.GetFrame(), two_session.GetFrame());
+				return -1;
+			}
+
+			// Let the datagrams cross
+			if (udp)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+		}
+
+		for (unsigned frame = 0; frame < frames; ++frame)
+		{
+			RollbackSession::RunFrame(*reference, (one_input[frame] & PLAYER_ONE_KEYS) | (two_input[frame] & PLAYER_TWO_KEYS), CYCLES_PER_FRAME);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return -1;
+	}
+
+	PrintStats("Player one", one_session);
+	PrintStats("Player two", two_session);
+
+	auto expected = std::make_unique<Chip8State>();
+	auto actual = std::make_unique<Chip8State>();
+	reference->SaveState(*expected);
+
+	bool match = true;
+	for (auto [name, machine] : { std::pair("Player one", one.get()), std::pair("Player two", two.get()) })
+	{
+		machine->SaveState(*actual);
+		if (!(*actual == *expected))
+		{
+			std::printf("%s differs from the offline run (PC %03X vs %03X, display %016llX vs %016llX)\n", name, actual->ProgramCounter,
+				expected->ProgramCounter, static_cast<unsigned long long>(actual->VideoBuffer.GetHash()),
+				static_cast<unsigned long long>(expected->VideoBuffer.GetHash()));
+			match = false;
+		}
+	}
+
+	double worst = std::max(one_session.GetStats().MaxResimulationMs, two_session.GetStats().MaxResimulationMs);
+	std::printf("%s, worst resimulation %.3f ms of a %.1f ms frame\n", match ? "Both peers match the offline run" : "MISMATCH", worst, FRAME_MS);
+
+	return match && worst < FRAME_MS ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+// RAM watch and cheat finder: runs many copies of a ROM, each pressing its own random keys, and narrows down which bytes of
+// memory or registers behave like the variable you are looking for
+//
+// Usage: RamSearch <rom.ch8> [machines] [cycles per frame] [quirk profile] [threads]
+//
+// Commands (values in hex):
+//   run <frames>           run every machine for a number of frames (decimal)
+//   new                    start a new search from the current state, every address a candidate
+//   eq|ne|lt|gt <value>    keep bytes equal to, not equal to, below or above a value
+//   changed|unchanged      keep bytes that changed, or didn't, since the last snapshot
+//   inc|dec [n]            keep bytes that went up or down since the last snapshot, by exactly n if given
+//   list [machine]         candidates of a machine with their values
+//   votes [count]          addresses that are candidates in the most machines
+//   q                      quit
+//
+// e.g. to find breakout's score: run 60, new, run 600, inc, unchanged after a frame with no hit, and so on. Every
+// filter takes a new snapshot of every machine
+#include "../Chip8.h"
+#include "../RamSearch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Chance in 256 that a machine switches to a new random key (or none) on a frame
+	const unsigned KEY_CHANGE_CHANCE = 16;
+
+	void PrintAddress(uint16_t address)
+	{
+		if (address >= RAM_SEARCH_REGISTER_BASE)
+			std::printf("V%X  ", address - RAM_SEARCH_REGISTER_BASE);
+		else
+			std::printf("%03X ", address);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s <rom.ch8> [machines] [cycles per frame] [quirk profile] [threads]\n", argv[0]);
+		return -1;
+	}
+
+	unsigned machine_count = argc > 2 ? std::max(1, std::atoi(argv[2])) : 1024;
+	unsigned cycles_per_frame = argc > 3 ? std::atoi(argv[3]) : 11;
+	QuirkProfile profile = argc > 4 ? static_cast<QuirkProfile>(std::atoi(argv[4])) : QuirkProfile::Chip8;
+	unsigned threads = argc > 5 ? std::max(1, std::atoi(argv[5])) : std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<Chip8> machines(1, Chip8(profile));
+	if (!machines[0].LoadROM(argv[1]))
+	{
+		std::fprintf(stderr, "Can't load %s\n", argv[1]);
+		return -1;
+	}
+
+	// Same ROM, different CXNN seeds and key presses
+	machines.resize(machine_count, machines[0]);
+	std::vector<uint32_t> key_state(machine_count);
+	std::vector<bool> faulted(machine_count, false);
+	for (unsigned i = 0; i < machine_count; ++i)
+	{
+		machines[i].Seed(i + 1);
+		key_state[i] = 0x9E3779B9u * (i + 1);
+	}
+
+	auto run = [&](unsigned frames)
+	{
+		auto step = [&](unsigned first, unsigned last)
+		{
+			for (unsigned i = first; i < last; ++i)
+			{
+				for (unsigned frame = 0; frame < frames && !faulted[i]; ++frame)
+				{
+					if (NextRandom(key_state[i]) < KEY_CHANGE_CHANCE)
+					{
+						uint8_t key = NextRandom(key_state[i]);
+						machines[i].Keypad = key < 128 ? static_cast<uint16_t>(1u << (key & 0xF)) : 0;
+					}
+
+					try
+					{
+						for (unsigned cycle = 0; cycle < cycles_per_frame; ++cycle)
+						{
+							machines[i].Cycle();
+						}
+					}
+					catch (const std::exception&)
+					{
+						faulted[i] = true;
+					}
+
+					machines[i].UpdateTimers();
+				}
+			}
+		};
+
+		unsigned thread_count = std::min(threads, machine_count);
+		std::vector<std::thread> workers;
+		for (unsigned thread = 1; thread < thread_count; ++thread)
+		{
+			workers.emplace_back(step, machine_count * thread / thread_count, machine_count * (thread + 1) / thread_count);
+		}
+
+		step(0, machine_count / thread_count);
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	};
+
+	const std::map<std::string, SearchPredicate> predicates = {
+		{ "eq", SearchPredicate::Equal }, { "ne", SearchPredicate::NotEqual },
+		{ "lt", SearchPredicate::LessThan }, { "gt", SearchPredicate::GreaterThan },
+		{ "changed", SearchPredicate::Changed }, { "unchanged", SearchPredicate::Unchanged },
+		{ "inc", SearchPredicate::Increased }, { "dec", SearchPredicate::Decreased },
+	};
+
+	RamSearch search(threads);
+	search.Start(machines);
+	std::printf("%u machines, %llu candidates\n", machine_count, static_cast<unsigned long long>(search.GetCandidateCount()));
+
+	std::vector<uint16_t> addresses;
+	std::vector<uint32_t> votes;
+	std::string line;
+	while (std::printf("> "), std::fflush(stdout), std::getline(std::cin, line))
+	{
+		std::istringstream args(line);
+		std::string command;
+		if (!(args >> command))
+		{
+			continue;
+		}
+
+		std::string a;
+		args >> a;
+		auto start = std::chrono::steady_clock::now();
+		auto elapsed = [&]() { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+
+		auto predicate = predicates.find(command);
+		if (command == "q")
+		{
+			break;
+		}
+		else if (command == "run")
+		{
+			unsigned frames = a.empty() ? 1 : std::atoi(a.c_str());
+			run(frames);
+			unsigned faults = static_cast<unsigned>(std::count(faulted.begin(), faulted.end(), true));
+			std::printf("ran %u frames in %.1fms", frames, elapsed());
+			if (faults != 0)
+				std::printf(", %u machines stopped on an invalid instruction", faults);
+			std::printf("\n");
+		}
+		else if (command == "new")
+		{
+			search.Start(machines);
+			std::printf("%llu candidates\n", static_cast<unsigned long long>(search.GetCandidateCount()));
+		}
+		else if (predicate != predicates.end())
+		{
+			SearchPredicate type = predicate->second;
+			uint8_t operand = static_cast<uint8_t>(std::strtoul(a.c_str(), nullptr, 16));
+			if (!a.empty() && type == SearchPredicate::Increased)
+				type = SearchPredicate::IncreasedBy;
+			else if (!a.empty() && type == SearchPredicate::Decreased)
+				type = SearchPredicate::DecreasedBy;
+
+			search.Filter(machines, type, operand);
+			std::printf("%llu candidates (%.2fms)\n", static_cast<unsigned long long>(search.GetCandidateCount()), elapsed());
+		}
+		else if (command == "list")
+		{
+			unsigned machine = std::min(static_cast<unsigned>(std::atoi(a.c_str())), machine_count - 1);
+			search.GetCandidates(machine, addresses, 256);
+			std::printf("machine %u: %u candidates\n", machine, search.GetCandidateCount(machine));
+			for (size_t i = 0; i < addresses.size(); ++i)
+			{
+				PrintAddress(addresses[i]);
+				std::printf("= %02X%s", search.GetValue(machine, addresses[i]), i % 8 == 7 || i + 1 == addresses.size() ? "\n" : "   ");
+			}
+		}
+		else if (command == "votes")
+		{
+			unsigned count = a.empty() ? 16 : std::atoi(a.c_str());
+			search.CountVotes(votes);
+
+			std::vector<uint16_t> ranked;
+			for (unsigned address = 0; address < RAM_SEARCH_SIZE; ++address)
+			{
+				if (votes[address] != 0)
+					ranked.push_back(static_cast<uint16_t>(address));
+			}
+
+			std::stable_sort(ranked.begin(), ranked.end(), [&](uint16_t x, uint16_t y) { return votes[x] > votes[y]; });
+			ranked.resize(std::min<size_t>(ranked.size(), count));
+			for (uint16_t address : ranked)
+			{
+				PrintAddress(address);
+				std::printf("in %u of %u machines\n", votes[address], machine_count);
+			}
+		}
+		else
+		{
+			std::printf("Unknown command %s\n", command.c_str());
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,710 @@
+// Static recompiler. Follows the control flow of a ROM from 0x200, translates every reachable block into a C++ function working
+// on a Chip8State and writes a source file that builds into a native runner for that ROM.
+//
+// Usage: Recompiler <rom.ch8> <output.cpp> [quirk profile]
+//
+// Anything that can't be known ahead of time goes back through a dispatcher: BNNN and 00EE jump to computed addresses, and a
+// block whose code has been overwritten (FX33, FX55 or 5XY2 writing new values over it) is retired. Any PC without a valid
+// block runs one instruction on the reference interpreter, which works on the same Chip8State.
+//
+// The generated file's main() runs the ROM both recompiled and interpreted and compares the display hashes:
+//   g++ -std=c++20 -O2 -I. rom.cpp Chip8.cpp Display.cpp InputQueue.cpp ReferenceInterpreter.cpp Hash.cpp -o rom
+//   rom [frames] [cycles per frame]
+#include "../Chip8.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Longest run of instructions compiled into one block before handing back to the dispatcher
+	const unsigned MAX_BLOCK_INSTRUCTIONS = 256;
+
+	void Emit(std::string& out, const char* format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		va_list copy;
+		va_copy(copy, args);
+		int length = std::vsnprintf(nullptr, 0, format, copy);
+		va_end(copy);
+
+		size_t start = out.size();
+		out.resize(start + length + 1);
+		std::vsnprintf(out.data() + start, length + 1, format, args);
+		out.resize(start + length);
+		va_end(args);
+	}
+
+	class Recompiler
+	{
+	public:
+		Recompiler(const Chip8& chip8, unsigned rom_size)
+			: m_Memory(chip8.GetMemory()), m_Profile(chip8.GetQuirkProfile()), m_Quirks(GetQuirkFlags(chip8.GetQuirkProfile())),
+			m_RomEnd(ROM_START_ADDRESS + rom_size) {}
+
+		// Find every block entry point reachable from 0x200
+		void Analyse();
+
+		std::string Generate() const;
+
+		inline size_t GetBlockCount() const { return m_Entries.size(); }
+		inline size_t GetInstructionCount() const { return m_Reachable.size(); }
+
+	private:
+		enum class Flow
+		{
+			// Carries on to the next instruction
+			Next,
+
+			// Always leaves the block (jump, call, return, computed jump, halt)
+			End,
+
+			// The opcode isn't valid for the profile. It is left to the interpreter, which throws
+			Invalid
+		};
+
+		struct Successors
+		{
+			Flow Kind = Flow::Next;
+
+			// Size of the instruction (4 for F000 NNNN)
+			unsigned Length = 2;
+
+			// Other addresses control can reach, each needs a block
+			std::vector<uint16_t> Targets;
+		};
+
+		inline bool InRom(unsigned address) const { return address >= ROM_START_ADDRESS && address + 1 < m_RomEnd; }
+		inline uint16_t Fetch(unsigned address) const { return m_Memory.ReadWord(static_cast<uint16_t>(address)); }
+
+		Successors Decode(uint16_t address) const;
+
+		// Where a skip at address goes when it skips
+		uint16_t SkipTarget(uint16_t address) const;
+
+		// Append the C++ for one instruction
+		void EmitInstruction(std::string& out, uint16_t address, uint16_t opcode) const;
+
+		const Memory& m_Memory;
+		QuirkProfile m_Profile;
+		QuirkFlags m_Quirks;
+		unsigned m_RomEnd;
+
+		std::set<uint16_t> m_Entries;
+		std::set<uint16_t> m_Reachable;
+	};
+
+	uint16_t Recompiler::SkipTarget(uint16_t address) const
+	{
+		uint16_t next = address + 2;
+		if (m_Quirks.XoChipInstructions && next + 1u < MEMORY_SIZE && Fetch(next) == 0xF000)
+		{
+			return next + 4;
+		}
+
+		return next + 2;
+	}
+
+	Recompiler::Successors Recompiler::Decode(uint16_t address) const
+	{
+		const uint16_t opcode = Fetch(address);
+		const unsigned x = (opcode >> 8) & 0xF;
+		const unsigned n = opcode & 0xF;
+		const uint8_t nn = opcode & 0xFF;
+		const uint16_t nnn = opcode & 0xFFF;
+
+		Successors result;
+		auto invalid = [&]() { result.Kind = Flow::Invalid; };
+
+		switch (opcode >> 12)
+		{
+			case 0x0:
+				if (opcode == 0x00EE)
+					result.Kind = Flow::End;
+				else if (m_Quirks.SuperChipInstructions && opcode == 0x00FD)
+				{
+					// Halting stays on this instruction
+					result.Kind = Flow::End;
+					result.Targets.push_back(address);
+				}
+				break;
+
+			case 0x1:
+				result.Kind = Flow::End;
+				result.Targets.push_back(nnn);
+				break;
+
+			case 0x2:
+				// The return lands after the call
+				result.Kind = Flow::End;
+				result.Targets.push_back(nnn);
+				result.Targets.push_back(address + 2);
+				break;
+
+			case 0x3:
+			case 0x4:
+			case 0x9:
+				result.Targets.push_back(SkipTarget(address));
+				if ((opcode >> 12) == 0x9 && n != 0)
+					invalid();
+				break;
+
+			case 0x5:
+				if (n == 0x0)
+					result.Targets.push_back(SkipTarget(address));
+				else if (!(m_Quirks.XoChipInstructions && (n == 0x2 || n == 0x3)))
+					invalid();
+				break;
+
+			case 0x8:
+				if (n > 0x7 && n != 0xE)
+					invalid();
+				break;
+
+			case 0xB:
+				result.Kind = Flow::End;
+				break;
+
+			case 0xD:
+				// Waiting for the vertical blank stays on this instruction
+				if (m_Quirks.DisplayWait)
+					result.Targets.push_back(address);
+				break;
+
+			case 0xE:
+				if (nn == 0x9E || nn == 0xA1)
+					result.Targets.push_back(SkipTarget(address));
+				else
+					invalid();
+				break;
+
+			case 0xF:
+				switch (nn)
+				{
+					case 0x00:
+						if (m_Quirks.XoChipInstructions && x == 0)
+							result.Length = 4;
+						else
+							invalid();
+						break;
+
+					case 0x01:
+					case 0x3A:
+						if (!m_Quirks.XoChipInstructions)
+							invalid();
+						break;
+
+					case 0x02:
+						if (!m_Quirks.XoChipInstructions || x != 0)
+							invalid();
+						break;
+
+					case 0x0A:
+						// Waiting for a key stays on this instruction
+						result.Targets.push_back(address);
+						break;
+
+					case 0x30:
+					case 0x75:
+					case 0x85:
+						if (!m_Quirks.SuperChipInstructions)
+							invalid();
+						break;
+
+					case 0x07: case 0x15: case 0x18: case 0x1E: case 0x29: case 0x33: case 0x55: case 0x65:
+						break;
+
+					default:
+						invalid();
+				}
+				break;
+		}
+
+		return result;
+	}
+
+	void Recompiler::Analyse()
+	{
+		std::vector<uint16_t> work = { static_cast<uint16_t>(ROM_START_ADDRESS) };
+		m_Entries.insert(ROM_START_ADDRESS);
+
+		while (!work.empty())
+		{
+			uint16_t address = work.back();
+			work.pop_back();
+
+			// Follow straight line code until it leaves
+			while (InRom(address) && m_Reachable.insert(address).second)
+			{
+				Successors successors = Decode(address);
+				for (uint16_t target : successors.Targets)
+				{
+					if (InRom(target) && m_Entries.insert(target).second)
+					{
+						work.push_back(target);
+					}
+				}
+
+				if (successors.Kind != Flow::Next)
+				{
+					break;
+				}
+
+				address += successors.Length;
+			}
+		}
+	}
+
+	void Recompiler::EmitInstruction(std::string& out, uint16_t pc, uint16_t opcode) const
+	{
+		const unsigned x = (opcode >> 8) & 0xF;
+		const unsigned y = (opcode >> 4) & 0xF;
+		const unsigned n = opcode & 0xF;
+		const unsigned nn = opcode & 0xFF;
+		const unsigned nnn = opcode & 0xFFF;
+		const uint16_t next = pc + 2;
+
+		auto skip_if = [&](const char* condition)
+		{
+			Emit(out, "\tif (%s) { s.ProgramCounter = 0x%04X; return; }\n", condition, SkipTarget(pc));
+		};
+
+		char condition[64];
+		switch (opcode >> 12)
+		{
+			case 0x0:
+				if (opcode == 0x00E0)
+					Emit(out, "\ts.VideoBuffer.Clear();\n");
+				else if (opcode == 0x00EE)
+					Emit(out, "\ts.StackPointer = (s.StackPointer - 1) & (STACK_LEVELS - 1);\n\ts.ProgramCounter = s.Stack[s.StackPointer];\n\treturn;\n");
+				else if (m_Quirks.SuperChipInstructions && (opcode & 0xFFF0) == 0x00C0)
+					Emit(out, "\ts.VideoBuffer.ScrollDown(%u);\n", n);
+				else if (m_Quirks.XoChipInstructions && (opcode & 0xFFF0) == 0x00D0)
+					Emit(out, "\ts.VideoBuffer.ScrollUp(%u);\n", n);
+				else if (m_Quirks.SuperChipInstructions && opcode == 0x00FB)
+					Emit(out, "\ts.VideoBuffer.ScrollRight4();\n");
+				else if (m_Quirks.SuperChipInstructions && opcode == 0x00FC)
+					Emit(out, "\ts.VideoBuffer.ScrollLeft4();\n");
+				else if (m_Quirks.SuperChipInstructions && opcode == 0x00FD)
+					Emit(out, "\ts.Halted = true;\n\ts.ProgramCounter = 0x%04X;\n\treturn;\n", pc);
+				else if (m_Quirks.SuperChipInstructions && (opcode == 0x00FE || opcode == 0x00FF))
+					Emit(out, "\ts.VideoBuffer.SetHighResolution(%s);\n", opcode == 0x00FF ? "true" : "false");
+				else
+					Emit(out, "\t// Machine code call, ignored\n");
+				break;
+
+			case 0x1:
+				if (nnn == pc)
+				{
+					// Jumping to itself changes nothing but the cycle count, so spend the rest of the budget at once
+					Emit(out, "\ts.CycleCount = end;\n");
+				}
+				Emit(out, "\ts.ProgramCounter = 0x%04X;\n\treturn;\n", nnn);
+				break;
+
+			case 0x2:
+				Emit(out, "\ts.Stack[s.StackPointer] = 0x%04X;\n\ts.StackPointer = (s.StackPointer + 1) & (STACK_LEVELS - 1);\n", next);
+				Emit(out, "\ts.ProgramCounter = 0x%04X;\n\treturn;\n", nnn);
+				break;
+
+			case 0x3:
+				std::snprintf(condition, sizeof(condition), "v[0x%X] == 0x%02X", x, nn);
+				skip_if(condition);
+				break;
+
+			case 0x4:
+				std::snprintf(condition, sizeof(condition), "v[0x%X] != 0x%02X", x, nn);
+				skip_if(condition);
+				break;
+
+			case 0x5:
+				if (n == 0x0)
+				{
+					std::snprintf(condition, sizeof(condition), "v[0x%X] == v[0x%X]", x, y);
+					skip_if(condition);
+				}
+				else
+				{
+					int step = x <= y ? 1 : -1;
+					unsigned count = (x <= y ? y - x : x - y) + 1;
+					for (unsigned offset = 0; offset < count; ++offset)
+					{
+						unsigned reg = x + step * static_cast<int>(offset);
+						if (n == 0x2)
+							Emit(out, "\tm[(s.IndexRegister + %u) & 0xFFFF] = v[0x%X];\n", offset, reg);
+						else
+							Emit(out, "\tv[0x%X] = m[(s.IndexRegister + %u) & 0xFFFF];\n", reg, offset);
+					}
+
+					if (n == 0x2)
+						Emit(out, "\tif (CheckWrite(s, s.IndexRegister, %u)) { s.ProgramCounter = 0x%04X; return; }\n", count, next);
+				}
+				break;
+
+			case 0x6:
+				Emit(out, "\tv[0x%X] = 0x%02X;\n", x, nn);
+				break;
+
+			case 0x7:
+				Emit(out, "\tv[0x%X] = static_cast<uint8_t>(v[0x%X] + 0x%02X);\n", x, x, nn);
+				break;
+
+			case 0x8:
+			{
+				const char* reset_vf = m_Quirks.ResetVF ? " v[0xF] = 0;" : "";
+				const unsigned source = m_Quirks.ShiftUsesVY ? y : x;
+				switch (n)
+				{
+					case 0x0: Emit(out, "\tv[0x%X] = v[0x%X];\n", x, y); break;
+					case 0x1: Emit(out, "\tv[0x%X] |= v[0x%X];%s\n", x, y, reset_vf); break;
+					case 0x2: Emit(out, "\tv[0x%X] &= v[0x%X];%s\n", x, y, reset_vf); break;
+					case 0x3: Emit(out, "\tv[0x%X] ^= v[0x%X];%s\n", x, y, reset_vf); break;
+					case 0x4: Emit(out, "\t{ unsigned sum = v[0x%X] + v[0x%X]; v[0x%X] = static_cast<uint8_t>(sum); v[0xF] = sum > 0xFF; }\n", x, y, x); break;
+					case 0x5: Emit(out, "\t{ uint8_t flag = v[0x%X] >= v[0x%X]; v[0x%X] = static_cast<uint8_t>(v[0x%X] - v[0x%X]); v[0xF] = flag; }\n", x, y, x, x, y); break;
+					case 0x6: Emit(out, "\t{ uint8_t value = v[0x%X]; v[0x%X] = value >> 1; v[0xF] = value & 1; }\n", source, x); break;
+					case 0x7: Emit(out, "\t{ uint8_t flag = v[0x%X] >= v[0x%X]; v[0x%X] = static_cast<uint8_t>(v[0x%X] - v[0x%X]); v[0xF] = flag; }\n", y, x, x, y, x); break;
+					case 0xE: Emit(out, "\t{ uint8_t value = v[0x%X]; v[0x%X] = static_cast<uint8_t>(value << 1); v[0xF] = value >> 7; }\n", source, x); break;
+				}
+				break;
+			}
+
+			case 0x9:
+				std::snprintf(condition, sizeof(condition), "v[0x%X] != v[0x%X]", x, y);
+				skip_if(condition);
+				break;
+
+			case 0xA:
+				Emit(out, "\ts.IndexRegister = 0x%03X;\n", nnn);
+				break;
+
+			case 0xB:
+				// Computed jump, back to the dispatcher
+				if (m_Quirks.JumpUsesVX)
+					Emit(out, "\ts.ProgramCounter = static_cast<uint16_t>(0x%03X + v[0x%X]);\n\treturn;\n", nnn, x);
+				else
+					Emit(out, "\ts.ProgramCounter = static_cast<uint16_t>(0x%03X + v[0x0]);\n\treturn;\n", nnn);
+				break;
+
+			case 0xC:
+				Emit(out, "\tv[0x%X] = NextRandom(s.RandomState) & 0x%02X;\n", x, nn);
+				break;
+
+			case 0xD:
+			{
+				bool wide = m_Quirks.SuperChipInstructions && n == 0;
+				if (m_Quirks.DisplayWait)
+				{
+					Emit(out, "\tif (!s.VBlank) { s.ProgramCounter = 0x%04X; return; }\n\ts.VBlank = false;\n", pc);
+				}
+				Emit(out, "\tv[0xF] = s.VideoBuffer.DrawSprite<%s>(v[0x%X], v[0x%X], &m[s.IndexRegister], %u, %s) ? 1 : 0;\n",
+					m_Quirks.ClipSprites ? "true" : "false", x, y, wide ? 16 : n, wide ? "true" : "false");
+				break;
+			}
+
+			case 0xE:
+				std::snprintf(condition, sizeof(condition), "%s(s.Keypad & (1u << (v[0x%X] & 0xF)))", nn == 0x9E ? "" : "!", x);
+				skip_if(condition);
+				break;
+
+			case 0xF:
+				switch (nn)
+				{
+					case 0x00:
+						Emit(out, "\ts.IndexRegister = 0x%04X;\n", Fetch(pc + 2));
+						break;
+
+					case 0x01:
+						Emit(out, "\ts.VideoBuffer.SelectPlanes(%u);\n", x);
+						break;
+
+					case 0x02:
+						Emit(out, "\tfor (unsigned i = 0; i < AUDIO_PATTERN_SIZE; ++i) s.AudioPattern[i] = m[(s.IndexRegister + i) & 0xFFFF];\n");
+						break;
+
+					case 0x07:
+						Emit(out, "\tv[0x%X] = s.DelayTimer;\n", x);
+						break;
+
+					case 0x0A:
+						Emit(out, "\t{\n\t\tuint16_t released = s.KeyWaitMask & ~s.Keypad;\n\t\ts.KeyWaitMask |= s.Keypad;\n");
+						Emit(out, "\t\tif (released == 0) { s.ProgramCounter = 0x%04X; return; }\n", pc);
+						Emit(out, "\t\tv[0x%X] = static_cast<uint8_t>(std::countr_zero(released));\n\t\ts.KeyWaitMask = 0;\n\t}\n", x);
+						break;
+
+					case 0x15:
+						Emit(out, "\ts.DelayTimer = v[0x%X];\n", x);
+						break;
+
+					case 0x18:
+						Emit(out, "\ts.SoundTimer = v[0x%X];\n", x);
+						break;
+
+					case 0x1E:
+						Emit(out, "\ts.IndexRegister = static_cast<uint16_t>(s.IndexRegister + v[0x%X]);\n", x);
+						break;
+
+					case 0x29:
+						Emit(out, "\ts.IndexRegister = static_cast<uint16_t>(FONTSET_START_ADDRESS + 5 * (v[0x%X] & 0xF));\n", x);
+						break;
+
+					case 0x30:
+						Emit(out, "\ts.IndexRegister = static_cast<uint16_t>(BIG_FONTSET_START_ADDRESS + 10 * (v[0x%X] & 0xF));\n", x);
+						break;
+
+					case 0x33:
+						Emit(out, "\tm[s.IndexRegister] = v[0x%X] / 100;\n\tm[(s.IndexRegister + 1) & 0xFFFF] = v[0x%X] / 10 %% 10;\n\tm[(s.IndexRegister + 2) & 0xFFFF] = v[0x%X] %% 10;\n", x, x, x);
+						Emit(out, "\tif (CheckWrite(s, s.IndexRegister, 3)) { s.ProgramCounter = 0x%04X; return; }\n", next);
+						break;
+
+					case 0x3A:
+						Emit(out, "\ts.Pitch = v[0x%X];\n", x);
+						break;
+
+					case 0x55:
+					case 0x65:
+						for (unsigned i = 0; i <= x; ++i)
+						{
+							if (nn == 0x55)
+								Emit(out, "\tm[(s.IndexRegister + %u) & 0xFFFF] = v[0x%X];\n", i, i);
+							else
+								Emit(out, "\tv[0x%X] = m[(s.IndexRegister + %u) & 0xFFFF];\n", i, i);
+						}
+
+						if (nn == 0x55)
+						{
+							// Checked before I moves, against the range just written
+							Emit(out, "\t{\n\t\tbool modified = CheckWrite(s, s.IndexRegister, %u);\n", x + 1);
+							if (m_Quirks.IncrementIndex)
+								Emit(out, "\t\ts.IndexRegister = static_cast<uint16_t>(s.IndexRegister + %u);\n", x + 1);
+							Emit(out, "\t\tif (modified) { s.ProgramCounter = 0x%04X; return; }\n\t}\n", next);
+						}
+						else if (m_Quirks.IncrementIndex)
+						{
+							Emit(out, "\ts.IndexRegister = static_cast<uint16_t>(s.IndexRegister + %u);\n", x + 1);
+						}
+						break;
+
+					case 0x75:
+						Emit(out, "\tfor (unsigned i = 0; i <= 0x%X; ++i) s.RplFlags[i] = v[i];\n", x);
+						break;
+
+					case 0x85:
+						Emit(out, "\tfor (unsigned i = 0; i <= 0x%X; ++i) v[i] = s.RplFlags[i];\n", x);
+						break;
+				}
+				break;
+		}
+	}
+
+	std::string Recompiler::Generate() const
+	{
+		std::string out;
+		const unsigned rom_size = m_RomEnd - ROM_START_ADDRESS;
+
+		Emit(out, "// Generated by Recompiler. Do not edit\n");
+		Emit(out, "#include \"Chip8.h\"\n#include \"Chip8State.h\"\n#include \"ReferenceInterpreter.h\"\n");
+		Emit(out, "#include <bit>\n#include <chrono>\n#include <cstdio>\n#include <cstdlib>\n#include <memory>\n#include <stdexcept>\n\n");
+		Emit(out, "namespace\n{\n");
+		Emit(out, "const QuirkProfile PROFILE = static_cast<QuirkProfile>(%u);\n", static_cast<unsigned>(m_Profile));
+		Emit(out, "const unsigned ROM_SIZE = %u;\n", rom_size);
+		Emit(out, "const unsigned BLOCK_COUNT = %zu;\n\n", m_Entries.size());
+
+		// The ROM, used to load the machine and to tell whether a write changed compiled code
+		Emit(out, "const uint8_t rom[ROM_SIZE] =\n{");
+		for (unsigned i = 0; i < rom_size; ++i)
+		{
+			Emit(out, "%s0x%02X,", i % 16 == 0 ? "\n\t" : " ", m_Memory[ROM_START_ADDRESS + i]);
+		}
+		Emit(out, "\n};\n\n");
+
+		// Which ROM bytes were compiled, and the range each block covers
+		std::vector<uint8_t> code(rom_size, 0);
+		std::vector<std::pair<uint16_t, uint16_t>> ranges;
+		std::string blocks;
+
+		for (uint16_t entry : m_Entries)
+		{
+			uint16_t pc = entry;
+			Emit(blocks, "// Block %04X\nvoid Block_%04X(Chip8State& s, uint64_t end)\n{\n\tauto& v = s.Registers;\n\tauto& m = s.Memory;\n\t(void)v; (void)m;\n\n", entry, entry);
+
+			for (unsigned count = 0; ; ++count)
+			{
+				// Chain through the dispatcher into other blocks and anything not compiled
+				if ((count > 0 && m_Entries.count(pc)) || !InRom(pc) || count == MAX_BLOCK_INSTRUCTIONS)
+				{
+					Emit(blocks, "\ts.ProgramCounter = 0x%04X;\n", pc);
+					break;
+				}
+
+				Successors successors = Decode(pc);
+				if (successors.Kind == Flow::Invalid)
+				{
+					Emit(blocks, "\t// %04X: %04X is not valid for this profile, the interpreter throws\n\ts.ProgramCounter = 0x%04X;\n", pc, Fetch(pc), pc);
+					break;
+				}
+
+				uint16_t opcode = Fetch(pc);
+				Emit(blocks, "\t// %04X: %04X\n\tif (s.CycleCount == end) { s.ProgramCounter = 0x%04X; return; }\n\t++s.CycleCount;\n", pc, opcode, pc);
+				EmitInstruction(blocks, pc, opcode);
+
+				for (unsigned i = 0; i < successors.Length && pc + i < m_RomEnd; ++i)
+				{
+					code[pc + i - ROM_START_ADDRESS] = 1;
+				}
+
+				pc += successors.Length;
+				if (successors.Kind == Flow::End)
+				{
+					break;
+				}
+			}
+
+			Emit(blocks, "}\n\n");
+			ranges.push_back({ entry, pc });
+		}
+
+		Emit(out, "const uint8_t code[ROM_SIZE] =\n{");
+		for (unsigned i = 0; i < rom_size; ++i)
+		{
+			Emit(out, "%s%u,", i % 32 == 0 ? "\n\t" : " ", code[i]);
+		}
+		Emit(out, "\n};\n\n");
+
+		Emit(out, "const uint16_t block_ranges[BLOCK_COUNT][2] =\n{\n");
+		for (auto [start, end] : ranges)
+		{
+			Emit(out, "\t{ 0x%04X, 0x%04X },\n", start, end);
+		}
+		Emit(out, "};\n\n");
+
+		Emit(out,
+			"// Blocks whose code has been overwritten\n"
+			"bool retired[BLOCK_COUNT] = {};\n\n"
+			"// Retire every block holding a byte the write changed. Returns true if it touched compiled code\n"
+			"[[maybe_unused]] bool CheckWrite(const Chip8State& s, unsigned address, unsigned size)\n"
+			"{\n"
+			"\tbool modified = false;\n"
+			"\tfor (unsigned i = 0; i < size; ++i)\n"
+			"\t{\n"
+			"\t\tunsigned byte = (address + i) & 0xFFFF;\n"
+			"\t\tif (byte < ROM_START_ADDRESS || byte >= ROM_START_ADDRESS + ROM_SIZE || !code[byte - ROM_START_ADDRESS] || s.Memory[byte] == rom[byte - ROM_START_ADDRESS])\n"
+			"\t\t\tcontinue;\n\n"
+			"\t\tfor (unsigned block = 0; block < BLOCK_COUNT; ++block)\n"
+			"\t\t{\n"
+			"\t\t\tif (byte >= block_ranges[block][0] && byte < block_ranges[block][1])\n"
+			"\t\t\t\tretired[block] = true;\n"
+			"\t\t}\n\n"
+			"\t\tmodified = true;\n"
+			"\t}\n\n"
+			"\treturn modified;\n"
+			"}\n\n");
+
+		out += blocks;
+
+		// Dispatcher
+		Emit(out, "// Run the block for the current PC. Returns false if there isn't a live one\nbool Dispatch(Chip8State& s, uint64_t end)\n{\n\tswitch (s.ProgramCounter)\n\t{\n");
+		unsigned index = 0;
+		for (uint16_t entry : m_Entries)
+		{
+			Emit(out, "\t\tcase 0x%04X: if (retired[%u]) return false; Block_%04X(s, end); return true;\n", entry, index++, entry);
+		}
+		Emit(out, "\t\tdefault: return false;\n\t}\n}\n}\n\n");
+
+		Emit(out,
+			"// Run cycles instructions, the same as calling Chip8::Cycle that many times\n"
+			"void RunRecompiled(Chip8State& s, uint64_t cycles)\n"
+			"{\n"
+			"\tuint64_t end = s.CycleCount + cycles;\n"
+			"\twhile (s.CycleCount < end)\n"
+			"\t{\n"
+			"\t\tif (Dispatch(s, end))\n"
+			"\t\t\tcontinue;\n\n"
+			"\t\tswitch (ReferenceCycle(s))\n"
+			"\t\t{\n"
+			"\t\t\tcase ReferenceResult::InvalidInstruction: throw std::runtime_error(\"Invalid instruction\");\n"
+			"\t\t\tcase ReferenceResult::MemoryFault: throw std::runtime_error(\"Memory access out of range\");\n"
+			"\t\t\tdefault: break;\n"
+			"\t\t}\n"
+			"\t}\n"
+			"}\n\n");
+
+		Emit(out,
+			"#ifndef RECOMPILED_NO_MAIN\n"
+			"int main(int argc, char** argv)\n"
+			"{\n"
+			"\tunsigned frames = argc > 1 ? std::atoi(argv[1]) : 600;\n"
+			"\tunsigned cycles_per_frame = argc > 2 ? std::atoi(argv[2]) : 11;\n\n"
+			"\tChip8 chip8(PROFILE);\n"
+			"\tchip8.LoadROM(std::span<const uint8_t>(rom, ROM_SIZE));\n"
+			"\tauto state = std::make_unique<Chip8State>();\n"
+			"\tchip8.SaveState(*state);\n\n"
+			"\tauto start = std::chrono::steady_clock::now();\n"
+			"\ttry\n\t{\n"
+			"\t\tfor (unsigned frame = 0; frame < frames; ++frame)\n\t\t{\n"
+			"\t\t\tRunRecompiled(*state, cycles_per_frame);\n"
+			"\t\t\tReferenceUpdateTimers(*state);\n"
+			"\t\t}\n\t}\n"
+			"\tcatch (const std::exception& e)\n\t{\n\t\tstd::fprintf(stderr, \"Recompiled: %%s\\n\", e.what());\n\t}\n"
+			"\tdouble recompiled = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();\n\n"
+			"\tstart = std::chrono::steady_clock::now();\n"
+			"\ttry\n\t{\n"
+			"\t\tfor (unsigned frame = 0; frame < frames; ++frame)\n\t\t{\n"
+			"\t\t\tfor (unsigned i = 0; i < cycles_per_frame; ++i)\n\t\t\t\tchip8.Cycle();\n"
+			"\t\t\tchip8.UpdateTimers();\n"
+			"\t\t}\n\t}\n"
+			"\tcatch (const std::exception& e)\n\t{\n\t\tstd::fprintf(stderr, \"Interpreted: %%s\\n\", e.what());\n\t}\n"
+			"\tdouble interpreted = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();\n\n"
+			"\tuint64_t expected = chip8.VideoBuffer.GetHash();\n"
+			"\tuint64_t actual = state->VideoBuffer.GetHash();\n"
+			"\tstd::printf(\"recompiled %%016llX %%.3fs, interpreted %%016llX %%.3fs: %%s\\n\", static_cast<unsigned long long>(actual), recompiled,\n"
+			"\t\tstatic_cast<unsigned long long>(expected), interpreted, actual == expected ? \"match\" : \"MISMATCH\");\n"
+			"\treturn actual == expected ? 0 : 1;\n"
+			"}\n"
+			"#endif\n");
+
+		return out;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::fprintf(stderr, "Usage: %s <rom.ch8> <output.cpp> [quirk profile]\n", argv[0]);
+		return -1;
+	}
+
+	QuirkProfile profile = argc > 3 ? static_cast<QuirkProfile>(std::atoi(argv[3])) : QuirkProfile::Chip8;
+
+	std::ifstream file(argv[1], std::ios::binary);
+	std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	// Load it the same way the emulator does so fonts and the profile's memory size match
+	auto chip8 = std::make_unique<Chip8>(profile);
+	if (!chip8->LoadROM(std::span<const uint8_t>(rom)))
+	{
+		std::fprintf(stderr, "Can't load %s\n", argv[1]);
+		return -1;
+	}
+
+	Recompiler recompiler(*chip8, static_cast<unsigned>(rom.size()));
+	recompiler.Analyse();
+
+	std::ofstream out(argv[2], std::ios::binary);
+	out << recompiler.Generate();
+	if (!out)
+	{
+		std::fprintf(stderr, "Can't write %s\n", argv[2]);
+		return -1;
+	}
+
+	std::printf("%zu instructions in %zu blocks\n", recompiler.GetInstructionCount(), recompiler.GetBlockCount());
+	return 0;
+}
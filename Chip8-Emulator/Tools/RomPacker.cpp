@@ -0,0 +1,63 @@
+// Builds a ROM pack from individual .ch8 files
+//
+// Usage: RomPacker <output.c8pk> [--quirks <profile>] [--hz <clock>] <rom.ch8>...
+// --quirks and --hz apply to every ROM listed after them
+#include "../RomPack.h"
+#include "../Hash.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::fprintf(stderr, "Usage: %s <output.c8pk> [--quirks <profile>] [--hz <clock>] <rom.ch8>...\n", argv[0]);
+		return -1;
+	}
+
+	std::vector<RomPackInput> roms;
+	uint32_t clock_hz = 0;
+	uint8_t quirk_profile = 0;
+
+	for (int i = 2; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--hz") == 0 && i + 1 < argc)
+		{
+			clock_hz = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			continue;
+		}
+
+		if (std::strcmp(argv[i], "--quirks") == 0 && i + 1 < argc)
+		{
+			quirk_profile = static_cast<uint8_t>(std::strtoul(argv[++i], nullptr, 10));
+			continue;
+		}
+
+		std::ifstream file(argv[i], std::fstream::in | std::fstream::binary);
+		if (!file)
+		{
+			std::fprintf(stderr, "Can't open %s\n", argv[i]);
+			return -1;
+		}
+
+		RomPackInput rom;
+		rom.Data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		rom.ClockHz = clock_hz;
+		rom.Profile = quirk_profile;
+
+		std::printf("%016llx %6zu bytes %s\n", static_cast<unsigned long long>(XXHash64(rom.Data.data(), rom.Data.size())), rom.Data.size(), argv[i]);
+		roms.push_back(std::move(rom));
+	}
+
+	if (!WriteRomPack(argv[1], roms))
+	{
+		std::fprintf(stderr, "Failed to write %s\n", argv[1]);
+		return -1;
+	}
+
+	return 0;
+}
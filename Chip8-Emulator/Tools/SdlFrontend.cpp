@@ -0,0 +1,378 @@
+// Plays a ROM in an SDL2 window with the software renderer, for Linux desktops and machines without a GPU (it runs under
+// Xvfb, or with SDL_VIDEODRIVER=dummy and no display at all).
+//
+// Usage: SdlFrontend <rom.ch8> [cpu Hz] [quirk profile] [scale] [frames] [--latency]
+//
+// The CPU runs at the given rate and the timers at 60Hz whatever the display's refresh rate. Frames are presented at the
+// refresh rate, and FramePacer sleeps between them rather than spinning. Tab toggles the stats overlay, Esc quits. With a
+// frame count it stops by itself after that many frames. Either way it prints the frame time statistics and the latency
+// report (see LatencyProbe) when it exits. Input latency is only measured with --latency
+#include "../AudioRing.h"
+#include "../AudioSynth.h"
+#include "../Chip8.h"
+#include "../FramePacer.h"
+#include "../InputQueue.h"
+#include "../LatencyProbe.h"
+#include <SDL.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Timers tick at this rate however often frames are presented
+	const double TIMER_RATE = 60.0;
+
+	// Longest catch-up after a stall, in timer ticks. Beyond it the emulation just runs slow for a moment
+	const unsigned MAX_CATCH_UP_TICKS = 4;
+
+	// Keyboard layout, keypad key to scan code, as in Main.cpp
+	const SDL_Scancode keys[KEY_COUNT] = {
+		SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
+		SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
+		SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
+		SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V
+	};
+
+	// 3x5 glyphs for the overlay, rows top to bottom, three bits each with the leftmost pixel highest
+	struct Glyph
+	{
+		char Character;
+		uint16_t Rows;
+	};
+
+	constexpr uint16_t MakeGlyph(unsigned r0, unsigned r1, unsigned r2, unsigned r3, unsigned r4)
+	{
+		return static_cast<uint16_t>((r0 << 12) | (r1 << 9) | (r2 << 6) | (r3 << 3) | r4);
+	}
+
+	const Glyph font[] = {
+		{ '0', MakeGlyph(07, 05, 05, 05, 07) }, { '1', MakeGlyph(02, 06, 02, 02, 07) },
+		{ '2', MakeGlyph(07, 01, 07, 04, 07) }, { '3', MakeGlyph(07, 01, 07, 01, 07) },
+		{ '4', MakeGlyph(05, 05, 07, 01, 01) }, { '5', MakeGlyph(07, 04, 07, 01, 07) },
+		{ '6', MakeGlyph(07, 04, 07, 05, 07) }, { '7', MakeGlyph(07, 01, 01, 01, 01) },
+		{ '8', MakeGlyph(07, 05, 07, 05, 07) }, { '9', MakeGlyph(07, 05, 07, 01, 07) },
+		{ '.', MakeGlyph(00, 00, 00, 00, 02) }, { '/', MakeGlyph(01, 01, 02, 04, 04) },
+		{ 'A', MakeGlyph(02, 05, 07, 05, 05) }, { 'D', MakeGlyph(06, 05, 05, 05, 06) },
+		{ 'E', MakeGlyph(07, 04, 06, 04, 07) }, { 'F', MakeGlyph(07, 04, 06, 04, 04) },
+		{ 'H', MakeGlyph(05, 05, 07, 05, 05) }, { 'I', MakeGlyph(07, 02, 02, 02, 07) },
+		{ 'K', MakeGlyph(05, 05, 06, 05, 05) }, { 'M', MakeGlyph(05, 07, 07, 05, 05) },
+		{ 'O', MakeGlyph(02, 05, 05, 05, 02) }, { 'P', MakeGlyph(06, 05, 06, 04, 04) },
+		{ 'R', MakeGlyph(06, 05, 06, 05, 05) }, { 'S', MakeGlyph(03, 04, 02, 01, 06) },
+		{ 'W', MakeGlyph(05, 05, 07, 07, 05) }, { 'X', MakeGlyph(05, 05, 02, 05, 05) },
+		{ 'Z', MakeGlyph(07, 01, 02, 04, 07) },
+	};
+
+	// Rectangles for the lit pixels of a line of overlay text. Characters without a glyph are blank
+	void AddText(std::vector<SDL_Rect>& rects, const char* text, int x, int y, int scale)
+	{
+		for (; *text != '\0'; ++text, x += 4 * scale)
+		{
+			const Glyph* glyph = std::find_if(std::begin(font), std::end(font), [&](const Glyph& g) { return g.Character == *text; });
+			if (glyph == std::end(font))
+			{
+				continue;
+			}
+
+			for (int row = 0; row < 5; ++row)
+			{
+				for (int column = 0; column < 3; ++column)
+				{
+					if (glyph->Rows & (1 << ((4 - row) * 3 + (2 - column))))
+					{
+						rects.push_back({ x + column * scale, y + row * scale, scale, scale });
+					}
+				}
+			}
+		}
+	}
+
+	// Frame times and throughput over the last second, for the overlay
+	struct Stats
+	{
+		double Mips = 0.0;
+		double AverageFrameMs = 0.0;
+		double MaxFrameMs = 0.0;
+		double AverageWorkMs = 0.0;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	// --latency anywhere measures input latency through LatencyProbe, the other arguments are positional. Without it
+	// instructions run through Chip8::Run and only the frame phases are timed
+	bool measure_latency = false;
+	std::vector<char*> args;
+	for (int i = 0; i < argc; ++i)
+	{
+		if (std::string(argv[i]) == "--latency")
+			measure_latency = true;
+		else
+			args.push_back(argv[i]);
+	}
+
+	argc = static_cast<int>(args.size());
+	argv = args.data();
+
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s <rom.ch8> [cpu Hz] [quirk profile] [scale] [frames] [--latency]\n", argv[0]);
+		return -1;
+	}
+
+	double cpu_rate = argc > 2 ? std::atof(argv[2]) : 660.0;
+	QuirkProfile profile = argc > 3 ? static_cast<QuirkProfile>(std::atoi(argv[3])) : QuirkProfile::Chip8;
+	int scale = argc > 4 ? std::max(1, std::atoi(argv[4])) : 8;
+	unsigned frame_limit = argc > 5 ? std::atoi(argv[5]) : 0;
+
+	// About 70KB, so not on the stack
+	auto chip8 = std::make_unique<Chip8>(profile);
+	if (!chip8->LoadROM(argv[1]))
+	{
+		std::fprintf(stderr, "Can't load %s\n", argv[1]);
+		return -1;
+	}
+
+	if (SDL_Init(SDL_INIT_VIDEO) != 0)
+	{
+		std::fprintf(stderr, "SDL_Init: %s\n", SDL_GetError());
+		return -1;
+	}
+
+	SDL_Window* window = SDL_CreateWindow("Chip8", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+		HIRES_VIDEO_WIDTH * scale, HIRES_VIDEO_HEIGHT * scale, SDL_WINDOW_RESIZABLE);
+	SDL_Renderer* renderer = window ? SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE) : nullptr;
+	SDL_Texture* texture = renderer ? SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, HIRES_VIDEO_WIDTH, HIRES_VIDEO_HEIGHT) : nullptr;
+	if (!texture)
+	{
+		std::fprintf(stderr, "SDL: %s\n", SDL_GetError());
+		SDL_Quit();
+		return -1;
+	}
+
+	// Present at the display's refresh rate. Xvfb and the dummy driver may not report one
+	double refresh_rate = TIMER_RATE;
+	SDL_DisplayMode mode;
+	if (SDL_GetCurrentDisplayMode(std::max(0, SDL_GetWindowDisplayIndex(window)), &mode) == 0 && mode.refresh_rate > 0)
+	{
+		refresh_rate = mode.refresh_rate;
+	}
+
+	// Audio is rendered per timer tick and pulled by SDL's audio thread. Without an audio device the emulator runs silent
+	AudioRing audio_ring;
+	AudioSynth audio_synth;
+	SDL_AudioDeviceID audio_device = 0;
+	if (SDL_InitSubSystem(SDL_INIT_AUDIO) == 0)
+	{
+		SDL_AudioSpec desired = {};
+		desired.freq = static_cast<int>(audio_synth.GetSampleRate());
+		desired.format = AUDIO_S16SYS;
+		desired.channels = 1;
+		desired.samples = 512;
+		desired.userdata = &audio_ring;
+		desired.callback = [](void* userdata, Uint8* stream, int length)
+		{
+			static_cast<AudioRing*>(userdata)->ReadOrSilence(reinterpret_cast<int16_t*>(stream), static_cast<size_t>(length) / sizeof(int16_t));
+		};
+
+		audio_device = SDL_OpenAudioDevice(nullptr, 0, &desired, nullptr, 0);
+		if (audio_device != 0)
+		{
+			SDL_PauseAudioDevice(audio_device, 0);
+		}
+	}
+
+	std::array<int8_t, SDL_NUM_SCANCODES> key_map;
+	key_map.fill(-1);
+	for (unsigned i = 0; i < KEY_COUNT; ++i)
+	{
+		key_map[keys[i]] = static_cast<int8_t>(i);
+	}
+
+	// Inputs are queued and stamped with the cycle they apply on, as in the windowed build
+	InputQueue input;
+	std::array<uint64_t, KEY_COUNT> next_event_cycle = {};
+
+	// The texture is always high resolution, low resolution frames are doubled up
+	std::vector<uint32_t> pixels(HIRES_VIDEO_WIDTH * HIRES_VIDEO_HEIGHT);
+	const int video_pitch = sizeof(pixels[0]) * HIRES_VIDEO_WIDTH;
+
+	FramePacer pacer(refresh_rate);
+	LatencyProbe latency;
+	using Clock = std::chrono::steady_clock;
+
+	// Fractions of a timer tick per presented frame, and of a cycle per timer tick, carry over so the averages come out exact
+	double tick_accumulator = 0.0;
+	double cycle_accumulator = 0.0;
+
+	bool overlay = true;
+	Stats stats;
+	std::vector<SDL_Rect> overlay_rects;
+
+	// Sums since the overlay was last updated, and over the whole run
+	auto window_start = Clock::now();
+	uint64_t window_cycles = chip8->GetCycleCount();
+	unsigned window_frames = 0;
+	double window_frame_ms = 0.0;
+	double window_max_ms = 0.0;
+	double window_work_ms = 0.0;
+	double total_frame_ms = 0.0;
+	double total_max_ms = 0.0;
+
+	auto last_present = Clock::now();
+	uint64_t frame = 0;
+	std::string error;
+	bool quit = false;
+	while (!quit && (frame_limit == 0 || frame < frame_limit))
+	{
+		auto work_start = Clock::now();
+
+		SDL_Event event;
+		while (SDL_PollEvent(&event))
+		{
+			if (event.type == SDL_QUIT)
+			{
+				quit = true;
+			}
+			else if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && !event.key.repeat)
+			{
+				SDL_Scancode scan_code = event.key.keysym.scancode;
+				bool pressed = event.type == SDL_KEYDOWN;
+				if (scan_code == SDL_SCANCODE_ESCAPE)
+				{
+					quit = true;
+				}
+				else if (scan_code == SDL_SCANCODE_TAB && pressed)
+				{
+					overlay = !overlay;
+				}
+				else if (scan_code >= 0 && scan_code < SDL_NUM_SCANCODES && key_map[scan_code] >= 0)
+				{
+					uint8_t key = static_cast<uint8_t>(key_map[scan_code]);
+
+					// Keep events for the same key on distinct cycles so a press and release never cancel out
+					uint64_t cycle = std::max(chip8->GetCycleCount(), next_event_cycle[key]);
+					next_event_cycle[key] = cycle + 1;
+					input.Push({ cycle, key, pressed });
+				}
+			}
+		}
+
+		// Emulate whatever timer ticks are due by now. On a 60Hz display that is one per frame, on 144Hz most frames
+		// have none and just present the same picture again
+		tick_accumulator = std::min(tick_accumulator + TIMER_RATE / refresh_rate, static_cast<double>(MAX_CATCH_UP_TICKS));
+		try
+		{
+			for (; tick_accumulator >= 1.0; tick_accumulator -= 1.0)
+			{
+				cycle_accumulator += cpu_rate / TIMER_RATE;
+				uint32_t cycles = static_cast<uint32_t>(cycle_accumulator);
+				cycle_accumulator -= cycles;
+
+				if (measure_latency)
+					latency.Run(*chip8, cycles, input);
+				else
+					chip8->Run(cycles, input);
+				audio_synth.Tick(*chip8, audio_ring);
+				chip8->UpdateTimers();
+			}
+		}
+		catch (const std::exception& e)
+		{
+			error = e.what();
+			break;
+		}
+
+		uint64_t phase_start = LatencyProbe::Now();
+		chip8->VideoBuffer.ToRGBA(pixels.data(), HIRES_VIDEO_WIDTH, HIRES_VIDEO_HEIGHT);
+		phase_start = latency.EndPhase(FramePhase::Build, phase_start);
+		SDL_UpdateTexture(texture, nullptr, pixels.data(), video_pitch);
+		latency.EndPhase(FramePhase::Upload, phase_start);
+		SDL_RenderClear(renderer);
+		SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+
+		if (overlay)
+		{
+			char line[64];
+			const int text_scale = std::max(1, scale / 4);
+			const int line_height = 6 * text_scale;
+
+			overlay_rects.clear();
+			std::snprintf(line, sizeof(line), "%.4f MIPS %.0f HZ", stats.Mips, cpu_rate);
+			AddText(overlay_rects, line, text_scale, text_scale, text_scale);
+			std::snprintf(line, sizeof(line), "FRAME %.2f MS MAX %.2f", stats.AverageFrameMs, stats.MaxFrameMs);
+			AddText(overlay_rects, line, text_scale, text_scale + line_height, text_scale);
+			std::snprintf(line, sizeof(line), "WORK %.2f MS DROPPED %llu", stats.AverageWorkMs, static_cast<unsigned long long>(pacer.GetDroppedFrames()));
+			AddText(overlay_rects, line, text_scale, text_scale + line_height * 2, text_scale);
+
+			SDL_Rect backdrop = { 0, 0, 32 * 4 * text_scale, text_scale + line_height * 3 };
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+			SDL_RenderFillRect(renderer, &backdrop);
+			SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+			SDL_RenderFillRects(renderer, overlay_rects.data(), static_cast<int>(overlay_rects.size()));
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+		}
+
+		window_work_ms += std::chrono::duration<double, std::milli>(Clock::now() - work_start).count();
+
+		// Sleep out the rest of the frame. Dropped frames still move the emulation on so it keeps to real time
+		tick_accumulator += pacer.Wait() * TIMER_RATE / refresh_rate;
+		phase_start = LatencyProbe::Now();
+		SDL_RenderPresent(renderer);
+		latency.EndPhase(FramePhase::Present, phase_start);
+		latency.OnPresent();
+
+		auto now = Clock::now();
+		double frame_ms = std::chrono::duration<double, std::milli>(now - last_present).count();
+		last_present = now;
+		++frame;
+		++window_frames;
+		window_frame_ms += frame_ms;
+		window_max_ms = std::max(window_max_ms, frame_ms);
+		total_frame_ms += frame_ms;
+		total_max_ms = std::max(total_max_ms, frame_ms);
+
+		double window_seconds = std::chrono::duration<double>(now - window_start).count();
+		if (window_seconds >= 1.0)
+		{
+			stats.Mips = (chip8->GetCycleCount() - window_cycles) / window_seconds / 1e6;
+			stats.AverageFrameMs = window_frame_ms / window_frames;
+			stats.MaxFrameMs = window_max_ms;
+			stats.AverageWorkMs = window_work_ms / window_frames;
+
+			window_start = now;
+			window_cycles = chip8->GetCycleCount();
+			window_frames = 0;
+			window_frame_ms = 0.0;
+			window_max_ms = 0.0;
+			window_work_ms = 0.0;
+		}
+	}
+
+	if (audio_device != 0)
+	{
+		SDL_CloseAudioDevice(audio_device);
+	}
+
+	SDL_DestroyTexture(texture);
+	SDL_DestroyRenderer(renderer);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+
+	if (!error.empty())
+	{
+		std::fprintf(stderr, "%s\n", error.c_str());
+		return -1;
+	}
+
+	std::fprintf(stderr, "%llu frames at %.1fHz, %.2fms average, %.2fms worst, %llu dropped\n", static_cast<unsigned long long>(frame),
+		refresh_rate, frame != 0 ? total_frame_ms / frame : 0.0, total_max_ms, static_cast<unsigned long long>(pacer.GetDroppedFrames()));
+	std::fprintf(stderr, "%s", latency.FormatReport().c_str());
+	return 0;
+}
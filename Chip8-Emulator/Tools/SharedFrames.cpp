@@ -0,0 +1,270 @@
+// Serves and reads the shared frame segment, and measures how long a published frame takes to reach a reader.
+//
+// Usage: SharedFrames serve <name> <rom.ch8> [machines] [frames] [quirk profile]
+//        SharedFrames watch <name> [slot] [frames] [injected keys, hex]
+//        SharedFrames bench [frames] [machines]
+//
+// serve runs machines headless at 60Hz and publishes them, taking keys injected by readers. watch follows one slot from
+// another process, prints the display now and then and the publish to read latency at the end. bench does both in one process
+// through two separate mappings, publishing as fast as the reader keeps up
+#include "../Chip8.h"
+#include "../SharedFramePublisher.h"
+#include "../SharedFrameReader.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const unsigned CYCLES_PER_FRAME = 11;
+
+	// Frames between displays printed by watch
+	const unsigned WATCH_PRINT_INTERVAL = 60;
+
+	int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void PrintLatencies(char const* name, std::vector<int64_t>& latencies)
+	{
+		if (latencies.empty())
+		{
+			std::printf("%s: no samples\n", name);
+			return;
+		}
+
+		std::sort(latencies.begin(), latencies.end());
+		auto percentile = [&](double p) { return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))]; };
+		std::printf("%s: %zu samples, min %lld ns, median %lld ns, p99 %lld ns, p99.9 %lld ns, max %lld ns\n", name, latencies.size(),
+			static_cast<long long>(latencies.front()), static_cast<long long>(percentile(0.5)), static_cast<long long>(percentile(0.99)),
+			static_cast<long long>(percentile(0.999)), static_cast<long long>(latencies.back()));
+	}
+
+	void PrintDisplay(const SharedFrameData& frame)
+	{
+		unsigned width = frame.HighResolution ? 128 : 64;
+		unsigned height = frame.HighResolution ? 64 : 32;
+
+		std::string text;
+		for (unsigned y = 0; y < height; ++y)
+		{
+			for (unsigned x = 0; x < width; ++x)
+			{
+				unsigned color = 0;
+				for (unsigned plane = 0; plane < SHARED_FRAME_PLANES; ++plane)
+				{
+					color |= ((frame.Planes[plane][y][x >> 6] >> (63 - (x & 63))) & 1) << plane;
+				}
+
+				text += " #+*"[color];
+			}
+
+			text += '\n';
+		}
+
+		std::printf("frame %llu, cycle %llu, PC %03X, keypad %04X\n%s", static_cast<unsigned long long>(frame.Frame),
+			static_cast<unsigned long long>(frame.CycleCount), frame.ProgramCounter, frame.Keypad, text.c_str());
+	}
+
+	int Serve(char const* name, char const* rom, unsigned machines, unsigned frames, QuirkProfile profile)
+	{
+		std::vector<std::unique_ptr<Chip8>> chip8s;
+		for (unsigned index = 0; index < machines; ++index)
+		{
+			chip8s.push_back(std::make_unique<Chip8>(profile));
+			chip8s.back()->Seed(index + 1);
+			if (!chip8s.back()->LoadROM(rom))
+			{
+				std::fprintf(stderr, "Can't load %s\n", rom);
+				return -1;
+			}
+		}
+
+		SharedFramePublisher publisher;
+		if (!publisher.Create(name, machines))
+		{
+			std::fprintf(stderr, "Can't create shared memory %s\n", name);
+			return -1;
+		}
+
+		std::printf("Serving %u machines as %s\n", machines, name);
+
+		auto next = std::chrono::steady_clock::now();
+		for (unsigned frame = 0; frame < frames; ++frame)
+		{
+			for (unsigned index = 0; index < machines; ++index)
+			{
+				Chip8& chip8 = *chip8s[index];
+				chip8.Keypad = publisher.GetInjectedKeys(index);
+				for (unsigned cycle = 0; cycle < CYCLES_PER_FRAME; ++cycle)
+				{
+					chip8.Cycle();
+				}
+
+				chip8.UpdateTimers();
+				publisher.Publish(index, chip8);
+			}
+
+			next += std::chrono::microseconds(16667);
+			std::this_thread::sleep_until(next);
+		}
+
+		return 0;
+	}
+
+	int Watch(char const* name, unsigned slot, unsigned frames, uint16_t keys)
+	{
+		SharedFrameReader reader;
+		if (!reader.Open(name) || slot >= reader.GetSlotCount())
+		{
+			std::fprintf(stderr, "No shared frames %s with slot %u\n", name, slot);
+			return -1;
+		}
+
+		reader.SetInjectedKeys(slot, keys);
+
+		auto frame = std::make_unique<SharedFrameData>();
+		std::vector<int64_t> latencies;
+		uint32_t sequence = reader.GetSequence(slot);
+		uint64_t missed = 0;
+		uint64_t last_frame = 0;
+		while (latencies.size() < frames)
+		{
+			if (!reader.WaitForFrame(slot, sequence, std::chrono::seconds(2)))
+			{
+				std::fprintf(stderr, "No frame for 2 seconds\n");
+				break;
+			}
+
+			if (!reader.Read(slot, frame.get(), &sequence))
+			{
+				continue;
+			}
+
+			latencies.push_back(Now() - frame->PublishTime);
+			missed += last_frame != 0 && frame->Frame > last_frame + 1 ? frame->Frame - last_frame - 1 : 0;
+			last_frame = frame->Frame;
+
+			if (latencies.size() % WATCH_PRINT_INTERVAL == 1)
+			{
+				PrintDisplay(*frame);
+			}
+		}
+
+		reader.SetInjectedKeys(slot, 0);
+
+		std::printf("%llu frames missed\n", static_cast<unsigned long long>(missed));
+		PrintLatencies("Publish to read", latencies);
+		return 0;
+	}
+
+	int Bench(unsigned frames, unsigned machines)
+	{
+		const char* name = "Chip8-SharedFrames-Bench";
+
+		auto chip8 = std::make_unique<Chip8>();
+		SharedFramePublisher publisher;
+		SharedFrameReader reader;
+		if (!publisher.Create(name, machines) || !reader.Open(name))
+		{
+			std::fprintf(stderr, "Can't create shared memory %s\n", name);
+			return -1;
+		}
+
+		// Publish each frame once the reader has the previous one, so every sample is one frame's trip
+		std::atomic<uint32_t> received = 0;
+		std::thread writer([&]()
+		{
+			for (unsigned frame = 0; frame < frames; ++frame)
+			{
+				while (received.load(std::memory_order_acquire) != frame)
+				{
+					std::this_thread::yield();
+				}
+
+				chip8->Keypad = static_cast<uint16_t>(frame);
+				publisher.Publish(frame % machines, *chip8);
+			}
+		});
+
+		auto frame = std::make_unique<SharedFrameData>();
+		std::vector<int64_t> latencies;
+		std::vector<int64_t> copies;
+		latencies.reserve(frames);
+		copies.reserve(frames);
+		std::vector<uint32_t> sequences(machines, 0);
+		for (unsigned index = 0; index < frames; ++index)
+		{
+			unsigned slot = index % machines;
+			if (!reader.WaitForFrame(slot, sequences[slot], std::chrono::seconds(2)))
+			{
+				std::fprintf(stderr, "No frame for 2 seconds\n");
+				break;
+			}
+
+			int64_t start = Now();
+			reader.Read(slot, frame.get(), &sequences[slot]);
+			int64_t end = Now();
+
+			latencies.push_back(end - frame->PublishTime);
+			copies.push_back(end - start);
+			received.store(index + 1, std::memory_order_release);
+		}
+
+		writer.join();
+
+		std::printf("%zu byte frames over %u slots\n", sizeof(SharedFrameData), machines);
+		PrintLatencies("Publish to read", latencies);
+		PrintLatencies("Read (copy out)", copies);
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 4 && std::strcmp(argv[1], "serve") == 0)
+	{
+		unsigned machines = argc > 4 ? std::atoi(argv[4]) : 1;
+		unsigned frames = argc > 5 ? std::atoi(argv[5]) : 3600;
+		QuirkProfile profile = argc > 6 ? static_cast<QuirkProfile>(std::atoi(argv[6])) : QuirkProfile::Chip8;
+
+		try
+		{
+			return Serve(argv[2], argv[3], std::max(machines, 1u), frames, profile);
+		}
+		catch (const std::exception& e)
+		{
+			std::fprintf(stderr, "%s\n", e.what());
+			return -1;
+		}
+	}
+
+	if (argc >= 3 && std::strcmp(argv[1], "watch") == 0)
+	{
+		unsigned slot = argc > 3 ? std::atoi(argv[3]) : 0;
+		unsigned frames = argc > 4 ? std::atoi(argv[4]) : 600;
+		uint16_t keys = argc > 5 ? static_cast<uint16_t>(std::strtoul(argv[5], nullptr, 16)) : 0;
+		return Watch(argv[2], slot, frames, keys);
+	}
+
+	if (argc >= 2 && std::strcmp(argv[1], "bench") == 0)
+	{
+		unsigned frames = argc > 2 ? std::atoi(argv[2]) : 100000;
+		unsigned machines = argc > 3 ? std::atoi(argv[3]) : 1;
+		return Bench(frames, std::max(machines, 1u));
+	}
+
+	std::fprintf(stderr, "Usage: %s serve <name> <rom.ch8> [machines] [frames] [quirk profile]\n", argv[0]);
+	std::fprintf(stderr, "       %s watch <name> [slot] [frames] [injected keys, hex]\n", argv[0]);
+	std::fprintf(stderr, "       %s bench [frames] [machines]\n", argv[0]);
+	return -1;
+}
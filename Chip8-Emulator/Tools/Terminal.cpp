@@ -0,0 +1,249 @@
+// Plays a ROM in a terminal, e.g. over SSH on a machine without a display. Two pixels per character cell, and only the
+// cells that changed are redrawn each frame.
+//
+// Usage: Terminal <rom.ch8> [cycles per frame] [quirk profile] [frames] [--latency]
+//
+// Keys are laid out as in the windowed build (1234/QWER/ASDF/ZXCV). A terminal only reports key presses, repeated while
+// held, so a key counts as held until KEY_HOLD_FRAMES pass without a repeat. Esc or Ctrl-C quits. With a frame count it
+// stops by itself after that many frames. On exit it reports the bytes written per frame and the frame times, and with
+// --latency the input latency as well (see LatencyProbe)
+#ifdef _WIN32
+#error The terminal frontend needs a POSIX terminal
+#endif
+
+#include "../Chip8.h"
+#include "../InputQueue.h"
+#include "../LatencyProbe.h"
+#include "../TerminalRenderer.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <termios.h>
+#include <unistd.h>
+
+namespace
+{
+	// Frames a key stays down after its last press or repeat. Terminals repeat every 30-50ms once repeating starts
+	const unsigned KEY_HOLD_FRAMES = 8;
+
+	// Keyboard layout, character to keypad key, as in Main.cpp
+	const char keys[KEY_COUNT] = { 'X', '1', '2', '3', 'Q', 'W', 'E', 'A', 'S', 'D', 'Z', 'C', '4', 'R', 'F', 'V' };
+
+	volatile std::sig_atomic_t quit_signal = 0;
+	volatile std::sig_atomic_t resized = 0;
+
+	// Raw, non-blocking keyboard input and the alternate screen for as long as it exists
+	class RawTerminal
+	{
+	public:
+		RawTerminal()
+		{
+			m_Raw = tcgetattr(STDIN_FILENO, &m_Original) == 0;
+			if (m_Raw)
+			{
+				termios raw = m_Original;
+				raw.c_iflag &= ~(IXON | ICRNL | BRKINT | ISTRIP);
+				raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+				raw.c_cc[VMIN] = 0;
+				raw.c_cc[VTIME] = 0;
+				tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+			}
+
+			Write(TerminalRenderer::GetEnterSequence());
+		}
+
+		~RawTerminal()
+		{
+			Write(TerminalRenderer::GetLeaveSequence());
+			if (m_Raw)
+			{
+				tcsetattr(STDIN_FILENO, TCSAFLUSH, &m_Original);
+			}
+		}
+
+		RawTerminal(const RawTerminal&) = delete;
+		RawTerminal& operator=(const RawTerminal&) = delete;
+
+		static void Write(const std::string& text)
+		{
+			size_t written = 0;
+			while (written < text.size())
+			{
+				ssize_t result = write(STDOUT_FILENO, text.data() + written, text.size() - written);
+				if (result <= 0)
+				{
+					return;
+				}
+
+				written += static_cast<size_t>(result);
+			}
+		}
+
+	private:
+		termios m_Original = {};
+		bool m_Raw = false;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	// --latency anywhere measures input latency through LatencyProbe, the other arguments are positional. Without it
+	// instructions run through Chip8::Run and only the frame phases are timed
+	bool measure_latency = false;
+	std::vector<char*> args;
+	for (int i = 0; i < argc; ++i)
+	{
+		if (std::string(argv[i]) == "--latency")
+			measure_latency = true;
+		else
+			args.push_back(argv[i]);
+	}
+
+	argc = static_cast<int>(args.size());
+	argv = args.data();
+
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s <rom.ch8> [cycles per frame] [quirk profile] [frames] [--latency]\n", argv[0]);
+		return -1;
+	}
+
+	unsigned cycles_per_frame = argc > 2 ? std::atoi(argv[2]) : 11;
+	QuirkProfile profile = argc > 3 ? static_cast<QuirkProfile>(std::atoi(argv[3])) : QuirkProfile::Chip8;
+	unsigned frame_limit = argc > 4 ? std::atoi(argv[4]) : 0;
+
+	// About 70KB, so not on the stack
+	auto chip8 = std::make_unique<Chip8>(profile);
+	if (!chip8->LoadROM(argv[1]))
+	{
+		std::fprintf(stderr, "Can't load %s\n", argv[1]);
+		return -1;
+	}
+
+	std::array<int8_t, 256> key_map;
+	key_map.fill(-1);
+	for (unsigned i = 0; i < KEY_COUNT; ++i)
+	{
+		key_map[static_cast<uint8_t>(keys[i])] = static_cast<int8_t>(i);
+		key_map[static_cast<uint8_t>(std::tolower(keys[i]))] = static_cast<int8_t>(i);
+	}
+
+	std::signal(SIGTERM, [](int) { quit_signal = 1; });
+	std::signal(SIGHUP, [](int) { quit_signal = 1; });
+	std::signal(SIGWINCH, [](int) { resized = 1; });
+
+	// Presses and releases go through the same queue as the windowed build, stamped with the cycle they apply on
+	InputQueue input;
+	std::array<uint64_t, KEY_COUNT> next_event_cycle = {};
+	std::array<uint64_t, KEY_COUNT> release_frame = {};
+	std::array<bool, KEY_COUNT> held = {};
+	auto push = [&](uint8_t key, bool pressed)
+	{
+		// Keep events for the same key on distinct cycles so a press and release never cancel out
+		uint64_t cycle = std::max(chip8->GetCycleCount(), next_event_cycle[key]);
+		next_event_cycle[key] = cycle + 1;
+		input.Push({ cycle, key, pressed });
+		held[key] = pressed;
+	};
+
+	TerminalRenderer renderer;
+	LatencyProbe latency;
+	uint64_t bytes = 0;
+	uint64_t frame = 0;
+	std::string error;
+	{
+		RawTerminal terminal;
+
+		auto next = std::chrono::steady_clock::now();
+		bool quit = false;
+		while (!quit && !quit_signal && (frame_limit == 0 || frame < frame_limit))
+		{
+			// Keyboard. An escape sequence (arrow keys and so on) arrives in one read, a lone Esc on its own
+			char buffer[64];
+			ssize_t count = read(STDIN_FILENO, buffer, sizeof(buffer));
+			for (ssize_t i = 0; i < count; ++i)
+			{
+				uint8_t c = static_cast<uint8_t>(buffer[i]);
+				if (c == 0x03 || (c == 0x1b && count == 1))
+				{
+					quit = true;
+				}
+				else if (c == 0x1b)
+				{
+					break;
+				}
+				else if (key_map[c] >= 0)
+				{
+					uint8_t key = static_cast<uint8_t>(key_map[c]);
+					if (!held[key])
+					{
+						push(key, true);
+					}
+
+					release_frame[key] = frame + KEY_HOLD_FRAMES;
+				}
+			}
+
+			for (uint8_t key = 0; key < KEY_COUNT; ++key)
+			{
+				if (held[key] && frame >= release_frame[key])
+				{
+					push(key, false);
+				}
+			}
+
+			try
+			{
+				if (measure_latency)
+					latency.Run(*chip8, cycles_per_frame, input);
+				else
+					chip8->Run(cycles_per_frame, input);
+			}
+			catch (const std::exception& e)
+			{
+				error = e.what();
+				break;
+			}
+
+			chip8->UpdateTimers();
+
+			if (resized)
+			{
+				resized = 0;
+				renderer.Invalidate();
+			}
+
+			// The terminal shows the frame as soon as it is written, so writing is both the upload and the present
+			uint64_t phase_start = LatencyProbe::Now();
+			const std::string& output = renderer.Render(chip8->VideoBuffer);
+			phase_start = latency.EndPhase(FramePhase::Build, phase_start);
+			RawTerminal::Write(output);
+			latency.EndPhase(FramePhase::Present, phase_start);
+			latency.OnPresent();
+			bytes += output.size();
+			++frame;
+
+			next += std::chrono::microseconds(16667);
+			std::this_thread::sleep_until(next);
+		}
+	}
+
+	if (!error.empty())
+	{
+		std::fprintf(stderr, "%s\n", error.c_str());
+		return -1;
+	}
+
+	std::fprintf(stderr, "%llu frames, %.0f bytes per frame\n", static_cast<unsigned long long>(frame), frame != 0 ? static_cast<double>(bytes) / frame : 0.0);
+	std::fprintf(stderr, "%s", latency.FormatReport().c_str());
+	return 0;
+}
@@ -0,0 +1,93 @@
+#include "WavWriter.h"
+#include <array>
+
+namespace
+{
+	void Write16(std::ofstream& file, uint16_t value)
+	{
+		char bytes[2] = { static_cast<char>(value), static_cast<char>(value >> 8) };
+		file.write(bytes, 2);
+	}
+
+	void Write32(std::ofstream& file, uint32_t value)
+	{
+		char bytes[4] = { static_cast<char>(value), static_cast<char>(value >> 8), static_cast<char>(value >> 16), static_cast<char>(value >> 24) };
+		file.write(bytes, 4);
+	}
+}
+
+WavWriter::~WavWriter()
+{
+	Close();
+}
+
+bool WavWriter::Open(char const* filename, unsigned sample_rate)
+{
+	m_File.open(filename, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+	if (!m_File)
+	{
+		return false;
+	}
+
+	m_SampleRate = sample_rate;
+	m_SampleCount = 0;
+	WriteHeader();
+	return static_cast<bool>(m_File);
+}
+
+void WavWriter::Write(const int16_t* samples, size_t count)
+{
+	// Samples are stored little endian
+	for (size_t i = 0; i < count; ++i)
+	{
+		Write16(m_File, static_cast<uint16_t>(samples[i]));
+	}
+
+	m_SampleCount += static_cast<uint32_t>(count);
+}
+
+void WavWriter::Drain(AudioRing& ring)
+{
+	std::array<int16_t, 1024> samples;
+	while (size_t count = ring.Read(samples.data(), samples.size()))
+	{
+		Write(samples.data(), count);
+	}
+}
+
+void WavWriter::Close()
+{
+	if (!m_File.is_open())
+	{
+		return;
+	}
+
+	// Rewrite the header now the sizes are known
+	m_File.seekp(0);
+	WriteHeader();
+	m_File.close();
+}
+
+void WavWriter::WriteHeader()
+{
+	const uint16_t channels = 1;
+	const uint16_t bits_per_sample = 16;
+	const uint16_t block_align = channels * bits_per_sample / 8;
+	uint32_t data_size = m_SampleCount * block_align;
+
+	m_File.write("RIFF", 4);
+	Write32(m_File, 36 + data_size);
+	m_File.write("WAVE", 4);
+
+	m_File.write("fmt ", 4);
+	Write32(m_File, 16);
+	Write16(m_File, 1); // PCM
+	Write16(m_File, channels);
+	Write32(m_File, m_SampleRate);
+	Write32(m_File, m_SampleRate * block_align);
+	Write16(m_File, block_align);
+	Write16(m_File, bits_per_sample);
+
+	m_File.write("data", 4);
+	Write32(m_File, data_size);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "AudioRing.h"
+#include <cstdint>
+#include <fstream>
+
+// Writes mono 16-bit PCM to a .wav file
+class WavWriter
+{
+public:
+	WavWriter() = default;
+	~WavWriter();
+
+	// Create the file
+	bool Open(char const* filename, unsigned sample_rate);
+
+	// Append samples
+	void Write(const int16_t* samples, size_t count);
+
+	// Append everything waiting in the ring
+	void Drain(AudioRing& ring);
+
+	// Fill in the header sizes and close the file
+	void Close();
+
+private:
+	std::ofstream m_File;
+	uint32_t m_SampleCount = 0;
+	unsigned m_SampleRate = 0;
+
+	void WriteHeader();
+};
@@ -0,0 +1,90 @@
+#include "WaveOutPlayer.h"
+
+WaveOutPlayer::WaveOutPlayer(AudioRing* ring, unsigned sample_rate) : m_Ring(ring), m_SampleRate(sample_rate)
+{
+}
+
+WaveOutPlayer::~WaveOutPlayer()
+{
+	Stop();
+}
+
+bool WaveOutPlayer::Start()
+{
+	m_BufferDone = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (m_BufferDone == NULL)
+	{
+		return false;
+	}
+
+	WAVEFORMATEX format = {};
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = 1;
+	format.nSamplesPerSec = m_SampleRate;
+	format.wBitsPerSample = 16;
+	format.nBlockAlign = format.nChannels * format.wBitsPerSample / 8;
+	format.nAvgBytesPerSec = format.nSamplesPerSec * format.nBlockAlign;
+
+	// The device signals the event every time it finishes a buffer
+	if (waveOutOpen(&m_Device, WAVE_MAPPER, &format, reinterpret_cast<DWORD_PTR>(m_BufferDone), 0, CALLBACK_EVENT) != MMSYSERR_NOERROR)
+	{
+		CloseHandle(m_BufferDone);
+		m_BufferDone = NULL;
+		return false;
+	}
+
+	// Queue every buffer with silence so playback starts straight away
+	for (unsigned i = 0; i < WAVE_OUT_BUFFER_COUNT; ++i)
+	{
+		m_Headers[i].lpData = reinterpret_cast<LPSTR>(m_Buffers[i].data());
+		m_Headers[i].dwBufferLength = static_cast<DWORD>(sizeof(m_Buffers[i]));
+		waveOutPrepareHeader(m_Device, &m_Headers[i], sizeof(WAVEHDR));
+		waveOutWrite(m_Device, &m_Headers[i], sizeof(WAVEHDR));
+	}
+
+	m_Running = true;
+	m_Thread = std::thread(&WaveOutPlayer::ThreadMain, this);
+	return true;
+}
+
+void WaveOutPlayer::Stop()
+{
+	if (!m_Running)
+	{
+		return;
+	}
+
+	m_Running = false;
+	SetEvent(m_BufferDone);
+	m_Thread.join();
+
+	waveOutReset(m_Device);
+	for (WAVEHDR& header : m_Headers)
+	{
+		waveOutUnprepareHeader(m_Device, &header, sizeof(WAVEHDR));
+	}
+
+	waveOutClose(m_Device);
+	CloseHandle(m_BufferDone);
+
+	m_Device = NULL;
+	m_BufferDone = NULL;
+}
+
+void WaveOutPlayer::ThreadMain()
+{
+	while (m_Running)
+	{
+		WaitForSingleObject(m_BufferDone, INFINITE);
+
+		// Refill and requeue every buffer the device has finished with
+		for (unsigned i = 0; i < WAVE_OUT_BUFFER_COUNT && m_Running; ++i)
+		{
+			if (m_Headers[i].dwFlags & WHDR_DONE)
+			{
+				m_Ring->ReadOrSilence(m_Buffers[i].data(), WAVE_OUT_BUFFER_SAMPLES);
+				waveOutWrite(m_Device, &m_Headers[i], sizeof(WAVEHDR));
+			}
+		}
+	}
+}
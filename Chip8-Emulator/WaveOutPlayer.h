@@ -0,0 +1,39 @@
+#pragma once
+
+#include "AudioRing.h"
+#include "AudioSynth.h"
+#include <Windows.h>
+#include <mmsystem.h>
+#include <array>
+#include <atomic>
+#include <thread>
+
+const unsigned int WAVE_OUT_BUFFER_COUNT = 4;
+const unsigned int WAVE_OUT_BUFFER_SAMPLES = 480;
+
+// Plays an AudioRing through waveOut on its own thread. When the ring runs dry it plays silence instead of waiting
+class WaveOutPlayer
+{
+public:
+	WaveOutPlayer(AudioRing* ring, unsigned sample_rate = AUDIO_SAMPLE_RATE);
+	~WaveOutPlayer();
+
+	// Open the device and start the audio thread
+	bool Start();
+
+	// Stop the audio thread and close the device
+	void Stop();
+
+private:
+	AudioRing* m_Ring = nullptr;
+	unsigned m_SampleRate = AUDIO_SAMPLE_RATE;
+
+	HWAVEOUT m_Device = NULL;
+	HANDLE m_BufferDone = NULL;
+	std::array<WAVEHDR, WAVE_OUT_BUFFER_COUNT> m_Headers = {};
+	std::array<std::array<int16_t, WAVE_OUT_BUFFER_SAMPLES>, WAVE_OUT_BUFFER_COUNT> m_Buffers = {};
+
+	std::thread m_Thread;
+	std::atomic<bool> m_Running = false;
+	void ThreadMain();
+};
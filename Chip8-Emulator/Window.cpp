@@ -129,12 +129,21 @@ void Window::HandleKeyboardEvent(UINT msg, WPARAM wParam, LPARAM lParam)
 		scan_code = MAKEWORD(scan_code, 0xE0);
 	}
 
+	if (!KeyCallback)
+	{
+		return;
+	}
+
 	if (msg == WM_KEYDOWN || msg == WM_SYSKEYDOWN)
 	{
-		KeyState[scan_code] = true;
+		// Auto-repeat doesn't change the key state
+		if (!repeat)
+		{
+			KeyCallback(scan_code, true);
+		}
 	}
 	else if (msg == WM_KEYUP || msg == WM_SYSKEYUP)
 	{
-		KeyState[scan_code] = false;
+		KeyCallback(scan_code, false);
 	}
 }
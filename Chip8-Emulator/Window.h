@@ -1,7 +1,7 @@
 #pragma once
 
 #include <Windows.h>
-#include <map>
+#include <functional>
 
 class Window
 {
@@ -24,8 +24,8 @@ public:
 	// Get window size
 	void GetSize(int* width, int* height);
 
-	// Keys
-	std::map<WORD, bool> KeyState;
+	// Called with the scan code on every key down and key up (repeats are filtered out)
+	std::function<void(WORD scan_code, bool pressed)> KeyCallback;
 
 private:
 	HWND m_Hwnd = NULL;